@@ -133,6 +133,7 @@ static optional void SHA256_Update(SHA256_CTX*, const uint8_t*, size_t);
 static optional void SHA256_Final(uint8_t[SHA256_DIGEST_LENGTH], SHA256_CTX*);
 static optional char* SHA256_End(SHA256_CTX*, char[SHA256_DIGEST_STRING_LENGTH]);
 static optional char* SHA256_Data(const uint8_t*, size_t, char[SHA256_DIGEST_STRING_LENGTH]);
+static optional void SHA256_Multi(const uint8_t* const[], const size_t[], size_t, uint8_t[][SHA256_DIGEST_LENGTH]);
 
 static optional void SHA384_Init(SHA384_CTX*);
 static optional void SHA384_Update(SHA384_CTX*, const uint8_t*, size_t);
@@ -153,6 +154,7 @@ static optional void SHA256_Update(SHA256_CTX*, const u_int8_t*, size_t);
 static optional void SHA256_Final(u_int8_t[SHA256_DIGEST_LENGTH], SHA256_CTX*);
 static optional char* SHA256_End(SHA256_CTX*, char[SHA256_DIGEST_STRING_LENGTH]);
 static optional char* SHA256_Data(const u_int8_t*, size_t, char[SHA256_DIGEST_STRING_LENGTH]);
+static optional void SHA256_Multi(const u_int8_t* const[], const size_t[], size_t, u_int8_t[][SHA256_DIGEST_LENGTH]);
 
 static optional void SHA384_Init(SHA384_CTX*);
 static optional void SHA384_Update(SHA384_CTX*, const u_int8_t*, size_t);
@@ -175,6 +177,7 @@ static optional void SHA256_Update();
 static optional void SHA256_Final();
 static optional char* SHA256_End();
 static optional char* SHA256_Data();
+static optional void SHA256_Multi();
 
 static optional void SHA384_Init();
 static optional void SHA384_Update();
@@ -709,6 +712,92 @@ static optional void SHA256_Transform(SHA256_CTX* context, const sha2_word32* da
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+/*** SHA-256 x86 Hardware Paths ***************************************/
+/*
+ * (gx addition.) SHA256_Update()/SHA256_Final() hand every run of whole
+ * blocks to SHA256_Blocks(), which uses the SHA extensions (SHA-NI) when
+ * the CPU has them and the portable transform above when it doesn't.
+ * SHA256_Multi() (below) additionally has an 8-lane AVX2 transform for
+ * machines with AVX2 but no SHA-NI.
+ *
+ * The choice is made on first use and kept in sha2_hw- 0 = portable,
+ * 1 = AVX2 (multi-buffer only), 2 = SHA-NI. Tests set it to force a path.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__)) && BYTE_ORDER == LITTLE_ENDIAN
+
+#include <immintrin.h>
+#define SHA2_X86	1
+#define SHA2_NI		__attribute__((target("sha,ssse3,sse4.1")))
+#define SHA2_AVX2	__attribute__((target("avx2")))
+
+static optional int sha2_hw = -1;
+static inline int sha2_cpu(void) {
+	if (sha2_hw < 0) {
+		__builtin_cpu_init();
+		sha2_hw = __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1") ? 2 :
+			  __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	return sha2_hw;
+}
+
+/*
+ * The SHA-NI transform for n consecutive blocks. sha256rnds2 wants the
+ * state as ABEF/CDGH halves, so it's shuffled in once per call rather
+ * than once per block. Each iteration is four rounds, with the schedule
+ * for W[4i..4i+3] computed from the previous sixteen words by
+ * sha256msg1/msg2 (unrolled, so W[] stays in registers).
+ */
+static SHA2_NI void SHA256_Transform_ni(sha2_word32 state[8], const sha2_byte* data, size_t n) {
+	const __m128i	bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m128i		s0, s1, abef, cdgh, t, k, W[4];
+	int		i;
+
+	t  = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xb1);	/* CDAB */
+	s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1b);	/* EFGH */
+	s0 = _mm_alignr_epi8(t, s1, 8);							/* ABEF */
+	s1 = _mm_blend_epi16(s1, t, 0xf0);						/* CDGH */
+
+	for (; n > 0; n--, data += SHA256_BLOCK_LENGTH) {
+		abef = s0;
+		cdgh = s1;
+#pragma GCC unroll 16
+		for (i = 0; i < 16; i++) {
+			if (i < 4) {
+				W[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16 * i)), bswap);
+			} else {
+				t = _mm_alignr_epi8(W[(i + 3) & 3], W[(i + 2) & 3], 4);
+				t = _mm_add_epi32(_mm_sha256msg1_epu32(W[i & 3], W[(i + 1) & 3]), t);
+				W[i & 3] = _mm_sha256msg2_epu32(t, W[(i + 3) & 3]);
+			}
+			k  = _mm_add_epi32(W[i & 3], _mm_loadu_si128((const __m128i*)&K256[4 * i]));
+			s1 = _mm_sha256rnds2_epu32(s1, s0, k);
+			s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(k, 0x0e));
+		}
+		s0 = _mm_add_epi32(s0, abef);
+		s1 = _mm_add_epi32(s1, cdgh);
+	}
+
+	t  = _mm_shuffle_epi32(s0, 0x1b);						/* FEBA */
+	s1 = _mm_shuffle_epi32(s1, 0xb1);						/* DCHG */
+	_mm_storeu_si128((__m128i*)&state[0], _mm_blend_epi16(t, s1, 0xf0));		/* DCBA */
+	_mm_storeu_si128((__m128i*)&state[4], _mm_alignr_epi8(s1, t, 8));		/* HGFE */
+}
+
+#endif /* SHA2_X86 */
+
+/* Process n whole blocks with whichever transform this CPU does best */
+static inline void SHA256_Blocks(SHA256_CTX* context, const sha2_byte* data, size_t n) {
+#ifdef SHA2_X86
+	if (sha2_cpu() == 2) {
+		SHA256_Transform_ni(context->state, data, n);
+		return;
+	}
+#endif
+	for (; n > 0; n--, data += SHA256_BLOCK_LENGTH) {
+		SHA256_Transform(context, (const sha2_word32*)data);
+	}
+}
+
 static optional void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -731,7 +820,7 @@ static optional void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, s
 			context->bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			SHA256_Transform(context, (sha2_word32*)context->buffer);
+			SHA256_Blocks(context, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->buffer[usedspace], data, len);
@@ -741,12 +830,13 @@ static optional void SHA256_Update(SHA256_CTX* context, const sha2_byte *data, s
 			return;
 		}
 	}
-	while (len >= SHA256_BLOCK_LENGTH) {
+	if (len >= SHA256_BLOCK_LENGTH) {
 		/* Process as many complete blocks as we can */
-		SHA256_Transform(context, (sha2_word32*)data);
-		context->bitcount += SHA256_BLOCK_LENGTH << 3;
-		len -= SHA256_BLOCK_LENGTH;
-		data += SHA256_BLOCK_LENGTH;
+		size_t	blocks = len / SHA256_BLOCK_LENGTH;
+		SHA256_Blocks(context, data, blocks);
+		context->bitcount += (sha2_word64)blocks * SHA256_BLOCK_LENGTH << 3;
+		len -= blocks * SHA256_BLOCK_LENGTH;
+		data += blocks * SHA256_BLOCK_LENGTH;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -783,7 +873,7 @@ static optional void SHA256_Final(sha2_byte digest[], SHA256_CTX* context) {
 					MEMSET_BZERO(&context->buffer[usedspace], SHA256_BLOCK_LENGTH - usedspace);
 				}
 				/* Do second-to-last transform: */
-				SHA256_Transform(context, (sha2_word32*)context->buffer);
+				SHA256_Blocks(context, context->buffer, 1);
 
 				/* And set-up for the last transform: */
 				MEMSET_BZERO(context->buffer, SHA256_SHORT_BLOCK_LENGTH);
@@ -799,7 +889,7 @@ static optional void SHA256_Final(sha2_byte digest[], SHA256_CTX* context) {
 		*(sha2_word64*)&context->buffer[SHA256_SHORT_BLOCK_LENGTH] = context->bitcount;
 
 		/* Final transform: */
-		SHA256_Transform(context, (sha2_word32*)context->buffer);
+		SHA256_Blocks(context, context->buffer, 1);
 
 #if BYTE_ORDER == LITTLE_ENDIAN
 		{
@@ -852,6 +942,216 @@ static optional char* SHA256_Data(const sha2_byte* data, size_t len, char digest
 }
 
 
+/*** SHA-256 Multi-Buffer: ********************************************/
+/*
+ * (gx addition.) SHA256_Multi(data, len, n, digest) puts the raw digest of
+ * each of n independent messages in digest[i]- e.g. the segments of a
+ * media stream as they're written out.
+ *
+ * With SHA-NI that's simply one message after another (each one already
+ * runs at close to the instructions' throughput). Without it, but with
+ * AVX2, eight messages go through the rounds at once, one per 32-bit
+ * lane. Lanes work through a queue: when a message's last (padded) block
+ * is done its digest is written and the lane picks up the next message,
+ * so lengths don't need to match. Once the queue is empty and only one or
+ * two lanes are still busy, they're finished off with the portable
+ * transform, which is faster than a mostly idle 8-wide one.
+ */
+#ifdef SHA2_X86
+
+typedef struct {
+	const sha2_byte	*data;		/* Whole blocks straight from the message */
+	size_t		full;		/* ... how many of them */
+	size_t		blocks;		/* ... plus the 1 or 2 padding blocks */
+	size_t		at;		/* Next block */
+	size_t		msg;		/* Index into data[]/len[]/digest[] */
+	sha2_byte	tail[2 * SHA256_BLOCK_LENGTH];
+} SHA256_LANE;
+
+static inline void SHA256_Lane_Start(SHA256_LANE* lane, const sha2_byte* data, size_t len, size_t msg) {
+	size_t		rem = len % SHA256_BLOCK_LENGTH, last;
+	sha2_word64	bits = (sha2_word64)len << 3;
+	int		j;
+
+	lane->data = data;
+	lane->full = len / SHA256_BLOCK_LENGTH;
+	lane->blocks = lane->full + (rem < SHA256_SHORT_BLOCK_LENGTH ? 1 : 2);
+	lane->at = 0;
+	lane->msg = msg;
+	last = (lane->blocks - lane->full) * SHA256_BLOCK_LENGTH;
+	MEMCPY_BCOPY(lane->tail, data + len - rem, rem);
+	lane->tail[rem] = 0x80;
+	MEMSET_BZERO(&lane->tail[rem + 1], last - rem - 1);
+	for (j = 1; j <= 8; j++, bits >>= 8) {
+		lane->tail[last - j] = (sha2_byte)bits;
+	}
+}
+
+static inline const sha2_byte* SHA256_Lane_Block(const SHA256_LANE* lane) {
+	return lane->at < lane->full ? lane->data + lane->at * SHA256_BLOCK_LENGTH
+				     : lane->tail + (lane->at - lane->full) * SHA256_BLOCK_LENGTH;
+}
+
+#define S32x8(b,x)	_mm256_or_si256(_mm256_srli_epi32((x), (b)), _mm256_slli_epi32((x), 32 - (b)))
+#define XOR3x8(x,y,z)	_mm256_xor_si256(_mm256_xor_si256((x), (y)), (z))
+
+/* Words off..off+7 of the eight blocks, transposed so w[j] holds word j of each */
+static SHA2_AVX2 inline void SHA256_Load8(__m256i w[8], const sha2_byte* const p[8], int off) {
+	const __m256i	bswap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+						 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	__m256i		r[8], t[8];
+	int		j;
+
+	for (j = 0; j < 8; j++) {
+		r[j] = _mm256_loadu_si256((const __m256i*)(p[j] + off));
+	}
+	for (j = 0; j < 8; j += 2) {
+		t[j]     = _mm256_unpacklo_epi32(r[j], r[j + 1]);
+		t[j + 1] = _mm256_unpackhi_epi32(r[j], r[j + 1]);
+	}
+	for (j = 0; j < 8; j += 4) {
+		r[j]     = _mm256_unpacklo_epi64(t[j],     t[j + 2]);
+		r[j + 1] = _mm256_unpackhi_epi64(t[j],     t[j + 2]);
+		r[j + 2] = _mm256_unpacklo_epi64(t[j + 1], t[j + 3]);
+		r[j + 3] = _mm256_unpackhi_epi64(t[j + 1], t[j + 3]);
+	}
+	for (j = 0; j < 4; j++) {
+		w[j]     = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r[j], r[j + 4], 0x20), bswap);
+		w[j + 4] = _mm256_shuffle_epi8(_mm256_permute2x128_si256(r[j], r[j + 4], 0x31), bswap);
+	}
+}
+
+/* One block for each of the eight lanes; st[j][lane] is state word j */
+static SHA2_AVX2 void SHA256_Transform8(sha2_word32 st[8][8], const sha2_byte* const p[8]) {
+	__m256i	a, b, c, d, e, f, g, h, T1, T2, s0, s1, W[16];
+	int	j;
+
+	SHA256_Load8(&W[0], p, 0);
+	SHA256_Load8(&W[8], p, 32);
+	a = _mm256_load_si256((const __m256i*)st[0]);
+	b = _mm256_load_si256((const __m256i*)st[1]);
+	c = _mm256_load_si256((const __m256i*)st[2]);
+	d = _mm256_load_si256((const __m256i*)st[3]);
+	e = _mm256_load_si256((const __m256i*)st[4]);
+	f = _mm256_load_si256((const __m256i*)st[5]);
+	g = _mm256_load_si256((const __m256i*)st[6]);
+	h = _mm256_load_si256((const __m256i*)st[7]);
+
+#pragma GCC unroll 16
+	for (j = 0; j < 64; j++) {
+		if (j >= 16) {
+			s0 = W[(j+1)&0x0f];
+			s0 = XOR3x8(S32x8(7, s0), S32x8(18, s0), _mm256_srli_epi32(s0, 3));
+			s1 = W[(j+14)&0x0f];
+			s1 = XOR3x8(S32x8(17, s1), S32x8(19, s1), _mm256_srli_epi32(s1, 10));
+			W[j&0x0f] = _mm256_add_epi32(_mm256_add_epi32(W[j&0x0f], s1),
+						     _mm256_add_epi32(W[(j+9)&0x0f], s0));
+		}
+		T1 = _mm256_add_epi32(_mm256_add_epi32(h, XOR3x8(S32x8(6, e), S32x8(11, e), S32x8(25, e))),
+				      _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g)));
+		T1 = _mm256_add_epi32(T1, _mm256_add_epi32(_mm256_set1_epi32(K256[j]), W[j&0x0f]));
+		T2 = _mm256_add_epi32(XOR3x8(S32x8(2, a), S32x8(13, a), S32x8(22, a)),
+				      _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b))));
+		h = g;
+		g = f;
+		f = e;
+		e = _mm256_add_epi32(d, T1);
+		d = c;
+		c = b;
+		b = a;
+		a = _mm256_add_epi32(T1, T2);
+	}
+
+	_mm256_store_si256((__m256i*)st[0], _mm256_add_epi32(a, _mm256_load_si256((const __m256i*)st[0])));
+	_mm256_store_si256((__m256i*)st[1], _mm256_add_epi32(b, _mm256_load_si256((const __m256i*)st[1])));
+	_mm256_store_si256((__m256i*)st[2], _mm256_add_epi32(c, _mm256_load_si256((const __m256i*)st[2])));
+	_mm256_store_si256((__m256i*)st[3], _mm256_add_epi32(d, _mm256_load_si256((const __m256i*)st[3])));
+	_mm256_store_si256((__m256i*)st[4], _mm256_add_epi32(e, _mm256_load_si256((const __m256i*)st[4])));
+	_mm256_store_si256((__m256i*)st[5], _mm256_add_epi32(f, _mm256_load_si256((const __m256i*)st[5])));
+	_mm256_store_si256((__m256i*)st[6], _mm256_add_epi32(g, _mm256_load_si256((const __m256i*)st[6])));
+	_mm256_store_si256((__m256i*)st[7], _mm256_add_epi32(h, _mm256_load_si256((const __m256i*)st[7])));
+}
+
+static void SHA256_Multi_avx2(const sha2_byte* const data[], const size_t len[], size_t n, sha2_byte digest[][SHA256_DIGEST_LENGTH]) {
+	static const sha2_byte	idle[SHA256_BLOCK_LENGTH];
+	SHA256_LANE		lane[8];
+	sha2_word32		st[8][8] __attribute__((aligned(32)));
+	const sha2_byte		*p[8];
+	SHA256_CTX		context;
+	size_t			next = 0;
+	int			l, j, live = 0;
+
+	for (l = 0; l < 8; l++) {
+		lane[l].msg = n;
+		if (next < n) {
+			SHA256_Lane_Start(&lane[l], data[next], len[next], next);
+			for (j = 0; j < 8; j++) st[j][l] = sha256_initial_hash_value[j];
+			next++;
+			live++;
+		}
+	}
+	while (live > 2) {
+		for (l = 0; l < 8; l++) {
+			p[l] = lane[l].msg < n ? SHA256_Lane_Block(&lane[l]) : idle;
+		}
+		SHA256_Transform8(st, p);
+		for (l = 0; l < 8; l++) {
+			if (lane[l].msg >= n || ++lane[l].at < lane[l].blocks) {
+				continue;
+			}
+			for (j = 0; j < 8; j++) {
+				REVERSE32(st[j][l], context.state[j]);
+			}
+			MEMCPY_BCOPY(digest[lane[l].msg], context.state, SHA256_DIGEST_LENGTH);
+			if (next < n) {
+				SHA256_Lane_Start(&lane[l], data[next], len[next], next);
+				for (j = 0; j < 8; j++) st[j][l] = sha256_initial_hash_value[j];
+				next++;
+			} else {
+				lane[l].msg = n;
+				live--;
+			}
+		}
+	}
+	for (l = 0; l < 8; l++) {
+		if (lane[l].msg >= n) {
+			continue;
+		}
+		for (j = 0; j < 8; j++) context.state[j] = st[j][l];
+		for (; lane[l].at < lane[l].blocks; lane[l].at++) {
+			SHA256_Transform(&context, (const sha2_word32*)SHA256_Lane_Block(&lane[l]));
+		}
+		for (j = 0; j < 8; j++) {
+			REVERSE32(context.state[j], context.state[j]);
+		}
+		MEMCPY_BCOPY(digest[lane[l].msg], context.state, SHA256_DIGEST_LENGTH);
+	}
+	MEMSET_BZERO(&context, sizeof(context));
+}
+
+#undef S32x8
+#undef XOR3x8
+
+#endif /* SHA2_X86 */
+
+static optional void SHA256_Multi(const sha2_byte* const data[], const size_t len[], size_t n, sha2_byte digest[][SHA256_DIGEST_LENGTH]) {
+	SHA256_CTX	context;
+	size_t		i;
+
+#ifdef SHA2_X86
+	if (n > 2 && sha2_cpu() == 1) {
+		SHA256_Multi_avx2(data, len, n, digest);
+		return;
+	}
+#endif
+	for (i = 0; i < n; i++) {
+		SHA256_Init(&context);
+		SHA256_Update(&context, data[i], len[i]);
+		SHA256_Final(digest[i], &context);
+	}
+}
+
+
 /*** SHA-512: *********************************************************/
 static optional void SHA512_Init(SHA512_CTX* context) {
 	if (context == (SHA512_CTX*)0) {
@@ -4,16 +4,16 @@ CW = "\\033[30m\\033[1m"
 
 define gcc
   @$(call INFO, gcc, $(notdir $<), $@)
-	@#$(CC) -O0 -g $(1) $(patsubst %,-I%,$(VPATH)) -MP -MD -MF $B/$(notdir $@).d -o $@ $(filter-out %.h,$<)
-	@#clang -ferror-limit=1 -g -O0 $(1) $(patsubst %,-I%,$(VPATH)) -MP -MD -MF $B/$(notdir $@).d -o $@ $(filter-out %.h,$<)
-	@clang -ferror-limit=1 -O3 $(1) $(patsubst %,-I%,$(VPATH)) -MP -MD -MF $B/$(notdir $@).d -o $@ $(filter-out %.h,$<)
+	@#$(CC) -O0 -g $(1) $(patsubst %,-I%,$(VPATH)) -MP -MD -MF $B/$(notdir $@).d -o $@ $(filter-out %.h,$<) $(2)
+	@#clang -ferror-limit=1 -g -O0 $(1) $(patsubst %,-I%,$(VPATH)) -MP -MD -MF $B/$(notdir $@).d -o $@ $(filter-out %.h,$<) $(2)
+	@clang -ferror-limit=1 -O3 $(1) $(patsubst %,-I%,$(VPATH)) -MP -MD -MF $B/$(notdir $@).d -o $@ $(filter-out %.h,$<) $(2)
 endef
 
 define LINK
   @$(call INFO, link, '*.o', $@)
-	@#$(CC) $(1) -I$B -o $@ $(filter %.o,$^)
-	@#clang -ferror-limit=1 -g -O0 $(1) -I$B -o $@ $(filter %.o,$^)
-	@clang -ferror-limit=1 -O3 $(1) -I$B -o $@ $(filter %.o,$^)
+	@#$(CC) $(1) -I$B -o $@ $(filter %.o,$^) $(LDLIBS)
+	@#clang -ferror-limit=1 -g -O0 $(1) -I$B -o $@ $(filter %.o,$^) $(LDLIBS)
+	@clang -ferror-limit=1 -O3 $(1) -I$B -o $@ $(filter %.o,$^) $(LDLIBS)
 endef
 
 define INFO
@@ -91,11 +91,13 @@
  *   | min3(a,b,c)        | expr | typesafe & multiple-side-effect-safe  |
  *   | max(a,b)           | expr | typesafe & multiple-side-effect-safe  |
  *   | max3(a,b,c)        | expr | typesafe & multiple-side-effect-safe  |
- *   | cpu_ts()           | val  | very, very fast but somewhat innacurate cpu timestamp (nanosecond res.) |
+ *   | cpu_ts             | val  | very, very fast 64-bit cpu timestamp (unordered rdtsc) |
+ *   | cpu_ts_start       | val  | cpu_ts that waits for earlier instructions (lfence; rdtsc)- begin an interval |
+ *   | cpu_ts_end         | val  | cpu_ts that later instructions wait for (rdtscp; lfence)- end an interval |
  *   | bswap64(n)         | val  | very fast little <-> big-endian                  |
  *   | ntz(n)             | val  | very fast index of the bit set to 1              |
  *   | uint_to_vlq        | val  | variable-length-encode (or BER, etc.) an integer |
- *   | vlq_to_uint        | val  | decode a variable-length-encoded integer         |
+ *   | vlq_to_uint        | val  | decode a variable-length-encoded integer (gx_varint.h: bounds-checked, bulk) |
  *
  *   | unlikely(expr)     | expr | compiler optimizes for expr to rarely succeed    |
  *   | rare(expr)         | expr | alias for _unlikely                              |
@@ -103,11 +105,15 @@
  *   | freq(expr)         | expr | alias for _likely                                |
  *   | pagesize()         | expr | memoized current pagesize                                   |
  *   | gx_sleep(...)      | sfx  | gx_sleep(8,004,720,010) would sleep for 8.004720010 seconds |
- *
- *   | $(FMT,...)         | val  | quick sprintf, useful for function args, uses static buff |
- *   | $reset()           | sfx  | resets static buffer when existing $(...) strings aren't needed |
- *   | $s(BUF,FMT,...)    | val  | like $(), but specify your own static char buffer |
- *   | $sreset(BUF)       | sfx  | like $reset(), but specify a buffer               |
+ *   | gx_futex_wake(p)   | sfx  | wake everything waiting on the int at p (shared mappings too)|
+ *   | gx_futex_wait(p,v) | val  | block until the int at p is no longer v- returns new value  |
+ *
+ *   | $(FMT,...)         | val  | quick sprintf, useful for function args- per-thread arena that grows, never truncates |
+ *   | $d(X) $u(X) $x(X)  | val  | like $() for one integer (signed / unsigned / hex), without snprintf |
+ *   | $f(X) $p(X)        | val  | same for a double (shortest round-trip) / pointer- see gx_fmt.h |
+ *   | $reset()           | sfx  | resets the arena when existing $(...) strings aren't needed (logging does it per record) |
+ *   | $S(BUF,FMT,...)    | val  | like $(), but specify your own gx_strbuf (also $Sd/$Su/$Sx/$Sf/$Sp) |
+ *   | $Sreset(BUF)       | sfx  | like $reset(), but specify a buffer               |
  *   |
  *
  *   | NARG(...)          | pp   | number of arguments given                       |
@@ -202,16 +208,40 @@ typedef long double                F96,   float96,  float96_be,  float96_le;
 
 /// Compiler-specific intrinsics and fixes: bswap64, ntz, rdtsc, ...
 
+/// cpu_ts is the raw, full 64-bit tsc. It can be reordered around the code
+/// being measured- for benchmarking bracket with cpu_ts_start / cpu_ts_end.
+/// Ticks aren't ns: gx_time.h calibrates them (gx_ticks_ns) and says whether
+/// they're invariant. Without a tsc all three are CLOCK_MONOTONIC ns.
 #if __INTEL_COMPILER
-  #define cpu_ts ((unsigned)__rdtsc())
+  #define GX_HAS_TSC   1
+  #define cpu_ts       ((uint64_t)__rdtsc())
+  #define cpu_ts_start ({ _mm_lfence(); (uint64_t)__rdtsc(); })
+  #define cpu_ts_end   ({ unsigned _aux; uint64_t _r = __rdtscp(&_aux); _mm_lfence(); _r; })
 #elif (__GNUC__ && (__x86_64__ || __amd64__ || __i386__))
-  #define cpu_ts ({unsigned res; __asm__ __volatile__ ("rdtsc" : "=a"(res) : : "edx"); res;})
+  #define GX_HAS_TSC   1
+  #define cpu_ts       ({ uint32_t _lo, _hi;                                               \
+                          __asm__ __volatile__ ("rdtsc" : "=a"(_lo), "=d"(_hi));           \
+                          ((uint64_t)_hi << 32) | _lo; })
+  #define cpu_ts_start ({ uint32_t _lo, _hi;                                               \
+                          __asm__ __volatile__ ("lfence\n\trdtsc" : "=a"(_lo), "=d"(_hi) : : "memory"); \
+                          ((uint64_t)_hi << 32) | _lo; })
+  #define cpu_ts_end   ({ uint32_t _lo, _hi;                                               \
+                          __asm__ __volatile__ ("rdtscp\n\tlfence" : "=a"(_lo), "=d"(_hi) : : "ecx", "memory"); \
+                          ((uint64_t)_hi << 32) | _lo; })
 #elif (_M_IX86)
   #include <intrin.h>
   #pragma intrinsic(__rdtsc)
-  #define cpu_ts ((unsigned)__rdtsc())
+  #define GX_HAS_TSC   1
+  #define cpu_ts       ((uint64_t)__rdtsc())
+  #define cpu_ts_start cpu_ts
+  #define cpu_ts_end   cpu_ts
 #else
-  #warning "Don't know how to implement RDTSC intrinsic on your system."
+  #include <time.h>
+  #define GX_HAS_TSC   0
+  #define cpu_ts       ({ struct timespec _ts; clock_gettime(CLOCK_MONOTONIC, &_ts);      \
+                          (uint64_t)_ts.tv_sec * 1000000000ULL + _ts.tv_nsec; })
+  #define cpu_ts_start cpu_ts
+  #define cpu_ts_end   cpu_ts
 #endif
 
 #if __GNUC__ > 3
@@ -376,7 +406,7 @@ static optional inline int uint_to_vlq(uint64_t x, uint8_t *out) {
         ++count;
     }
     out[i] ^= 128;
-    return ++count;
+    return count;
 }
 
 static optional inline uint64_t vlq_to_uint(uint8_t *in) {
@@ -418,8 +448,10 @@ static int _GXPS optional = 0;
 /**
  * gx_base64_urlencode_m3()
  *
- * Encodes inp into outp, optimized for inputs that are multiples of 3 in
- * length. Be sure that outp is allocated to be at least GX_BASE64_SIZE(sizeof(input_data));
+ * Encodes inp into outp; inputs must be multiples of 3 in length. Be sure
+ * that outp is allocated to be at least GX_BASE64_SIZE(sizeof(input_data)).
+ * For any length, padding, decoding, standard base64url and the SIMD
+ * versions see gx_base64.h.
  *
  * The "normal" base-64 encoding lookup is done on this string:
  *
@@ -431,7 +463,7 @@ static int _GXPS optional = 0;
  * something expecting true base64-url-encoding.
  */
 static const optional char _gx_t64[]= "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz-";
-#define GX_BASE64_SIZE(DATSIZE) (4 * (DATSIZE) / 3 + 1)
+#define GX_BASE64_SIZE(DATSIZE) (((DATSIZE) * 4 + 2) / 3 + 1)   ///< Unpadded chars + '\0'
 static optional inline ssize_t gx_base64_urlencode_m3(const void *indata, size_t insize, char *outdata) {
     const char *inp  = (const char *)indata;
     char       *outp = outdata;
@@ -512,5 +544,43 @@ static optional inline int _gx_sleep(time_t seconds, long nanoseconds) {
     return 0;
 }
 
+/// Futexes- work across processes as long as the int lives in a MAP_SHARED
+/// mapping. Falls back to a short polling sleep where there are no futexes.
+#ifdef __LINUX__
+  #include <linux/futex.h>
+#endif
+
+static optional inline int _gx_futex(void *f, int op, int val) {
+    #ifdef __LINUX__
+      return syscall(SYS_futex, f, op, val, (void *)NULL, (int *)NULL, 0);
+    #else
+      return 0; // NOP
+    #endif
+}
+
+static optional inline int gx_futex_wake(void *f) {
+    #ifdef __LINUX__
+      return _gx_futex(f, FUTEX_WAKE, INT32_MAX);
+    #else
+      return 0; // NOP
+    #endif
+}
+
+static optional inline int gx_futex_wait(void *f, int curr_val) {
+    int volatile * const p = (int volatile *)f;
+    for(;;) {
+        int v = *p;
+        if(v != curr_val) return v;
+        #ifdef __LINUX__
+            if(rare(_gx_futex(f, FUTEX_WAIT, v) < 0)) {
+                if(rare(errno != EAGAIN && errno != EINTR)) return -1;
+                errno = 0;
+            }
+        #else
+            gx_sleep(0,2000);
+        #endif
+    }
+}
+
 
 #endif
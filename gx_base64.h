@@ -0,0 +1,321 @@
+/**
+  base64 for any length, either alphabet, with SSSE3 / AVX2 kernels.
+
+  Two alphabets, both url-safe and made of the same 64 characters:
+    - gx_b64_sortable: _gx_t64 from gx.h ("0-9A-Z_a-z-"), in ascending ascii
+      but for the last ('-'), so text mostly sorts like the big-endian data.
+      Log ticks, nonces and tokens use it.
+    - gx_b64_url:      standard RFC 4648 base64url ("A-Za-z0-9-_").
+
+  Encoding adds '=' padding or not; decoding takes either, and rejects (-1,
+  EINVAL) a char outside the alphabet, an impossible length, or a tail with
+  stray low bits- so every byte string has exactly one accepted unpadded
+  encoding.
+
+  The vector kernels are Wojciech Muła's: one pshufb + two multiplies split
+  12 bytes into 16 six-bit indices, and two multiply-adds merge them back.
+  Indices become chars with one pshufb per 16-entry quarter of the alphabet.
+  Going back, both alphabets being the same set means one validity check
+  serves both- c is bad iff _gx_b64_lut_lo[c & 15] & _gx_b64_lut_hi[c >> 4]
+  - and the value is c plus an offset picked by c >> 4, with '_' the only
+  char off its nibble's run. The scalar code uses the same tables, so it's
+  branch-free per char too. The widest kernel the cpu has is picked on first
+  use; each one takes whole blocks and leaves the rest to the next narrower.
+
+  | function / macro                          | description                                    |
+  | ----------------------------------------- | ---------------------------------------------- |
+  | gx_base64_encode(alpha, in, n, out, pad)  | -> out, returns chars + 1 (the '\0')           |
+  | gx_base64_decode(alpha, in, n, out)       | -> out, returns bytes or -1 (EINVAL)           |
+  | gx_base64_urlencode(in, n, out)           | Sortable alphabet, unpadded                    |
+  | gx_base64_urldecode(in, n, out)           | Sortable alphabet                              |
+  | GX_BASE64_SIZE(n)                         | out size, unpadded encoding (gx.h)             |
+  | GX_BASE64_PADDED_SIZE(n)                  | out size, padded encoding                      |
+  | GX_BASE64_DECODED_MAX(chars)              | out size that's always enough to decode into   |
+*/
+#ifndef _GX_BASE64_H
+#define _GX_BASE64_H
+
+#include "./gx.h"
+
+#define GX_BASE64_PADDED_SIZE(DATSIZE) (((DATSIZE) + 2) / 3 * 4 + 1)   ///< Chars + '\0'
+#define GX_BASE64_DECODED_MAX(CHARS)   ((CHARS) * 3 / 4)
+
+typedef struct gx_b64_alphabet {
+    int8_t off[16];                      ///< value = c + off[c >> 4] ...
+    int8_t us_adj;                       ///< ... + us_adj when c is '_'
+    int8_t run_at[4], run_step[4];       ///< char = value + enc[0] + run_step[j] for each run_at[j] <= value
+    char   enc[64];                      ///< 6-bit value -> char
+} __attribute__((aligned(16))) gx_b64_alphabet;
+
+static const optional gx_b64_alphabet gx_b64_sortable = {
+    {0, 0, 63 - '-', -'0', 10 - 'A', 10 - 'A', 37 - 'a', 37 - 'a'}, 36 - '_' - (10 - 'A'),
+    {10, 36, 37, 63}, {'A' - 10 - '0', '_' - 36 - ('A' - 10), 'a' - 37 - ('_' - 36), '-' - 63 - ('a' - 37)},
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz-"};
+static const optional gx_b64_alphabet gx_b64_url = {
+    {0, 0, 62 - '-', 52 - '0', -'A', -'A', 26 - 'a', 26 - 'a'}, 63 - '_' - -'A',
+    {26, 52, 62, 63}, {'a' - 26 - 'A', '0' - 52 - ('a' - 26), '-' - 62 - ('0' - 52), '_' - 63 - ('-' - 62)},
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"};
+
+/// Validity for both alphabets. One bit per kind of high nibble:
+///   0x01 2x: only '-'     0x02 3x: 0-9        0x04 4x, 6x: all but x0
+///   0x08 5x: 0-a and f    0x10 7x: 0-a        0x20 anything else: none
+/// _gx_b64_lut_lo has a kind's bit for each low nibble that's invalid in it.
+static const optional uint8_t _gx_b64_lut_hi[16] __attribute__((aligned(16))) = {
+    0x20, 0x20, 0x01, 0x02, 0x04, 0x08, 0x04, 0x10, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20};
+static const optional uint8_t _gx_b64_lut_lo[16] __attribute__((aligned(16))) = {
+    0x25, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x21, 0x23, 0x3b, 0x3b, 0x3a, 0x3b, 0x33};
+
+/// 0-63, or -1 if c isn't in the alphabet
+static inline int _gx_b64_dec1(const gx_b64_alphabet *a, uint8_t c) {
+    if(_gx_b64_lut_lo[c & 15] & _gx_b64_lut_hi[c >> 4]) return -1;
+    return (uint8_t)(c + a->off[c >> 4] + (c == '_' ? a->us_adj : 0));
+}
+
+/// Scalar, whole triples / quads. Return the input consumed (decode: -1 on a bad char).
+static inline size_t _gx_b64_enc_scalar(const gx_b64_alphabet *a, const uint8_t *in, size_t n, char *out) {
+    size_t i;
+    for(i = 0; n - i >= 3; i += 3, out += 4) {
+        out[0] = a->enc[  in[i] >> 2];
+        out[1] = a->enc[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+        out[2] = a->enc[((in[i + 1] & 0x0F) << 2) | (in[i + 2] >> 6)];
+        out[3] = a->enc[  in[i + 2] & 0x3F];
+    }
+    return i;
+}
+
+static inline ssize_t _gx_b64_dec_scalar(const gx_b64_alphabet *a, const uint8_t *in, size_t n, uint8_t *out) {
+    size_t i;
+    int    v0, v1, v2, v3;
+    for(i = 0; n - i >= 4; i += 4, out += 3) {
+        v0 = _gx_b64_dec1(a, in[i]);     v1 = _gx_b64_dec1(a, in[i + 1]);
+        v2 = _gx_b64_dec1(a, in[i + 2]); v3 = _gx_b64_dec1(a, in[i + 3]);
+        if(rare((v0 | v1 | v2 | v3) < 0)) return -1;
+        out[0] = (v0 << 2) | (v1 >> 4);
+        out[1] = (v1 << 4) | (v2 >> 2);
+        out[2] = (v2 << 6) | v3;
+    }
+    return i;
+}
+
+//-----------------------------------------------------------------------------
+#if (__GNUC__ && (__x86_64__ || __amd64__ || __i386__))
+#include <immintrin.h>
+#define _GX_B64_SSSE3 __attribute__((target("ssse3")))
+#define _GX_B64_AVX2  __attribute__((target("avx2")))
+
+/// 0 = scalar, 1 = SSSE3, 2 = AVX2; -1 until the first call looks. (Tests
+/// set it to compare the paths.)
+static optional int _gx_b64_level = -1;
+static inline int _gx_b64_cpu(void) {
+    if(rare(_gx_b64_level < 0)) {
+        __builtin_cpu_init();
+        _gx_b64_level = __builtin_cpu_supports("avx2") ? 2 : __builtin_cpu_supports("ssse3") ? 1 : 0;
+    }
+    return _gx_b64_level;
+}
+
+// Each lane: 12 bytes (at its start) -> 16 indices
+static _GX_B64_SSSE3 inline __m128i _gx_b64_split(__m128i v) {
+    v = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    return _mm_or_si128(_mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040)),
+                        _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010)));
+}
+static _GX_B64_AVX2 inline __m256i _gx_b64_split2(__m256i v) {
+    v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                                1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    return _mm256_or_si256(
+        _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040)),
+        _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010)));
+}
+
+// The alphabet as vectors, built once per call- out may alias it, so
+// reading it inside the loops would reload it every block.
+typedef struct { __m128i base, at0, at1, at2, at3, st0, st1, st2, st3, off, us_adj; } _gx_b64_v128;
+typedef struct { __m256i base, at0, at1, at2, at3, st0, st1, st2, st3, off, us_adj; } _gx_b64_v256;
+
+static _GX_B64_SSSE3 inline _gx_b64_v128 _gx_b64_vec(const gx_b64_alphabet *a) {
+    _gx_b64_v128 v = {_mm_set1_epi8(a->enc[0]),
+        _mm_set1_epi8(a->run_at[0] - 1), _mm_set1_epi8(a->run_at[1] - 1),
+        _mm_set1_epi8(a->run_at[2] - 1), _mm_set1_epi8(a->run_at[3] - 1),
+        _mm_set1_epi8(a->run_step[0]), _mm_set1_epi8(a->run_step[1]),
+        _mm_set1_epi8(a->run_step[2]), _mm_set1_epi8(a->run_step[3]),
+        _mm_loadu_si128((const __m128i *)a->off), _mm_set1_epi8(a->us_adj)};
+    return v;
+}
+static _GX_B64_AVX2 inline _gx_b64_v256 _gx_b64_vec2(const gx_b64_alphabet *a) {
+    _gx_b64_v256 v = {_mm256_set1_epi8(a->enc[0]),
+        _mm256_set1_epi8(a->run_at[0] - 1), _mm256_set1_epi8(a->run_at[1] - 1),
+        _mm256_set1_epi8(a->run_at[2] - 1), _mm256_set1_epi8(a->run_at[3] - 1),
+        _mm256_set1_epi8(a->run_step[0]), _mm256_set1_epi8(a->run_step[1]),
+        _mm256_set1_epi8(a->run_step[2]), _mm256_set1_epi8(a->run_step[3]),
+        _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)a->off)), _mm256_set1_epi8(a->us_adj)};
+    return v;
+}
+
+// Indices -> chars: an offset that steps at each run of the alphabet
+static _GX_B64_SSSE3 inline __m128i _gx_b64_chars(const _gx_b64_v128 *v, __m128i idx) {
+    __m128i o = v->base;
+    o = _mm_add_epi8(o, _mm_and_si128(_mm_cmpgt_epi8(idx, v->at0), v->st0));
+    o = _mm_add_epi8(o, _mm_and_si128(_mm_cmpgt_epi8(idx, v->at1), v->st1));
+    o = _mm_add_epi8(o, _mm_and_si128(_mm_cmpgt_epi8(idx, v->at2), v->st2));
+    o = _mm_add_epi8(o, _mm_and_si128(_mm_cmpgt_epi8(idx, v->at3), v->st3));
+    return _mm_add_epi8(idx, o);
+}
+static _GX_B64_AVX2 inline __m256i _gx_b64_chars2(const _gx_b64_v256 *v, __m256i idx) {
+    __m256i o = v->base;
+    o = _mm256_add_epi8(o, _mm256_and_si256(_mm256_cmpgt_epi8(idx, v->at0), v->st0));
+    o = _mm256_add_epi8(o, _mm256_and_si256(_mm256_cmpgt_epi8(idx, v->at1), v->st1));
+    o = _mm256_add_epi8(o, _mm256_and_si256(_mm256_cmpgt_epi8(idx, v->at2), v->st2));
+    o = _mm256_add_epi8(o, _mm256_and_si256(_mm256_cmpgt_epi8(idx, v->at3), v->st3));
+    return _mm256_add_epi8(idx, o);
+}
+
+// Chars -> values; anything invalid gets or'd into *bad
+static _GX_B64_SSSE3 inline __m128i _gx_b64_vals(const _gx_b64_v128 *v, __m128i c, __m128i *bad) {
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(c, 4), _mm_set1_epi8(0x0f)), lo = _mm_and_si128(c, _mm_set1_epi8(0x0f));
+    *bad = _mm_or_si128(*bad, _mm_and_si128(_mm_shuffle_epi8(_mm_load_si128((const __m128i *)_gx_b64_lut_lo), lo),
+                                            _mm_shuffle_epi8(_mm_load_si128((const __m128i *)_gx_b64_lut_hi), hi)));
+    return _mm_add_epi8(c, _mm_add_epi8(_mm_shuffle_epi8(v->off, hi),
+                                        _mm_and_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('_')), v->us_adj)));
+}
+static _GX_B64_AVX2 inline __m256i _gx_b64_vals2(const _gx_b64_v256 *v, __m256i c, __m256i *bad) {
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(c, 4), _mm256_set1_epi8(0x0f));
+    __m256i lo = _mm256_and_si256(c, _mm256_set1_epi8(0x0f));
+    *bad = _mm256_or_si256(*bad, _mm256_and_si256(
+        _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)_gx_b64_lut_lo)), lo),
+        _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)_gx_b64_lut_hi)), hi)));
+    return _mm256_add_epi8(c, _mm256_add_epi8(_mm256_shuffle_epi8(v->off, hi),
+                                              _mm256_and_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('_')), v->us_adj)));
+}
+
+// Each lane: 16 values -> 12 bytes at its start
+static _GX_B64_SSSE3 inline __m128i _gx_b64_merge(__m128i v) {
+    v = _mm_madd_epi16(_mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+static _GX_B64_AVX2 inline __m256i _gx_b64_merge2(__m256i v) {
+    v = _mm256_madd_epi16(_mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140)), _mm256_set1_epi32(0x00011000));
+    return _mm256_shuffle_epi8(v, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                   2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+/// Loads are 16 bytes for every 12 used, so stop while that stays in bounds.
+static _GX_B64_SSSE3 size_t _gx_b64_enc_ssse3(const gx_b64_alphabet *a, const uint8_t *in, size_t n, char *out) {
+    _gx_b64_v128 v = _gx_b64_vec(a);
+    size_t       i;
+    for(i = 0; n - i >= 16; i += 12, out += 16)
+        _mm_storeu_si128((__m128i *)out, _gx_b64_chars(&v, _gx_b64_split(_mm_loadu_si128((const __m128i *)(in + i)))));
+    return i;
+}
+
+static _GX_B64_AVX2 size_t _gx_b64_enc_avx2(const gx_b64_alphabet *a, const uint8_t *in, size_t n, char *out) {
+    _gx_b64_v256 v = _gx_b64_vec2(a);
+    size_t       i;
+    for(i = 0; n - i >= 28; i += 24, out += 32) {
+        __m256i b = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+                                            _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+        _mm256_storeu_si256((__m256i *)out, _gx_b64_chars2(&v, _gx_b64_split2(b)));
+    }
+    return i;
+}
+
+/// Stores are 16 bytes for every 12 produced, so stop while what's left of
+/// the input still decodes to at least that much. Returns -1 on a bad char
+/// (what's in out by then is garbage).
+static _GX_B64_SSSE3 ssize_t _gx_b64_dec_ssse3(const gx_b64_alphabet *a, const uint8_t *in, size_t n, uint8_t *out) {
+    _gx_b64_v128 v = _gx_b64_vec(a);
+    __m128i      bad = _mm_setzero_si128();
+    size_t       i;
+    for(i = 0; n - i >= 24; i += 16, out += 12)
+        _mm_storeu_si128((__m128i *)out, _gx_b64_merge(_gx_b64_vals(&v, _mm_loadu_si128((const __m128i *)(in + i)), &bad)));
+    return rare(_mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xffff) ? -1 : (ssize_t)i;
+}
+
+static _GX_B64_AVX2 ssize_t _gx_b64_dec_avx2(const gx_b64_alphabet *a, const uint8_t *in, size_t n, uint8_t *out) {
+    _gx_b64_v256 v = _gx_b64_vec2(a);
+    __m256i      bad = _mm256_setzero_si256(), b;
+    size_t       i;
+    for(i = 0; n - i >= 44; i += 32, out += 24) {
+        b = _gx_b64_merge2(_gx_b64_vals2(&v, _mm256_loadu_si256((const __m256i *)(in + i)), &bad));
+        b = _mm256_permutevar8x32_epi32(b, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256((__m256i *)out, b);
+    }
+    return rare(!_mm256_testz_si256(bad, bad)) ? -1 : (ssize_t)i;
+}
+#else
+#define _gx_b64_cpu()                   0
+#define _gx_b64_enc_ssse3(A, I, N, O)   0
+#define _gx_b64_enc_avx2(A, I, N, O)    0
+#define _gx_b64_dec_ssse3(A, I, N, O)   0
+#define _gx_b64_dec_avx2(A, I, N, O)    0
+#endif
+
+//-----------------------------------------------------------------------------
+/// Encodes n bytes of in into out (GX_BASE64_SIZE(n), or
+/// GX_BASE64_PADDED_SIZE(n) with pad). Returns the chars written including
+/// the '\0'.
+static optional inline ssize_t gx_base64_encode(const gx_b64_alphabet *a, const void *in, size_t n, char *out, int pad) {
+    const uint8_t *inp = (const uint8_t *)in;
+    size_t         i = 0, o;
+    int            lvl = _gx_b64_cpu();
+    if(lvl >= 2 && n >= 28)     i += _gx_b64_enc_avx2(a, inp, n, out);
+    if(lvl >= 1 && n - i >= 16) i += _gx_b64_enc_ssse3(a, inp + i, n - i, out + i / 3 * 4);
+    i += _gx_b64_enc_scalar(a, inp + i, n - i, out + i / 3 * 4);
+    o  = i / 3 * 4;
+    switch(n - i) {
+        case 1: out[o++] = a->enc[  inp[i] >> 2];
+                out[o++] = a->enc[ (inp[i] & 0x03) << 4];
+                if(pad) { out[o++] = '='; out[o++] = '='; }
+                break;
+        case 2: out[o++] = a->enc[  inp[i] >> 2];
+                out[o++] = a->enc[((inp[i] & 0x03) << 4) | (inp[i + 1] >> 4)];
+                out[o++] = a->enc[ (inp[i + 1] & 0x0F) << 2];
+                if(pad) out[o++] = '=';
+                break;
+    }
+    out[o] = '\0';
+    return o + 1;
+}
+
+/// Decodes n chars of in, padded or not, into out (GX_BASE64_DECODED_MAX(n)
+/// is always enough). Returns the bytes written, or -1 w/ EINVAL.
+static optional inline ssize_t gx_base64_decode(const gx_b64_alphabet *a, const char *in, size_t n, void *out) {
+    const uint8_t *inp  = (const uint8_t *)in;
+    uint8_t       *outp = (uint8_t *)out;
+    size_t         i = 0, whole;
+    ssize_t        k;
+    int            v0, v1, v2 = 0, lvl = _gx_b64_cpu();
+    if(n && !(n % 4) && inp[n - 1] == '=') n -= inp[n - 2] == '=' ? 2 : 1;
+    if(rare(n % 4 == 1)) {errno = EINVAL; return -1;}
+    whole = n & ~(size_t)3;
+    if(lvl >= 2 && whole >= 44)     { if(rare((k = _gx_b64_dec_avx2(a, inp, whole, outp)) < 0)) goto bad; i += k; }
+    if(lvl >= 1 && whole - i >= 24) { if(rare((k = _gx_b64_dec_ssse3(a, inp + i, whole - i, outp + i / 4 * 3)) < 0)) goto bad; i += k; }
+    if(rare(_gx_b64_dec_scalar(a, inp + i, whole - i, outp + i / 4 * 3) < 0)) goto bad;
+    outp += whole / 4 * 3;
+    if(n > whole) {
+        v0 = _gx_b64_dec1(a, inp[whole]);
+        v1 = _gx_b64_dec1(a, inp[whole + 1]);
+        if(n - whole == 3) v2 = _gx_b64_dec1(a, inp[whole + 2]);
+        if(rare((v0 | v1 | v2) < 0)) goto bad;
+        *outp++ = (v0 << 2) | (v1 >> 4);
+        if(n - whole == 3) {
+            if(rare(v2 & 0x03)) goto bad;
+            *outp++ = (v1 << 4) | (v2 >> 2);
+        } else if(rare(v1 & 0x0F)) goto bad;
+    }
+    return outp - (uint8_t *)out;
+bad:
+    errno = EINVAL;
+    return -1;
+}
+
+/// The sortable alphabet, unpadded- what nonces and tokens use.
+static optional inline ssize_t gx_base64_urlencode(const void *in, size_t n, char *out) {
+    return gx_base64_encode(&gx_b64_sortable, in, n, out, 0);
+}
+
+static optional inline ssize_t gx_base64_urldecode(const char *in, size_t n, void *out) {
+    return gx_base64_decode(&gx_b64_sortable, in, n, out);
+}
+
+#endif
@@ -41,7 +41,7 @@
 
     Actions
       - _ignore()        : ignore. possibly logs to unessential severity
-      - _raise (RV)      : returns RV after saving the error on the error-stack
+      - _raise (RV)      : returns RV after saving the error on the (per-thread) error-stack
       - _clear ()        : clears the error-stack- does not log. happens automatically with other handlers
       - _abort  ()        : exits with error-number's value- automatically logs reason / severity
       - E_LOG   (SEV,...) : explicitly logs the error with a given severity & additional information
@@ -66,8 +66,30 @@
         - hstrerror,
       - _eio  - stdio ferror style errors (distinguish feof)
       - _eavc - libavconv/ffmpeg style error codes
-      - Silently abort (very early on) if runtime log-level is > severity
-      - Append stack trace report when severity is high enough
+
+    Native stack (K_err_stack)
+      The first error marked on a thread's (clean) stack also records up to
+      GX_ERROR_STACK_FRAMES return addresses by walking the frame-pointer
+      chain- a few loads per frame, only on the already-cold marking path.
+      Build with -fno-omit-frame-pointer (and -rdynamic if you want names for
+      the executable's own functions) or the chain usually stops after a
+      frame or two; the walk never leaves the thread's stack either way.
+      Define GX_ERROR_STACK_FRAMES 0 to compile it out.
+
+    Per-thread stack
+      The error stack, its index and the check depth are thread-local. Define
+      GX_ERROR_SHARED_STACK 1 to get back the old process-wide .comm globals
+      (and the unconditional clear after every successful outermost check)-
+      only for measuring against: threads then clobber each other's reports.
+
+      Symbolizing is deferred: the origin report carries raw addresses, and
+      gx_error_symbolize() turns them into "func+0x1f(/path/module+0x11a6)"
+      (module+offset is what addr2line -f -e module wants offline). The
+      async logger does that on its drainer thread; without it, it happens
+      when the report is logged. That needs dladdr- link with -ldl before
+      glibc 2.34. Define GX_ERROR_DLADDR 0 to do without (or it's off anyway
+      when <dlfcn.h> was included before gx.h could ask for _GNU_SOURCE):
+      gx_error_symbolize() then just passes the raw addresses through.
 */
 
 #ifndef GX_ERROR_H
@@ -77,6 +99,21 @@
 #include "./gxe/gx_enum_lookups.h"
 #include <sys/mman.h>
 
+#ifndef GX_ERROR_DLADDR
+  #include <dlfcn.h>
+  #if !defined(__GLIBC__) || defined(__USE_GNU)   // glibc hides Dl_info / dladdr without _GNU_SOURCE
+    #define GX_ERROR_DLADDR 1
+  #else
+    #define GX_ERROR_DLADDR 0
+  #endif
+#elif GX_ERROR_DLADDR
+  #include <dlfcn.h>
+#endif
+
+#ifndef GX_ERROR_SHARED_STACK
+  #define GX_ERROR_SHARED_STACK 0
+#endif
+
 static optional void gx_error_dump_all();
 
 #define if_esys(E)      if( _esys(E)  )
@@ -126,7 +163,15 @@ static optional void gx_error_dump_all();
 
 #define _goto(LBL) goto LBL
 
-#define E_LOG(SEV, ...)  _gx_elog(SEV, #SEV, KV(__VA_ARGS__))
+/// Nothing (including $() arguments) is evaluated unless gx_log_wants(SEV)
+/// and the call site's rate limit (see gx_log.h) lets it through.
+#define E_LOG(SEV, ...)  do {                                    \
+    static gx_log_site _gx_site = GX_LOG_SITE(SEV);              \
+    if(gx_log_wants(SEV) && _gx_log_site_ok(_gx_site)) {         \
+        _gx_elog(SEV, #SEV, KV(__VA_ARGS__));                    \
+        _gx_log_site_done(_gx_site);                             \
+    }                                                            \
+} while(0)
 #define _emergency(...) E_LOG(SEV_EMERGENCY, ##__VA_ARGS__)
 #define _alert(...)     E_LOG(SEV_ALERT,     ##__VA_ARGS__)
 #define _critical(...)  E_LOG(SEV_CRITICAL,  ##__VA_ARGS__)
@@ -146,8 +191,18 @@ static optional void gx_error_dump_all();
     _gx_mark_err_do((errno ? errno : ( _e ? _e : EINVAL )),      \
            __FILE__, __LINE__, __FUNCTION__, EXPR_STR)
 #define _reset_e() errno=0; int _e=0; _gx_error_depth++
-#define _run_e(E)  ({ int _result = rare(E); _gx_error_depth--; \
-        if(!_gx_error_depth && !_result) _clear(); _result; })
+#define _run_e(E)  ({ int _result = rare(E);                     \
+        if(!--_gx_error_depth && !_result) _gx_settle(); _result; })
+#if GX_ERROR_SHARED_STACK
+  #define _gx_settle() _clear()
+#else
+/// Outermost check succeeded- only touches the stack if something's there.
+#define _gx_settle() do {                                        \
+    errno = 0;                                                   \
+    if(rare(_gx_error_cidx | _gx_error_stack[0].error_number))   \
+        _clear();                                                \
+} while(0)
+#endif
 
 #define _esys(E)   ({ _reset_e(); (_run_e(    (int)(E) == -1         )) ? _gx_mrk(#E) : 0; })
 #define _emap(E)   ({ _reset_e(); (_run_e(         (E) == MAP_FAILED )) ? _gx_mrk(#E) : 0; })
@@ -170,6 +225,9 @@ typedef enum gx_error_family {
 
 
 #define GX_ERROR_BACKTRACE_SIZE 5
+#ifndef GX_ERROR_STACK_FRAMES
+  #define GX_ERROR_STACK_FRAMES 16
+#endif
 
 typedef struct gx_error_rpt {
     int         error_number;
@@ -182,18 +240,121 @@ typedef struct gx_error_rpt {
 } __attribute__((__packed__)) gx_error_rpt;
 #define GX_ERROR_REPORT_SIZE ((__SIZEOF_INT__ * 4) + (__SIZEOF_POINTER__ * 3))
 
-// Guarantee these variables are put in the .common section so they are
-// globally shared by the linker without us needing to initialize them
-// anywhere.
+// Guarantee these variables are put in the (thread-local) common section so
+// they are shared by the linker across translation units without us needing
+// to initialize them anywhere- and so each thread reports its own errors.
+// initial-exec keeps each access to a single %fs-relative load/store.
 //
 /// @todo !!! abstract into macro & put in gx.h
+#define _GX_ERROR_TLS __thread __attribute__((tls_model("initial-exec")))
+#if GX_ERROR_SHARED_STACK
 asm ("\n .comm _gx_error_stack,"  _STR(GX_ERROR_REPORT_SIZE * GX_ERROR_BACKTRACE_SIZE) ",8 \n");
 asm ("\n .comm _gx_error_cidx,"   _STR(__SIZEOF_INT__) ",8 \n");
 asm ("\n .comm _gx_error_depth,"  _STR(__SIZEOF_INT__) ",8 \n");
 
-gx_error_rpt _gx_error_stack[GX_ERROR_BACKTRACE_SIZE];
-int          _gx_error_cidx;
-int          _gx_error_depth;
+extern gx_error_rpt               _gx_error_stack[GX_ERROR_BACKTRACE_SIZE];
+extern int                        _gx_error_cidx;
+extern int                        _gx_error_depth;
+#else
+asm ("\n .tls_common _gx_error_stack,"  _STR(GX_ERROR_REPORT_SIZE * GX_ERROR_BACKTRACE_SIZE) ",8 \n");
+asm ("\n .tls_common _gx_error_cidx,"   _STR(__SIZEOF_INT__) ",8 \n");
+asm ("\n .tls_common _gx_error_depth,"  _STR(__SIZEOF_INT__) ",8 \n");
+
+extern _GX_ERROR_TLS gx_error_rpt _gx_error_stack[GX_ERROR_BACKTRACE_SIZE];
+extern _GX_ERROR_TLS int          _gx_error_cidx;
+extern _GX_ERROR_TLS int          _gx_error_depth;
+#endif
+
+#if GX_ERROR_STACK_FRAMES > 0
+asm ("\n .tls_common _gx_error_frames,"  _STR(__SIZEOF_POINTER__ * GX_ERROR_STACK_FRAMES) ",8 \n");
+asm ("\n .tls_common _gx_error_nframes," _STR(__SIZEOF_INT__) ",8 \n");
+extern _GX_ERROR_TLS void        *_gx_error_frames[GX_ERROR_STACK_FRAMES];
+extern _GX_ERROR_TLS int          _gx_error_nframes;
+
+#if defined(__LINUX__) && !defined(__USE_GNU)
+extern int pthread_getattr_np(pthread_t thread, pthread_attr_t *attr);   // Hidden without _GNU_SOURCE
+#endif
+
+/// Top of the calling thread's stack- the frame walk never reads past it.
+static noinline uintptr_t _gx_error_stack_top() {
+    static __thread uintptr_t top = 0;
+    pthread_attr_t            attr;
+    void                     *addr;
+    size_t                    size;
+    if(freq(top)) return top;
+    if(pthread_getattr_np(pthread_self(), &attr)) return 0;
+    if(!pthread_attr_getstack(&attr, &addr, &size)) top = (uintptr_t)addr + size;
+    pthread_attr_destroy(&attr);
+    return top;
+}
+
+/// Frame-pointer walk starting at FP: [fp] = caller's fp, [fp + 1] = return
+/// address. Stops at anything that doesn't look like a frame chain.
+#define _gx_error_capture(FP) do {                                          \
+    uintptr_t _fp  = (uintptr_t)(FP), _top = _gx_error_stack_top(), _next; \
+    int       _n   = 0;                                                     \
+    while(_n < GX_ERROR_STACK_FRAMES && _fp + 2 * sizeof(void *) <= _top) { \
+        void *_ret = ((void **)_fp)[1];                                     \
+        if(!_ret) break;                                                    \
+        _gx_error_frames[_n++] = _ret;                                      \
+        _next = ((uintptr_t *)_fp)[0];                                      \
+        if(_next <= _fp || (_next & (sizeof(void *) - 1))) break;           \
+        _fp = _next;                                                        \
+    }                                                                       \
+    _gx_error_nframes = _n;                                                 \
+} while(0)
+
+/// Raw frames as "0x... 0x..."- cheap, and only meaningful in this process.
+static noinline char *_gx_error_frames_str() {
+    static __thread char buf[GX_ERROR_STACK_FRAMES * 19 + 1];
+    char *p = buf;
+    int   i;
+    buf[0] = '\0';
+    for(i = 0; i < _gx_error_nframes; i++)
+        p += sprintf(p, i ? " %p" : "%p", _gx_error_frames[i]);
+    return buf;
+}
+
+/// Raw frames -> "func+0x1f(/path/module+0x11a6)" (or "/path/module+0x11a6"
+/// when there's no dynamic symbol, or the raw address when there's no
+/// module). Return addresses are backed up one byte so they land on the call.
+/// Result is in a per-thread buffer, cut off after the last frame that fits.
+/// Without GX_ERROR_DLADDR it's raw as-is.
+#if GX_ERROR_DLADDR
+static optional char *gx_error_symbolize(const char *raw) {
+    static __thread char buf[GX_ERROR_STACK_FRAMES * 160];
+    char      *p = buf, *end = buf + sizeof(buf), *next, *last;
+    uintptr_t  addr;
+    Dl_info    info;
+    int        n;
+
+    buf[0] = '\0';
+    while(*raw && p < end - 1) {
+        addr = (uintptr_t)strtoull(raw, &next, 16);
+        if(next == raw) break;
+        raw = next;
+        while(*raw == ' ') raw++;
+        last = p;
+        if(p != buf) *p++ = ' ';
+        if(addr && dladdr((void *)(addr - 1), &info) && info.dli_fname) {
+            if(info.dli_sname)
+                n = snprintf(p, end - p, "%s+0x%lx(%s+0x%lx)", info.dli_sname,
+                             (unsigned long)(addr - 1 - (uintptr_t)info.dli_saddr), info.dli_fname,
+                             (unsigned long)(addr - 1 - (uintptr_t)info.dli_fbase));
+            else
+                n = snprintf(p, end - p, "%s+0x%lx", info.dli_fname,
+                             (unsigned long)(addr - 1 - (uintptr_t)info.dli_fbase));
+        } else n = snprintf(p, end - p, "0x%lx", (unsigned long)addr);
+        if(n < 0 || n >= end - p) { *last = '\0'; break; }  // Doesn't fit- drop it whole
+        p += n;
+    }
+    end[-1] = '\0';
+    return buf;
+}
+#else
+static optional char *gx_error_symbolize(const char *raw) { return (char *)raw; }
+#endif
+#endif
 
 // Purposefully don't inline because it will be rarely called (or, in any case,
 // the code path for it not being called should be the optimized code path) and
@@ -209,6 +370,9 @@ static noinline int _gx_mark_err_do(int error_number, const char *file, int line
     _gx_error_stack[_gx_error_cidx].src_func     = function;
     _gx_error_stack[_gx_error_cidx].src_expr     = expr;
     _gx_error_stack[_gx_error_cidx].chk_level    = _gx_error_depth;
+#if GX_ERROR_STACK_FRAMES > 0
+    if(!_gx_error_cidx) _gx_error_capture(__builtin_frame_address(0));   // Origin of this chain
+#endif
 
     // If you ever want to change this so that it possibly filters out certain
     // errors you can return 0 and the earlier macros will think that no error
@@ -219,39 +383,60 @@ static noinline int _gx_mark_err_do(int error_number, const char *file, int line
 /// Core Error expansion / logging
 /// @note _gx_log call does $reset so be careful trying to use any values after that (although it'll still probably work...)
 
-#define _EXPAND(IDX)                                                                                \
-    K_type,            "syserr",                                                                    \
-    K_name,            $("SYSERR_%s", syserr_info[_gx_error_stack[IDX].error_number].error_label),  \
-    K_src_file,        _gx_error_stack[IDX].src_file,                                               \
-    K_src_line,        $("%u", _gx_error_stack[IDX].src_line),                                      \
-    K_src_function,    _gx_error_stack[IDX].src_func,                                               \
-    K_src_expression,  _gx_error_stack[IDX].src_expr,                                               \
-    K_err_severity,    $gx_severity(syserr_info[_gx_error_stack[IDX].error_number].error_severity), \
-    K_err_family,      $gx_error_family(ERRF_SYSERR),                                               \
-    K_err_number,      $("%u", _gx_error_stack[IDX].error_number),                                  \
-    K_err_label,       syserr_info[_gx_error_stack[IDX].error_number].error_label,                  \
-    K_err_msg,         syserr_info[_gx_error_stack[IDX].error_number].error_msg
+#define _EXPAND(IDX)                                                                    \
+    K_type,            "syserr",                                                        \
+    K_name,            $("SYSERR_%s", syserr_info[stk[IDX].error_number].error_label),  \
+    K_src_file,        stk[IDX].src_file,                                               \
+    K_src_line,        $u(stk[IDX].src_line),                                           \
+    K_src_function,    stk[IDX].src_func,                                               \
+    K_src_expression,  stk[IDX].src_expr,                                               \
+    K_err_severity,    $gx_severity(syserr_info[stk[IDX].error_number].error_severity), \
+    K_err_family,      $gx_error_family(ERRF_SYSERR),                                   \
+    K_err_number,      $u(stk[IDX].error_number),                                       \
+    K_err_label,       syserr_info[stk[IDX].error_number].error_label,                  \
+    K_err_msg,         syserr_info[stk[IDX].error_number].error_msg
+
+/// Each report in a chain gets its own copy of the caller's extra kv args.
+#define _ELOG_ONE(...) do {                                                                         \
+    if(argc > 0) {                                                                                  \
+        va_list _ap;                                                                                \
+        va_copy(_ap, argv);                                                                         \
+        _gx_log(sev, ssev, argc, &_ap, __VA_ARGS__);                                                \
+        va_end(_ap);                                                                                \
+    } else _gx_log(sev, ssev, 0, NULL, __VA_ARGS__);                                                \
+} while(0)
 
 static noinline void _gx_elog(gx_severity sev, char *ssev, int argc, ...)
 {
     int     i;
     va_list argv;
+    char   *estk = NULL;   // Native stack of the origin report (stack[0])
+    gx_error_rpt stk[GX_ERROR_BACKTRACE_SIZE];
+    // Logging can make checked calls of its own (the async ring's first
+    // allocation, ...) whose success would clear the live stack mid-report.
+    memcpy(stk, _gx_error_stack, sizeof(stk));
     if(argc > 0) va_start(argv, argc);
-    if(rare(_gx_error_stack[1].error_number)) {
+#if GX_ERROR_STACK_FRAMES > 0
+    if(_gx_error_nframes) {
+        estk = _gx_error_frames_str();
+        if(!_gx_log_async_hook) estk = gx_error_symbolize(estk);   // Else the drainer does it
+    }
+#endif
+    if(rare(stk[1].error_number)) {
         // Several errors to report, all "linked" to the last one
         //char *egrp = $("%u", cpu_ts);
-        static char egroup[64];
+        static __thread char egroup[64];
         char *egrp = _gx_cpu_ts_str(egroup, cpu_ts);
         for(i=0; i < GX_ERROR_BACKTRACE_SIZE; i++) {
-            if(_gx_error_stack[i].error_number) {
-                char *edpth = $("%u", _gx_error_stack[i].chk_level);
-                if(argc > 0) _gx_log(sev, ssev, argc, &argv, _EXPAND(i), K_err_depth, edpth, K_err_group, egrp);
-                else         _gx_log(sev, ssev, 0,    NULL,  _EXPAND(i), K_err_depth, edpth, K_err_group, egrp);
+            if(stk[i].error_number) {
+                char *edpth = $u(stk[i].chk_level);
+                if(i == 0 && estk) _ELOG_ONE(_EXPAND(i), K_err_depth, edpth, K_err_group, egrp, K_err_stack, estk);
+                else               _ELOG_ONE(_EXPAND(i), K_err_depth, edpth, K_err_group, egrp);
             } else break;
         }
-    } else if(freq(_gx_error_stack[0].error_number)) {
-        if(argc > 0) _gx_log(sev, ssev, argc, &argv, _EXPAND(0));
-        else         _gx_log(sev, ssev, 0,    NULL,  _EXPAND(0));
+    } else if(freq(stk[0].error_number)) {
+        if(estk) _ELOG_ONE(_EXPAND(0), K_err_stack, estk);
+        else     _ELOG_ONE(_EXPAND(0));
     } else {
         /// @todo do something clever here- there are no errors to report
     }
@@ -261,6 +446,7 @@ static noinline void _gx_elog(gx_severity sev, char *ssev, int argc, ...)
     }
 }
 #undef _EXPAND
+#undef _ELOG_ONE
 
 
 /// Primarily a debugging tool, orthogonal to the normal errors/logging. You can probably ignore it.
@@ -39,6 +39,11 @@
  *   - ( <name>_rb_pool           - gx_rb_pool pointer                   )
  *   - ( <name>_acceptor_fd       - if specified, the fd for the listener)
  *
+ *   To size expected-sessions from real traffic, build with -DGX_POOL_STATS
+ *   and call gx_tcp_sess_pool_dump(<name>_sess_pool_inst) at shutdown- the
+ *   in_use_peak / extends counters show whether the pool had to grow.
+ *   -DGX_POOL_TRACE also lists sessions that were never released.
+ *
  *
  * Lower-level
  * --------------------
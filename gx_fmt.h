@@ -0,0 +1,293 @@
+/**
+  Number -> text without printf: integers, hex, pointers and doubles.
+
+  Everything writes its digits at out and returns how many- no terminator,
+  and out needs GX_FMT_MAX bytes of room (enough for any of them, plus a
+  terminator if you want one). That's what lets $d/$u/$x/$f/$p in
+  gx_string.h write straight into the $() arena the logger stages its
+  values in, instead of snprintf'ing.
+
+  Decimal integers count their digits first (a clz and one table compare),
+  then fill from the right two digits at a time from a 200-byte digit-pair
+  table- no temporary, no reversing. Hex is a clz and a nibble per digit.
+
+  Doubles are the shortest digits that read back (strtod) to exactly the
+  same double- Ryu (Ulf Adams, PLDI 2018), so 0.1 is "0.1" and not %g's
+  "0.1" / %.17g's "0.10000000000000001", while still never losing a bit.
+  Its two 128-bit power-of-5 tables (~10KB) are computed exactly on first
+  use with a small bignum rather than carried here as constants. Layout
+  is JavaScript's Number.toString: plain digits for 1e-6 <= |x| < 1e21,
+  otherwise d.ddde+N / d.ddde-N; "-0", "inf", "-inf" and "nan" as printf
+  has them. A float passed here is promoted, so gets a double's digits.
+
+  | function                  | writes                                            |
+  | ------------------------- | ------------------------------------------------- |
+  | gx_fmt_u64(out, v)        | v in decimal (== %PRIu64)                          |
+  | gx_fmt_i64(out, v)        | v in decimal (== %PRId64)                          |
+  | gx_fmt_hex(out, v)        | v in lowercase hex, no prefix (== %PRIx64)         |
+  | gx_fmt_ptr(out, p)        | 0x-prefixed hex, "(nil)" for NULL (== glibc's %p)  |
+  | gx_fmt_double(out, d)     | Shortest round-tripping decimal (see above)       |
+  | gx_fmt_u64_len(v)         | Decimal digits in v, 1-20                         |
+
+  Comes in with gx.h (via gx_string.h). Needs unsigned __int128 for the
+  double path; without it gx_fmt_double falls back to the shortest of
+  %.15g / %.16g / %.17g that reads back.
+*/
+#ifndef _GX_FMT_H
+#define _GX_FMT_H
+
+#define GX_FMT_MAX 32
+
+static const char _gx_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t _gx_fmt_pow10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL};
+
+/// bits * log10(2) (1233 / 4096) is the digit count or one under it. (v | 1 so
+/// 0 counts as 1- the only odd power of 10.)
+static optional inline int gx_fmt_u64_len(uint64_t v) {
+    int t = (64 - __builtin_clzll(v | 1)) * 1233 >> 12;
+    return t + ((v | 1) >= _gx_fmt_pow10[t]);
+}
+
+static optional inline size_t gx_fmt_u64(char *out, uint64_t v) {
+    size_t n = (size_t)gx_fmt_u64_len(v);
+    char  *p = out + n;
+    for(; v >= 100; v /= 100) { p -= 2; memcpy(p, _gx_digit_pairs + v % 100 * 2, 2); }
+    if(v >= 10) memcpy(p - 2, _gx_digit_pairs + v * 2, 2);
+    else p[-1] = '0' + (char)v;
+    return n;
+}
+
+static optional inline size_t gx_fmt_i64(char *out, int64_t v) {
+    if(v >= 0) return gx_fmt_u64(out, (uint64_t)v);
+    *out = '-';
+    return 1 + gx_fmt_u64(out + 1, -(uint64_t)v);
+}
+
+static optional inline size_t gx_fmt_hex(char *out, uint64_t v) {
+    size_t n = (size_t)(67 - __builtin_clzll(v | 1)) / 4;
+    char  *p = out + n;
+    do { *--p = "0123456789abcdef"[v & 15]; v >>= 4; } while(v);
+    return n;
+}
+
+static optional inline size_t gx_fmt_ptr(char *out, const void *ptr) {
+    if(rare(!ptr)) { memcpy(out, "(nil)", 5); return 5; }
+    out[0] = '0'; out[1] = 'x';
+    return 2 + gx_fmt_hex(out + 2, (uint64_t)(uintptr_t)ptr);
+}
+
+//-----------------------------------------------------------------------------
+// Doubles- Ryu's d2d, with its tables built once by _gx_fmt_tables_init.
+#if defined(__SIZEOF_INT128__)
+
+#define _GX_FMT_POW5_BITS  125
+#define _GX_FMT_POW5_N     326              ///< 5^i,  i < 326: shifted to 125 bits
+#define _GX_FMT_POW5I_N    342              ///< 5^-q, q < 342: 2^(bits + 124) / 5^q, rounded up
+#define _GX_FMT_BIG_WORDS  32               ///< 1024-bit scratch- 5^325 and 2^1000 fit
+
+static uint64_t       _gx_fmt_pow5[_GX_FMT_POW5_N][2];     ///< [low 64, high 64]
+static uint64_t       _gx_fmt_pow5_inv[_GX_FMT_POW5I_N][2];
+static int            _gx_fmt_ready = 0;
+static pthread_once_t _gx_fmt_once  = PTHREAD_ONCE_INIT;
+
+/// Bits in 5^e (1 for e == 0); log10(2^e) and log10(5^e), all floored.
+static inline int32_t _gx_fmt_pow5bits(int32_t e) { return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1; }
+static inline int32_t _gx_fmt_log10p2(int32_t e)  { return (int32_t)(((uint32_t)e * 78913) >> 18); }
+static inline int32_t _gx_fmt_log10p5(int32_t e)  { return (int32_t)(((uint32_t)e * 732923) >> 20); }
+
+/// The 128 bits of bignum w starting at bit `from` (negative: shifted up).
+static void _gx_fmt_big_take(const uint32_t *w, int from, uint64_t out[2]) {
+    uint32_t part[4];
+    int      k;
+    for(k = 0; k < 4; k++) {
+        int      b  = from + 32 * k, q = b >> 5, r = b & 31;
+        uint64_t lo = q >= 0 && q < _GX_FMT_BIG_WORDS ? w[q] : 0;
+        uint64_t hi = q + 1 >= 0 && q + 1 < _GX_FMT_BIG_WORDS ? w[q + 1] : 0;
+        part[k] = (uint32_t)((hi << 32 | lo) >> r);
+    }
+    out[0] = part[0] | (uint64_t)part[1] << 32;
+    out[1] = part[2] | (uint64_t)part[3] << 32;
+}
+
+/// Both tables, exactly: 5^i by repeated * 5, and floor(2^1000 / 5^q) by
+/// repeated / 5 (floor of a floor is the floor of the whole quotient).
+static void _gx_fmt_tables_init(void) {
+    uint32_t big[_GX_FMT_BIG_WORDS] = {1};
+    uint64_t c;
+    int      i, k;
+    for(i = 0; i < _GX_FMT_POW5_N; i++) {
+        _gx_fmt_big_take(big, _gx_fmt_pow5bits(i) - _GX_FMT_POW5_BITS, _gx_fmt_pow5[i]);
+        for(c = 0, k = 0; k < _GX_FMT_BIG_WORDS; k++) {
+            c      += (uint64_t)big[k] * 5;
+            big[k]  = (uint32_t)c;
+            c     >>= 32;
+        }
+    }
+    memset(big, 0, sizeof(big));
+    big[1000 / 32] = 1u << (1000 % 32);
+    for(i = 0; i < _GX_FMT_POW5I_N; i++) {
+        uint64_t *e = _gx_fmt_pow5_inv[i];
+        _gx_fmt_big_take(big, 1000 - (_gx_fmt_pow5bits(i) - 1 + _GX_FMT_POW5_BITS), e);
+        e[1] += !++e[0];
+        for(c = 0, k = _GX_FMT_BIG_WORDS - 1; k >= 0; k--) {
+            c       = c << 32 | big[k];
+            big[k]  = (uint32_t)(c / 5);
+            c      %= 5;
+        }
+    }
+    __atomic_store_n(&_gx_fmt_ready, 1, __ATOMIC_RELEASE);
+}
+
+static inline uint64_t _gx_fmt_mulshift(uint64_t m, const uint64_t *mul, int32_t j) {
+    unsigned __int128 b0 = (unsigned __int128)m * mul[0];
+    unsigned __int128 b2 = (unsigned __int128)m * mul[1];
+    return (uint64_t)(((b0 >> 64) + b2) >> (j - 64));
+}
+
+static inline int _gx_fmt_pow5_factor(uint64_t v) {
+    int n = 0;
+    for(; v % 5 == 0; v /= 5) n++;
+    return n;
+}
+
+/// IEEE fields -> shortest decimal mantissa * 10^exponent in the rounding
+/// interval (Ryu steps 1-4; the names are the paper's).
+static void _gx_fmt_d2d(uint64_t ieee_m, uint32_t ieee_e, uint64_t *out_m, int32_t *out_e) {
+    int32_t  e2, e10, removed = 0;
+    uint64_t m2, mv, vr, vp, vm;
+    uint32_t mm_shift;
+    int      even, vm_tz = 0, vr_tz = 0, last = 0;
+
+    if(ieee_e == 0) { e2 = 1 - 1023 - 52 - 2; m2 = ieee_m; }
+    else            { e2 = (int32_t)ieee_e - 1023 - 52 - 2; m2 = 1ULL << 52 | ieee_m; }
+    even     = !(m2 & 1);
+    mv       = 4 * m2;
+    mm_shift = ieee_m != 0 || ieee_e <= 1;
+
+    if(e2 >= 0) {
+        int32_t q = _gx_fmt_log10p2(e2) - (e2 > 3);
+        int32_t i = -e2 + q + _GX_FMT_POW5_BITS + _gx_fmt_pow5bits(q) - 1;
+        e10 = q;
+        vr  = _gx_fmt_mulshift(4 * m2,                _gx_fmt_pow5_inv[q], i);
+        vp  = _gx_fmt_mulshift(4 * m2 + 2,            _gx_fmt_pow5_inv[q], i);
+        vm  = _gx_fmt_mulshift(4 * m2 - 1 - mm_shift, _gx_fmt_pow5_inv[q], i);
+        if(q <= 21) {
+            if(mv % 5 == 0)  vr_tz = _gx_fmt_pow5_factor(mv) >= q;
+            else if(even)    vm_tz = _gx_fmt_pow5_factor(mv - 1 - mm_shift) >= q;
+            else             vp   -= _gx_fmt_pow5_factor(mv + 2) >= q;
+        }
+    } else {
+        int32_t q = _gx_fmt_log10p5(-e2) - (-e2 > 1);
+        int32_t i = -e2 - q;
+        int32_t j = q - (_gx_fmt_pow5bits(i) - _GX_FMT_POW5_BITS);
+        e10 = q + e2;
+        vr  = _gx_fmt_mulshift(4 * m2,                _gx_fmt_pow5[i], j);
+        vp  = _gx_fmt_mulshift(4 * m2 + 2,            _gx_fmt_pow5[i], j);
+        vm  = _gx_fmt_mulshift(4 * m2 - 1 - mm_shift, _gx_fmt_pow5[i], j);
+        if(q <= 1) {
+            vr_tz = 1;
+            if(even) vm_tz = mm_shift == 1;
+            else     vp--;
+        } else if(q < 63) vr_tz = !(mv & ((1ULL << q) - 1));
+    }
+
+    if(rare(vm_tz || vr_tz)) {
+        // Exact ties possible (~0.7%)- track trailing zeros on the way down
+        for(; vp / 10 > vm / 10; removed++) {
+            vm_tz &= vm % 10 == 0;
+            vr_tz &= last == 0;
+            last   = (int)(vr % 10);
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        if(vm_tz) for(; vm % 10 == 0; removed++) {
+            vr_tz &= last == 0;
+            last   = (int)(vr % 10);
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        if(vr_tz && last == 5 && vr % 2 == 0) last = 4;      // Round half to even
+        *out_m = vr + ((vr == vm && (!even || !vm_tz)) || last >= 5);
+    } else {
+        int up = 0;
+        if(vp / 100 > vm / 100) {                            // Two at a time (~86%)
+            up = vr % 100 >= 50;
+            vr /= 100; vp /= 100; vm /= 100;
+            removed += 2;
+        }
+        for(; vp / 10 > vm / 10; removed++) {
+            up = vr % 10 >= 5;
+            vr /= 10; vp /= 10; vm /= 10;
+        }
+        *out_m = vr + (vr == vm || up);
+    }
+    *out_e = e10 + removed;
+}
+
+#endif
+
+static optional size_t gx_fmt_double(char *out, double d) {
+    uint64_t bits, m;
+    char    *p = out;
+    int32_t  e;
+    int      n, pt;
+
+    memcpy(&bits, &d, sizeof(bits));
+    if(bits >> 63) *p++ = '-';
+    if(rare((bits >> 52 & 0x7ff) == 0x7ff)) {
+        memcpy(p, bits << 12 ? "nan" : "inf", 3);
+        return (size_t)(p + 3 - out);
+    }
+    if(rare(!(bits << 1))) { *p = '0'; return (size_t)(p + 1 - out); }
+
+#if defined(__SIZEOF_INT128__)
+    if(rare(!__atomic_load_n(&_gx_fmt_ready, __ATOMIC_ACQUIRE))) pthread_once(&_gx_fmt_once, _gx_fmt_tables_init);
+    _gx_fmt_d2d(bits & ((1ULL << 52) - 1), (uint32_t)(bits >> 52 & 0x7ff), &m, &e);
+#else
+    {
+        char   tmp[GX_FMT_MAX], *t;
+        double a = d < 0 ? -d : d;
+        for(n = 15; n < 17; n++) { snprintf(tmp, sizeof(tmp), "%.*e", n - 1, a); if(strtod(tmp, NULL) == a) break; }
+        snprintf(tmp, sizeof(tmp), "%.*e", n - 1, a);
+        for(m = 0, t = tmp; *t != 'e'; t++) if(*t != '.') m = m * 10 + (uint64_t)(*t - '0');
+        e = (int32_t)strtol(t + 1, NULL, 10) - (n - 1);
+        for(; m % 10 == 0; m /= 10) e++;
+    }
+#endif
+
+    // m * 10^e, n digits: the point goes pt digits in from the left
+    n  = gx_fmt_u64_len(m);
+    pt = n + e;
+    if(pt >= n && pt <= 21) {                                // 1500000
+        p += gx_fmt_u64(p, m);
+        memset(p, '0', (size_t)(pt - n));
+        p += pt - n;
+    } else if(pt > 0 && pt <= 21) {                          // 1.5
+        gx_fmt_u64(p + 1, m);
+        memmove(p, p + 1, (size_t)pt);
+        p[pt] = '.';
+        p += n + 1;
+    } else if(pt > -6 && pt <= 0) {                          // 0.0015
+        p[0] = '0'; p[1] = '.';
+        memset(p + 2, '0', (size_t)-pt);
+        p += 2 - pt;
+        p += gx_fmt_u64(p, m);
+    } else {                                                 // 1.5e+300
+        gx_fmt_u64(p + 1, m);
+        p[0] = p[1];
+        if(n > 1) { p[1] = '.'; p += n + 1; }
+        else p += 1;
+        *p++ = 'e';
+        *p++ = pt - 1 < 0 ? '-' : '+';
+        p += gx_fmt_u64(p, (uint64_t)(pt - 1 < 0 ? 1 - pt : pt - 1));
+    }
+    return (size_t)(p - out);
+}
+
+#endif
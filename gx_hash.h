@@ -0,0 +1,158 @@
+/**
+  Fast non-cryptographic 64-bit hashing for hash tables, sharding etc.
+
+  gx_hash64 is CrapWow64- http://www.team5150.com/~andrew/noncryptohashzoo/CrapWow64.html
+  (unknown license; close to ideal lack of collisions and very fast). It used
+  to be hand-written x86-64 asm in gx_token.h- this is plain C with identical
+  output on every platform (the compiler turns each fold into one mul/mulx).
+
+  Every 16 bytes are folded in as two 64x64->128 multiplies whose halves are
+  xor'd into the two accumulators, and the length and seed only enter at the
+  start- as an xor into one accumulator and a sum into the other. Since
+  nothing but xors touch the accumulators until the end, the streaming form
+  can start from zero and fold the length in at _final() when it knows it-
+  so it gives exactly the same value as the one-shot call.
+
+  The same structure means whole 16-byte blocks commute: swapping two
+  aligned blocks of a key doesn't change its hash. Fine for table keys and
+  sharding, but not for anything where a peer controls the input and
+  collisions matter (use sha2 / a keyed MAC there).
+
+  | function / macro                    | description                                        |
+  | ----------------------------------- | -------------------------------------------------- |
+  | gx_hash64(key, len, seed)           | One-shot hash                                      |
+  | gx_hash64_init(&st, seed)           | Start a streaming hash                             |
+  | gx_hash64_update(&st, data, len)    | Add any number of bytes                            |
+  | gx_hash64_final(&st)                | Same value gx_hash64 would give for all the bytes  |
+  | gx_hash64_n(keys, lens, n, seed, out) | Many (short) keys at once                         |
+
+  Example:
+
+      uint64_t shard = gx_hash64(user, strlen(user), 0) % nshards;
+
+      gx_hash64_state st;
+      gx_hash64_init(&st, 0);
+      while((n = read(fd, buf, sizeof(buf))) > 0) gx_hash64_update(&st, buf, n);
+      uint64_t h = gx_hash64_final(&st);
+*/
+#ifndef _GX_HASH_H
+#define _GX_HASH_H
+
+#include "./gx.h"
+#include "./gx_endian.h"
+
+#define _GX_CW_M 0x95b47aa3355ba1a1ULL
+#define _GX_CW_N 0x8a970be7488fda55ULL
+
+typedef struct gx_hash64_state {
+    uint64_t h, k;                       ///< Accumulators, minus the length/seed terms
+    uint64_t seed;
+    uint64_t len;                        ///< Bytes so far
+    uint8_t  buf[16];                    ///< Partial block
+    unsigned used;                       ///< Bytes in buf
+} gx_hash64_state;
+
+/// LO ^= low half, HI ^= high half of A * B.
+#if defined(__SIZEOF_INT128__)
+  #define _gx_cw_fold(A, B, LO, HI) do {                               \
+      unsigned __int128 _p = (unsigned __int128)(A) * (B);             \
+      (LO) ^= (uint64_t)_p; (HI) ^= (uint64_t)(_p >> 64);              \
+  } while(0)
+#else
+  #define _gx_cw_fold(A, B, LO, HI) do {                               \
+      uint64_t _a = (A), _b = (B);                                     \
+      uint64_t _ll = (_a & 0xffffffff) * (_b & 0xffffffff);            \
+      uint64_t _lh = (_a & 0xffffffff) * (_b >> 32);                   \
+      uint64_t _hl = (_a >> 32) * (_b & 0xffffffff);                   \
+      uint64_t _mid = (_ll >> 32) + (_lh & 0xffffffff) + (_hl & 0xffffffff); \
+      (LO) ^= (_ll & 0xffffffff) | (_mid << 32);                       \
+      (HI) ^= (_a >> 32) * (_b >> 32) + (_lh >> 32) + (_hl >> 32) + (_mid >> 32); \
+  } while(0)
+#endif
+#define _gx_cw_mixa(IN, H, K) _gx_cw_fold(IN, _GX_CW_M, K, H)
+#define _gx_cw_mixb(IN, H, K) _gx_cw_fold(IN, _GX_CW_N, H, K)
+
+static inline uint64_t _gx_hash_ld64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return gx_bytes_BE ? bswap64(v) : v;
+}
+
+static inline uint32_t _gx_hash_ld32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return gx_bytes_BE ? bswap32(v) : v;
+}
+
+/// 1-7 bytes, little-endian, without reading past p + n (overlapping loads).
+static inline uint64_t _gx_hash_tail(const uint8_t *p, size_t n) {
+    if(n >= 4) return _gx_hash_ld32(p) | (uint64_t)_gx_hash_ld32(p + n - 4) << ((n - 4) * 8);
+    return p[0] | (uint64_t)p[n / 2] << (n / 2 * 8) | (uint64_t)p[n - 1] << ((n - 1) * 8);
+}
+
+/// Whatever is left after the 16-byte blocks (< 16 bytes), then the final mix.
+static inline uint64_t _gx_hash64_finish(const uint8_t *p, size_t rem, uint64_t h, uint64_t k) {
+    if(rem & 8) { _gx_cw_mixb(_gx_hash_ld64(p), h, k); p += 8; }
+    if(rem & 7) _gx_cw_mixa(_gx_hash_tail(p, rem & 7), h, k);
+    _gx_cw_mixb(h ^ (k + _GX_CW_N), h, k);
+    return k ^ h;
+}
+
+static optional inline uint64_t gx_hash64(const void *key, uint64_t len, uint64_t seed) {
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t       h = len, k = len + seed + _GX_CW_N, n;
+    for(n = len / 16; n; n--, p += 16) {
+        _gx_cw_mixb(_gx_hash_ld64(p),     h, k);
+        _gx_cw_mixa(_gx_hash_ld64(p + 8), h, k);
+    }
+    return _gx_hash64_finish(p, len % 16, h, k);
+}
+
+//-----------------------------------------------------------------------------
+static optional inline void gx_hash64_init(gx_hash64_state *st, uint64_t seed) {
+    st->h = st->k = st->len = 0;
+    st->used = 0;
+    st->seed = seed;
+}
+
+static optional inline void gx_hash64_update(gx_hash64_state *st, const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    uint64_t       h = st->h, k = st->k;
+    size_t         take;
+    st->len += len;
+    if(st->used) {
+        take = min(len, (size_t)(16 - st->used));
+        memcpy(st->buf + st->used, p, take);
+        st->used += take; p += take; len -= take;
+        if(st->used < 16) return;
+        _gx_cw_mixb(_gx_hash_ld64(st->buf),     h, k);
+        _gx_cw_mixa(_gx_hash_ld64(st->buf + 8), h, k);
+        st->used = 0;
+    }
+    for(; len >= 16; len -= 16, p += 16) {
+        _gx_cw_mixb(_gx_hash_ld64(p),     h, k);
+        _gx_cw_mixa(_gx_hash_ld64(p + 8), h, k);
+    }
+    memcpy(st->buf, p, len);
+    st->used = len;
+    st->h = h; st->k = k;
+}
+
+static optional inline uint64_t gx_hash64_final(const gx_hash64_state *st) {
+    return _gx_hash64_finish(st->buf, st->used, st->h ^ st->len, st->k ^ (st->len + st->seed + _GX_CW_N));
+}
+
+//-----------------------------------------------------------------------------
+/// Batch: out[i] = gx_hash64(keys[i], lens[i], seed). The keys are
+/// independent, so their multiplies overlap in the pipeline- ~2ns per short
+/// key here.
+///
+/// (Deliberately not SIMD: without a 64x64->128 vector multiply every fold
+/// is four vpmuludq plus carry fixups per lane, and an AVX2 4-lane version
+/// measured ~3x slower than this loop on 4-16 byte keys.)
+static optional inline void gx_hash64_n(const void *const *keys, const size_t *lens, size_t n, uint64_t seed, uint64_t *out) {
+    size_t i;
+    for(i = 0; i < n; i++) out[i] = gx_hash64(keys[i], lens[i], seed);
+}
+
+#endif
@@ -52,7 +52,7 @@
      | msg             | log    | Brief message / description / note    | publishing went live.         |
      | report          | log    | Multiline formatted report or data    | payload hexdump: %n 0x1289... |
 
-     | time*           | all    | UTC iso8601 formatted time of report  | 2012-09-17T09:49Z             |
+     | time*           | all    | UTC iso8601 formatted time of report  | 2012-09-17T09:49:02.123456789Z |
      | ticks*          | all    | Current CPU ticks                     | 28912                         |
      | host*           | all    |                                       | dev6.justin.tv                |
      | program*        | all    |                                       | imbibe                        |
@@ -74,7 +74,7 @@
      | err_group*      | error  | guid that associates several reports  | w839u21                       |
      | err_number^     | error  | Depends on error class- usually errno | 17                            |
      | src_expression* | error  | Expression that triggered error       | open(filename, "r+")          |
-     | err_stack*      | error  | multiline msg w/ stack trace info     | (nyi)                         |
+     | err_stack*      | error  | native stack of the origin error      | f+0x1f(/bin/x+0x11a6) ...     |
 
      | (ad-hoc pairs)  | all    | Misc adhoc key/value pair assoc. data | desired_file=somefile.txt     |
 
@@ -200,6 +200,7 @@
 
 #include "./gx.h"
 #include "./gx_string.h"
+#include "./gx_time.h"
 #include "./gxe/gx_enum_lookups.h"
 #include <time.h>
 #include <sys/uio.h>
@@ -283,12 +284,14 @@ typedef enum gx_severity {
 #define gx_log_set(KEY, VALUE)     _gx_log_set_inner(KEY,    VALUE)
 
 
-/// Some static variables that hold state for some system key/value entries
+/// Some static variables that hold state for some system key/value entries.
+/// Everything a single log call stages or formats into is thread-local so
+/// threads can log concurrently without locking. The *_master tables (and so
+/// gx_log_set etc.) are shared- set those up before starting threads.
 static const char * (*_gx_log_keystr)(int);
-static uint16_t       _gx_log_time_len   = 3;
-static char           _gx_log_time[256]  = {0};
-static unsigned int   _gx_log_last_tick  = 0;
-static gx_strbuf      _gx_log_sysinfo    = {{0},NULL};
+static __thread gx_time_isostr _gx_log_time;          ///< K_sys_time, rewritten incrementally
+static gx_strbuf             _gx_log_sysinfo    = {.p = NULL};
+static unsigned int          _gx_log_master_gen = 0;  ///< Bumped on every gx_log_set()
 
 static char _GX_NULLSTRING[] = "";
 
@@ -320,8 +323,8 @@ typedef struct _gx_kv {
 /// @param msg_tab_master       used to clear/default the msg_iov.msg_tab below
 #include "./gxe/gx_log_table.h"
 
-static kv_head_t _key_sizes[KV_ENTRIES];     ///< Key header + payload sizes
-static kv_head_t _val_sizes[KV_ENTRIES];     ///< Val header + payload sizes
+static __thread kv_head_t _key_sizes[KV_ENTRIES];     ///< Key header + payload sizes
+static __thread kv_head_t _val_sizes[KV_ENTRIES];     ///< Val header + payload sizes
 static unsigned int curr_adhoc_offset = ADHOC_OFFSET; ///< Changes as "semi-permanent" k/v pairs are added/removed
 
 typedef struct kv_msg_iov {
@@ -337,14 +340,9 @@ typedef struct gx_logger {
     gx_severity    min_severity;
 } gx_logger;
 
-#define GX_NUM_STD_LOGGERS 3
+#define GX_NUM_STD_LOGGERS 4
 static gx_logger gx_loggers[GX_NUM_STD_LOGGERS];
 
-/// Standard loggers... don't really need this more configurable at the moment...
-#include "./gxe/log_stderr.h"
-#include "./gxe/log_syslogd.h"
-#include "./gxe/log_mq.h"
-
 #ifndef GX_SEV_STDERR
 #define GX_SEV_STDERR SEV_DEBUG
 #endif
@@ -355,12 +353,38 @@ static gx_logger gx_loggers[GX_NUM_STD_LOGGERS];
 #define GX_SEV_MQUEUE SEV_DEBUG
 #endif
 
-static gx_logger gx_loggers[3] = {
-    {1, &log_stderr,  GX_SEV_STDERR},
-//    {1, &log_syslogd, GX_SEV_SYSLOG},
-//    {1, &log_mq,      GX_SEV_MQUEUE}
-};
+/// Early-out filtering. Checked before a log call evaluates any of its
+/// arguments, so a disabled level costs one predictable branch:
+///   - GX_LOG_SEV_MAX   least severe level compiled in at all (constant-folds
+///                      the whole call away for anything less severe)
+///   - _gx_log_sevmask  a bit per severity that at least one enabled logger
+///                      wants. Recompute with gx_log_update_sevmask() after
+///                      changing gx_loggers by hand (gx_log_enable/disable do it).
+#ifndef GX_LOG_SEV_MAX
+#define GX_LOG_SEV_MAX SEV_DEBUG
+#endif
+#define _GX_SEVBITS(MINSEV)       ((2U << (MINSEV)) - 1)
+#define gx_log_wants(SEV)         ((SEV) <= GX_LOG_SEV_MAX && ((_gx_log_sevmask >> (SEV)) & 1))
+#define gx_log_enable(IDX,MINSEV) do {                                         \
+    gx_loggers[IDX].min_severity = (MINSEV);                                   \
+    gx_loggers[IDX].enabled      = 1;                                          \
+    gx_log_update_sevmask();                                                   \
+} while(0)
+#define gx_log_disable(IDX)       do {                                         \
+    gx_loggers[IDX].enabled      = 0;                                          \
+    gx_log_update_sevmask();                                                   \
+} while(0)
+
+static unsigned int _gx_log_sevmask = _GX_SEVBITS(GX_SEV_STDERR); ///< Only stderr starts enabled
 
+static optional void gx_log_update_sevmask() {
+    unsigned int mask = 0;
+    int          i;
+    for(i = 0; i < GX_NUM_STD_LOGGERS; i++)
+        if(gx_loggers[i].enabled && gx_loggers[i].logger_function)
+            mask |= _GX_SEVBITS(gx_loggers[i].min_severity);
+    _gx_log_sevmask = mask;
+}
 
 /// Number of iov-elements in a "flattened" kv_msg_iov:
 /// ((message-table-entries + main-tail) * iovs-per-_gx_kv) + main-head
@@ -369,11 +393,28 @@ static gx_logger gx_loggers[3] = {
 /// msg_iov static variable as an array of iovecs
 #define MSG_AS_IOV(MSG)  ((struct iovec *)&(MSG))
 
-static const kv_head_t kv_head_empty = (kv_head_t)(1 + sizeof(kv_head_t));
-static kv_main_head_t  kv_main_head  = 0;
+/// Standard loggers... don't really need this more configurable at the moment...
+#include "./gxe/log_stderr.h"
+#include "./gxe/log_syslogd.h"
+#include "./gxe/log_mq.h"
+#include "./gxe/log_binary.h"
+
+static gx_logger gx_loggers[GX_NUM_STD_LOGGERS] = {
+    {1, &log_stderr,  GX_SEV_STDERR},
+    {0, &log_syslogd, GX_SEV_SYSLOG},   // Enabled by gx_log_syslog_open()
+    {0, &log_mq,      GX_SEV_MQUEUE},   // Enabled by gx_log_mq_open()
+    {0, &log_binary,  GX_SEV_BINARY}    // Enabled by gx_log_bin_open()
+};
+
+
 
-static kv_msg_iov msg_iov = {
-    .main_head_base = &kv_main_head,
+static const kv_head_t          kv_head_empty = (kv_head_t)(1 + sizeof(kv_head_t));
+static __thread kv_main_head_t  kv_main_head  = 0;
+
+/// Per-thread staging table. main_head_base can't be statically initialized
+/// (the address of a thread-local isn't a constant), so _gx_log_inner sets it.
+static __thread kv_msg_iov msg_iov = {
+    .main_head_base = NULL,
     .main_head_size = sizeof(kv_main_head),
     .main_tail      = {(_iov_base)&kv_head_empty, sizeof(kv_head_empty),
                        (_iov_base)_GX_NULLSTRING, 0x01,
@@ -444,6 +485,7 @@ static kv_msg_iov msg_iov = {
         (_iov_size)(_key_sizes_master[_idx] - sizeof(kv_head_t));              \
     msg_tab_master[_idx].val_data_size      = (_iov_size)_vsize;               \
     msg_tab_master[_idx].val_data_base      = (_iov_base)_val;                 \
+    _gx_log_master_gen ++;                                                     \
 } while(0)
 
 
@@ -452,6 +494,7 @@ static kv_msg_iov msg_iov = {
 static noinline void _gx_log_inner       (gx_severity severity, char *severity_str,
                                            int vparam_count, va_list *vparams, int argc, ...);
 static inline   void _gx_log_dispatch    (gx_severity severity, kv_msg_iov *msg);
+static inline   void _gx_log_dispatch_now(gx_severity severity, kv_msg_iov *msg);
 static inline   void _gx_log_update_host ();
 static inline   void _gx_log_update_pids ();
 static inline   void _gx_log_update_cpuid();
@@ -463,8 +506,8 @@ static inline void _gx_log_update_cpuid() {
 }
 
 static inline void _gx_log_update_pids() {
-    gx_log_set(K_sys_pid,  $S(_gx_log_sysinfo, "%u", getpid ()));
-    gx_log_set(K_sys_ppid, $S(_gx_log_sysinfo, "%u", getppid()));
+    gx_log_set(K_sys_pid,  $Su(_gx_log_sysinfo, getpid ()));
+    gx_log_set(K_sys_ppid, $Su(_gx_log_sysinfo, getppid()));
 }
 
 static inline void _gx_log_update_host() {
@@ -478,8 +521,130 @@ static inline void _gx_log_update_host() {
 #define _gx_log(SEV, SSEV, VPCOUNT, VPARAMS, ...)                              \
     _gx_log_inner(SEV, SSEV, VPCOUNT, VPARAMS, KV(__VA_ARGS__))
 
+/// Per-call-site rate limiting. Every log_*() / E_LOG() expansion gets its
+/// own static token bucket (so it's keyed by file+line for free): up to
+/// GX_LOG_RATE_BURST messages back-to-back, then GX_LOG_RATE_PER_SEC. While a
+/// site has tokens the check is a decrement- the clock is only read once the
+/// bucket is empty. The first message a site lets through after suppressing
+/// some is followed by a "suppressed N similar messages" record at the same
+/// severity; a site that goes quiet instead gets its summary from
+/// gx_log_rate_flush() once its window is over (the async drainer calls it,
+/// otherwise call it from a timer). Buckets aren't locked: a token is taken
+/// with a compare-and-swap that never goes below zero, but threads that find
+/// the bucket empty at the same moment may each refill it- so under
+/// contention up to one extra message per such thread can get through.
+/// Off by default (GX_LOG_RATE_BURST 0 compiles it all out)- define
+/// GX_LOG_RATE_BURST, e.g. 20, before including gx.h to turn it on.
+#ifndef GX_LOG_RATE_BURST
+#define GX_LOG_RATE_BURST   0
+#endif
+#ifndef GX_LOG_RATE_PER_SEC
+#define GX_LOG_RATE_PER_SEC 10
+#endif
+
+typedef struct gx_log_site {
+    uint32_t            tokens;
+    uint32_t            suppressed;
+    uint32_t            report;      ///< Suppressed count waiting to be reported
+    uint64_t            filled_ms;   ///< When tokens was last topped up (0 = never used)
+    gx_severity         sev;         ///< Where the summary goes
+    char               *ssev;
+    const char         *file;
+    const char         *line;
+    struct gx_log_site *next;        ///< _gx_log_sites list
+    int                 listed;
+} gx_log_site;
+
+#define GX_LOG_SITE(SEV) {0, 0, 0, 0, SEV, #SEV, __FILE__, _STR(__LINE__), NULL, 0}
+
+/// Every site that has ever suppressed something (never shrinks- sites are static).
+static gx_log_site * volatile _gx_log_sites optional = NULL;
+
+static inline uint64_t _gx_log_now_ms() {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000 + 1;
+}
+
+/// Bucket is empty (or never used): refill it from the time it was last
+/// full- every token it had has been spent since then.
+static noinline optional int _gx_log_site_refill(gx_log_site *site) {
+    uint64_t now = _gx_log_now_ms();
+    uint64_t add = site->filled_ms ? (now - site->filled_ms) * GX_LOG_RATE_PER_SEC / 1000
+                                   : GX_LOG_RATE_BURST;
+    if(add == 0) {
+        if(rare(!site->listed) && !__sync_lock_test_and_set(&(site->listed), 1)) {
+            do site->next = _gx_log_sites;
+            while(!__sync_bool_compare_and_swap(&_gx_log_sites, site->next, site));
+        }
+        __sync_fetch_and_add(&(site->suppressed), 1);
+        return 0;
+    }
+    __atomic_store_n(&(site->tokens), (uint32_t)min(add, (uint64_t)GX_LOG_RATE_BURST) - 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&(site->filled_ms), now, __ATOMIC_RELAXED);
+    __atomic_store_n(&(site->report), __atomic_exchange_n(&(site->suppressed), 0, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    return 1;
+}
+
+/// Decrement-if-positive- two threads can't both take the last token (and
+/// wrap the bucket around to ~4 billion).
+static inline int _gx_log_site_take(gx_log_site *site) {
+    uint32_t t = __atomic_load_n(&(site->tokens), __ATOMIC_RELAXED);
+    while(freq(t > 0))
+        if(__atomic_compare_exchange_n(&(site->tokens), &t, t - 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            return 1;
+    return 0;
+}
+
+/// After the message itself, so $() strings the caller made are already used.
+static noinline void _gx_log_site_report(gx_log_site *site, uint32_t n) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "suppressed %u similar messages", n);
+    _gx_log(site->sev, site->ssev, 0, NULL, K_msg, msg,
+            K_src_file, (char *)site->file, K_src_line, (char *)site->line);
+}
+
+/// Sends the pending summary of every site whose window is over (it would let
+/// a message through again) but that hasn't logged since. Returns how many.
+static optional int gx_log_rate_flush() {
+    gx_log_site *site;
+    uint64_t     now;
+    uint32_t     n;
+    int          sent = 0;
+    if(GX_LOG_RATE_BURST == 0 || !_gx_log_sites) return 0;
+    now = _gx_log_now_ms();
+    for(site = _gx_log_sites; site != NULL; site = site->next) {
+        if(!site->suppressed || (now - site->filled_ms) * GX_LOG_RATE_PER_SEC < 1000) continue;
+        if((n = __atomic_exchange_n(&(site->suppressed), 0, __ATOMIC_RELAXED))) {
+            _gx_log_site_report(site, n);
+            sent ++;
+        }
+    }
+    return sent;
+}
+
+#define _gx_log_site_ok(SITE)                                                  \
+    (GX_LOG_RATE_BURST == 0 || _gx_log_site_take(&(SITE)) || _gx_log_site_refill(&(SITE)))
+#define _gx_log_site_done(SITE)                                                \
+    if(GX_LOG_RATE_BURST > 0 && rare((SITE).report)) {                         \
+        uint32_t _gx_n = __atomic_exchange_n(&((SITE).report), 0,             \
+                                             __ATOMIC_RELAXED);                \
+        if(_gx_n) _gx_log_site_report(&(SITE), _gx_n);                         \
+    }
+
 /// For now these are mostly for backwards compatibility with the old X_LOG_* macros
-#define _gx_log_msg(SEV,...) _gx_log(SEV, #SEV, 0, NULL, K_msg, $(__VA_ARGS__))
+#define _gx_log_msg(SEV,...) do {                                              \
+    static gx_log_site _gx_site = GX_LOG_SITE(SEV);                            \
+    if(gx_log_wants(SEV) && _gx_log_site_ok(_gx_site)) {                       \
+        _gx_log(SEV, #SEV, 0, NULL, K_msg, $(__VA_ARGS__));                    \
+        _gx_log_site_done(_gx_site);                                           \
+    }                                                                          \
+} while(0)
 #define log_emergency(...)   _gx_log_msg(SEV_EMERGENCY, __VA_ARGS__)
 #define log_alert(...)       _gx_log_msg(SEV_ALERT,     __VA_ARGS__)
 #define log_critical(...)    _gx_log_msg(SEV_CRITICAL,  __VA_ARGS__)
@@ -512,7 +677,7 @@ typedef union _ctick {
     } packed;
 } _ctick;
 
-static char ctick_base64[64];
+static __thread char ctick_base64[64];
 
 static inline char *_gx_cpu_ts_str(char *dest, uint64_t ts) {
     _ctick ctick_transformer;
@@ -530,7 +695,9 @@ static noinline void _gx_log_inner(gx_severity severity, char *severity_str,
     va_list argv;
     int     i;
 
+    if(rare(!gx_log_wants(severity))) return;   // Direct _gx_log() callers- the macros checked already
     memcpy(&msg_iov.msg_tab, &msg_tab_master, sizeofm(kv_msg_iov,msg_tab)); // yes it's fastest
+    msg_iov.main_head_base = &kv_main_head;
 
     int adhoc_idx = curr_adhoc_offset;
 
@@ -551,15 +718,7 @@ static noinline void _gx_log_inner(gx_severity severity, char *severity_str,
 
     if(freq(msg_iov.msg_tab[K_sys_time].val_data_size <= 3)) {
         uint64_t curr_tick = cpu_ts;
-        if(!_gx_log_last_tick || abs(curr_tick - _gx_log_last_tick) > 250000000) {
-            time_t now = time(NULL);
-            struct tm now_tm;
-            gmtime_r(&now, &now_tm);
-            _gx_log_time_len = strftime(_gx_log_time, sizeof(_gx_log_time)-1,
-                    "%Y-%m-%dT%H:%M:%SZ", &now_tm);
-            _gx_log_last_tick = curr_tick;
-        }
-        KV_SET_VAL_L(K_sys_time,  &(_gx_log_time[0]), _gx_log_time_len);
+        KV_SET_VAL_L(K_sys_time,  gx_time_iso(&_gx_log_time, gx_time_ns()), GX_TIME_ISO_LEN);
         KV_SET_VAL  (K_sys_ticks, _gx_cpu_ts_str(ctick_base64, curr_tick));
     }
 
@@ -593,7 +752,17 @@ static noinline void _gx_log_inner(gx_severity severity, char *severity_str,
 #undef _VA_ARG_TO_TBL
 
 
+/// Set by gx_log_async.h (gx_log_async_start) to take staged records off the
+/// calling thread. Returns 0 when it took the record. Like gx_loggers this
+/// is per translation unit.
+static int (*_gx_log_async_hook)(gx_severity, kv_msg_iov *) optional = NULL;
+
 static inline void _gx_log_dispatch(gx_severity severity, kv_msg_iov *msg) {
+    if(rare(_gx_log_async_hook != NULL) && freq(_gx_log_async_hook(severity, msg) == 0)) return;
+    _gx_log_dispatch_now(severity, msg);
+}
+
+static inline void _gx_log_dispatch_now(gx_severity severity, kv_msg_iov *msg) {
     //ssize_t actual_len = writev(STDERR_FILENO, MSG_IOV_IOV, KV_IOV_COUNT);
     int i;
     for(i = 0; i < GX_NUM_STD_LOGGERS; i ++) {
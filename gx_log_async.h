@@ -0,0 +1,332 @@
+/**
+  Asynchronous logging- takes the loggers (writev to stderr etc.) off the
+  calling thread.
+
+  Once gx_log_async_start() has been called, every record that gx_log would
+  have dispatched is instead serialized into a per-thread single-producer /
+  single-consumer ring (gx_rb memory, so a record never has to wrap) and a
+  background thread drains all of the rings, rebuilds each kv_msg_iov and
+  hands it to the normal loggers. A logging thread never blocks on I/O and
+  never takes a lock.
+
+  When a thread's ring is full the policy decides:
+    - GX_LOG_ASYNC_DROP   the record is counted (gx_log_async_dropped()) and
+                          thrown away. The drainer logs a warning with the
+                          running total whenever it goes up.
+    - GX_LOG_ASYNC_BLOCK  the caller spins/yields until the drainer catches up.
+
+  Record layout in a ring (host-endian, 8-byte aligned):
+
+      | u32 len | u8 severity | u8 - | u16 count | count x entry | pad |
+      entry: | u16 idx | u32 keylen | u32 vallen | key | val |
+
+  Only entries that differ from msg_tab_master are stored; keylen is 0
+  except for adhoc keys. Lengths include the NUL.
+
+  K_err_stack arrives as raw return addresses (see gx_error.h) and is
+  symbolized by the drainer, so the erroring thread never pays for dladdr.
+
+  Like gx_loggers, the hook is per translation unit- start it in the one that
+  does the logging (or in each of them).
+
+ | function                        | description                                                  |
+ | ------------------------------- | ------------------------------------------------------------ |
+ | gx_log_async_start(policy,size) | Start the drainer. size = per-thread ring bytes (0=default)  |
+ | gx_log_async_stop()             | Drain everything, stop the drainer, go back to synchronous   |
+ | gx_log_async_flush()            | Wait until everything logged so far has been dispatched      |
+ | gx_log_async_dropped()          | Records dropped so far (GX_LOG_ASYNC_DROP)                   |
+
+*/
+#ifndef GX_LOG_ASYNC_H
+#define GX_LOG_ASYNC_H
+
+#include "./gx.h"
+#include "./gx_error.h"
+#include "./gx_ringbuf.h"
+#include <sched.h>
+
+#define GX_LOG_ASYNC_DROP   0
+#define GX_LOG_ASYNC_BLOCK  1
+
+#ifndef GX_LOG_ASYNC_RING_SIZE
+  #define GX_LOG_ASYNC_RING_SIZE  (1 << 18)
+#endif
+#ifndef GX_LOG_ASYNC_IDLE_MS
+  #define GX_LOG_ASYNC_IDLE_MS    100       ///< Drainer wakes up at least this often
+#endif
+
+typedef struct gx_log_ring {
+    struct gx_log_ring *next;        ///< All rings, newest first- walked by the drainer
+    gx_rb               rb;          ///< Mirrored mapping- a record is always contiguous
+    volatile uint64_t   head;        ///< Bytes ever written (producer only)
+    volatile uint64_t   tail;        ///< Bytes ever consumed (drainer only)
+    volatile int        orphaned;    ///< Owning thread exited- freed once drained
+} gx_log_ring;
+
+typedef struct _gx_log_async_state {
+    int                     policy;
+    ssize_t                 ring_size;
+    volatile int            running;
+    pthread_t               thread;
+    pthread_key_t           ring_key;
+    gx_log_ring  * volatile rings;
+    volatile uint32_t       wake;        ///< Futex word for the drainer
+    volatile uint32_t       sleeping;    ///< Drainer is (about to be) asleep on wake
+    volatile uint64_t       dropped;     ///< Records dropped because a ring was full
+    uint64_t                reported;    ///< Drop total last reported
+    volatile uint64_t       flush_req;   ///< gx_log_async_flush() requests ...
+    volatile uint64_t       flush_done;  ///< ... and the last one a full drain pass covered
+} _gx_log_async_state;
+
+static _gx_log_async_state     _gx_log_async optional = {0};
+static __thread gx_log_ring   *_gx_log_ring  optional = NULL;
+static __thread int            _gx_log_is_drainer optional = 0;
+
+typedef struct _gx_log_rec_head {
+    uint32_t len;
+    uint8_t  severity;
+    uint8_t  _pad;
+    uint16_t count;
+} _gx_log_rec_head;
+
+typedef struct _gx_log_rec_entry {
+    uint16_t idx;
+    uint32_t keylen;           ///< Sizes are bounded by the ring (a record is at most half of it)
+    uint32_t vallen;
+} packed _gx_log_rec_entry;
+
+#define _GX_LOG_ALIGN(N) (((N) + 7) & ~((size_t)7))
+
+
+//------------------------------------------------------------------------------
+// Producer side
+//------------------------------------------------------------------------------
+
+static void _gx_log_ring_orphan(void *vring) {
+    ((gx_log_ring *)vring)->orphaned = 1;
+}
+
+static noinline gx_log_ring *_gx_log_ring_new() {
+    static __thread int creating = 0;   // gx_rb_create logs its own errors- don't recurse
+    gx_log_ring *r;
+    if(creating) return NULL;
+    creating = 1;
+    r = (gx_log_ring *)calloc(1, sizeof(gx_log_ring));
+    if(r && gx_rb_create(&(r->rb), _gx_log_async.ring_size, 0) == -1) { free(r); r = NULL; }
+    creating = 0;
+    if(!r) return NULL;
+    do r->next = _gx_log_async.rings;
+    while(!__sync_bool_compare_and_swap(&(_gx_log_async.rings), r->next, r));
+    pthread_setspecific(_gx_log_async.ring_key, r);
+    return (_gx_log_ring = r);
+}
+
+static inline void _gx_log_async_kick() {
+    __sync_fetch_and_add(&(_gx_log_async.wake), 1);
+    if(_gx_log_async.sleeping) gx_futex_wake((void *)&(_gx_log_async.wake));
+}
+
+/// The _gx_log_async_hook- serializes the staged record into this thread's ring.
+static int _gx_log_async_enqueue(gx_severity severity, kv_msg_iov *msg) {
+    gx_log_ring *r = _gx_log_ring;
+    size_t       need = sizeof(_gx_log_rec_head);
+    uint16_t     count = 0;
+    int          i;
+
+    if(rare(_gx_log_is_drainer))        return -1;               // Its own warnings go out directly
+    if(rare(!r) && !(r = _gx_log_ring_new())) return -1;  // Fall back to synchronous
+
+    for(i = 0; i < KV_ENTRIES; i++) {
+        _gx_kv *kv = &(msg->msg_tab[i]);
+        if(kv->val_data_size == 0) continue;
+        if(i < ADHOC_OFFSET && kv->val_data_base == msg_tab_master[i].val_data_base
+                            && kv->val_data_size == msg_tab_master[i].val_data_size) continue;
+        need += sizeof(_gx_log_rec_entry) + kv->val_data_size
+              + (i >= ADHOC_OFFSET ? kv->key_data_size : 0);
+        count ++;
+    }
+    need = _GX_LOG_ALIGN(need);
+    if(rare(need > (size_t)r->rb.len / 2)) { __sync_fetch_and_add(&(_gx_log_async.dropped), 1); return 0; }
+
+    for(;;) {
+        uint64_t tail = __atomic_load_n(&(r->tail), __ATOMIC_ACQUIRE);
+        if(freq(need <= r->rb.len - (r->head - tail))) break;
+        if(_gx_log_async.policy == GX_LOG_ASYNC_DROP) {
+            __sync_fetch_and_add(&(_gx_log_async.dropped), 1);
+            _gx_log_async_kick();
+            return 0;
+        }
+        _gx_log_async_kick();
+        sched_yield();
+    }
+
+    uint8_t          *p   = (uint8_t *)r->rb.addr + (r->head % r->rb.len);
+    _gx_log_rec_head *rh  = (_gx_log_rec_head *)p;
+    rh->len      = need;
+    rh->severity = severity;
+    rh->count    = count;
+    p += sizeof(_gx_log_rec_head);
+    for(i = 0; i < KV_ENTRIES; i++) {
+        _gx_kv *kv = &(msg->msg_tab[i]);
+        if(kv->val_data_size == 0) continue;
+        if(i < ADHOC_OFFSET && kv->val_data_base == msg_tab_master[i].val_data_base
+                            && kv->val_data_size == msg_tab_master[i].val_data_size) continue;
+        _gx_log_rec_entry e = {
+            .idx    = i,
+            .keylen = i >= ADHOC_OFFSET ? kv->key_data_size : 0,
+            .vallen = kv->val_data_size};
+        memcpy(p, &e, sizeof(e));                       p += sizeof(e);
+        if(e.keylen) { memcpy(p, kv->key_data_base, e.keylen); p += e.keylen; }
+        memcpy(p, kv->val_data_base, e.vallen);         p += e.vallen;
+    }
+    __atomic_store_n(&(r->head), r->head + need, __ATOMIC_RELEASE);
+    if(rare(_gx_log_async.sleeping)) _gx_log_async_kick();
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Drainer
+//------------------------------------------------------------------------------
+
+/// Rebuilds the drainer thread's own msg_iov from a record and dispatches it.
+static void _gx_log_async_replay(uint8_t *p) {
+    _gx_log_rec_head *rh = (_gx_log_rec_head *)p;
+    int               i;
+    p += sizeof(_gx_log_rec_head);
+    memcpy(&msg_iov.msg_tab, &msg_tab_master, sizeofm(kv_msg_iov,msg_tab));
+    msg_iov.main_head_base = &kv_main_head;
+    for(i = 0; i < rh->count; i++) {
+        _gx_log_rec_entry e;
+        char *kstr = NULL, *vstr;
+        memcpy(&e, p, sizeof(e));                p += sizeof(e);
+        if(e.keylen) { kstr = (char *)p;         p += e.keylen; }
+        vstr = (char *)p;                        p += e.vallen;
+        if(rare(e.idx >= KV_ENTRIES)) continue;
+        if(e.idx == K_sys_ticks && e.vallen <= 13) {
+            // Loggers right-align ticks by peeking at the '0' padding in front
+            // of the string, so it has to live at the end of a padded buffer.
+            memset(ctick_base64, '0', 12);
+            vstr = memcpy(ctick_base64 + 13 - e.vallen, vstr, e.vallen);
+        }
+#if GX_ERROR_STACK_FRAMES > 0
+        if(e.idx == K_err_stack) {                // Raw addresses- symbolized here, off the erroring thread
+            vstr = gx_error_symbolize(vstr);
+            e.vallen = strlen(vstr) + 1;
+        }
+#endif
+        if(kstr) {
+            KV_SET_PART(e.idx, val, vstr, e.vallen - 1);
+            KV_SET_PART(e.idx, key, kstr, e.keylen - 1);
+        } else {
+            KV_SET_VAL_L(e.idx, vstr, e.vallen - 1);
+        }
+    }
+    kv_main_head = 0;
+    for(i = 0; i < KV_IOV_COUNT; i++) kv_main_head += (kv_main_head_t)(MSG_AS_IOV(msg_iov)[i].iov_len);
+    _gx_log_dispatch_now((gx_severity)rh->severity, &msg_iov);
+}
+
+/// One pass over every ring. Returns the number of records dispatched. Only
+/// the drainer walks (and prunes) the ring list.
+static int _gx_log_async_drain() {
+    gx_log_ring *r, *prev = NULL, *next;
+    int          n = 0;
+    uint64_t     dropped;
+    for(r = _gx_log_async.rings; r != NULL; r = next) {
+        next = r->next;
+        uint64_t head = __atomic_load_n(&(r->head), __ATOMIC_ACQUIRE);
+        while(r->tail != head) {
+            uint8_t *p = (uint8_t *)r->rb.addr + (r->tail % r->rb.len);
+            _gx_log_async_replay(p);
+            __atomic_store_n(&(r->tail), r->tail + ((_gx_log_rec_head *)p)->len, __ATOMIC_RELEASE);
+            n ++;
+        }
+        // Rings of exited threads go away once drained (never the list head-
+        // producers may be pushing onto it right now).
+        if(rare(r->orphaned) && prev && r->tail == r->head) {
+            prev->next = next;
+            rb_free(&(r->rb));
+            free(r);
+            continue;
+        }
+        prev = r;
+    }
+    dropped = _gx_log_async.dropped;
+    if(rare(dropped > _gx_log_async.reported)) {
+        uint64_t since = dropped - _gx_log_async.reported;
+        _gx_log_async.reported = dropped;
+        log_warning("Async logging dropped %" PRIu64 " records (%" PRIu64 " total)", since, dropped);
+    }
+    if(rare(_gx_log_sites != NULL)) gx_log_rate_flush();   // Rate-limit summaries of sites gone quiet
+    gx_log_syslog_flush_stale();                            // Batches it staged that nothing followed
+    return n;
+}
+
+static void *_gx_log_async_loop(optional void *arg) {
+    _gx_log_is_drainer = 1;
+    for(;;) {
+        uint32_t seen = _gx_log_async.wake;
+        uint64_t req  = _gx_log_async.flush_req;
+        int      n    = _gx_log_async_drain();
+        _gx_log_async.flush_done = req;
+        if(n > 0) continue;
+        if(!_gx_log_async.running) break;
+        __sync_lock_test_and_set(&(_gx_log_async.sleeping), 1);
+        if(_gx_log_async.wake == seen && _gx_log_async_drain() == 0) {
+            #ifdef __LINUX__
+              struct timespec ts = {0, GX_LOG_ASYNC_IDLE_MS * 1000000L};
+              syscall(SYS_futex, (void *)&(_gx_log_async.wake), FUTEX_WAIT, (int)seen, &ts, NULL, 0);
+            #else
+              gx_sleep(0,GX_LOG_ASYNC_IDLE_MS);
+            #endif
+        }
+        __sync_lock_release(&(_gx_log_async.sleeping));
+    }
+    _gx_log_async_drain();
+    return NULL;
+}
+
+
+//------------------------------------------------------------------------------
+// Control
+//------------------------------------------------------------------------------
+
+static optional int gx_log_async_start(int policy, ssize_t ring_size) {
+    if(_gx_log_async.running) return 0;
+    _gx_log_async.policy    = policy;           // Rings that already exist keep their size
+    _gx_log_async.ring_size = ring_size > 0 ? ring_size : GX_LOG_ASYNC_RING_SIZE;
+    if(!_gx_log_async.ring_key)
+        _E(pthread_key_create(&(_gx_log_async.ring_key), _gx_log_ring_orphan)) _raise(-1);
+    _gx_log_async.running = 1;
+    _E(pthread_create(&(_gx_log_async.thread), NULL, _gx_log_async_loop, NULL)) {
+        _gx_log_async.running = 0;
+        _raise(-1);
+    }
+    _gx_log_async_hook = _gx_log_async_enqueue;
+    return 0;
+}
+
+/// Blocks until every record logged (by any thread) before the call is out.
+static optional void gx_log_async_flush() {
+    uint64_t req = __sync_add_and_fetch(&(_gx_log_async.flush_req), 1);
+    while(_gx_log_async.running && _gx_log_async.flush_done < req) {
+        _gx_log_async_kick();
+        sched_yield();
+    }
+}
+
+static optional int gx_log_async_stop() {
+    if(!_gx_log_async.running) return 0;
+    _gx_log_async_hook    = NULL;   // New records go out synchronously from here on
+    _gx_log_async.running = 0;
+    _gx_log_async_kick();
+    _E(pthread_join(_gx_log_async.thread, NULL)) _raise(-1);
+    return 0;
+}
+
+static optional uint64_t gx_log_async_dropped() {
+    return _gx_log_async.dropped;
+}
+
+#endif
@@ -46,30 +46,117 @@
 
 
 
+Usage
+  -----
+
+  Writer:
+      mapc *w = mapc_open("/dev/shm/stream", MAPC_WRITE | MAPC_VOLATILE);
+      mapc_write(w, buf, len);                  // append + wake readers
+      // -- or poke memory directly --
+      memcpy(mapc_getmem(w, len), buf, len);
+      mapc_broadcast(w, w->c + len);            // publish new end of data
+      mapc_close(w);                            // readers see mapc_eof()
+
+  Reader:
+      mapc *r = mapc_open("/dev/shm/stream", MAPC_READ);
+      NAME_add_misc(r->notify_fd, r);           // or poll/select/epoll it
+      ...on readable: mapc_notified(r);         // reset the eventfd
+      while((n = mapc_available(r)))
+          mapc_sendfile(r, sock, n);            // or mapc_read / mapc_getmem+mapc_advance
+      mapc_close(r);
+
+  The first page of the file is a mapc_head shared by everyone. `seq` is the
+  futex word- bumped on every broadcast. Each reader claims a slot in the
+  head where it publishes its cursor (gx_mreaders.h, shared with gx_mfd).
+  The data is mapped once as a large MAP_NORESERVE window
+  (MAPC_MAX_SIZE) so it never has to be remapped as it grows; the writer
+  keeps the file ftruncated MAPC_PREMAP pages ahead of the write cursor so
+  memory writes never SIGBUS. Readers never look past head->size.
+
+  Unless the writer opened with MAPC_PERSIST, pages every reader (and the
+  writer) has moved past are given back: the writer tracks the minimum live
+  reader cursor and punches holes (MADV_REMOVE where punching isn't
+  supported) behind it in MAPC_RECLAIM_CHUNK pieces, moving
+  head->start_available forward. On tmpfs that frees the RAM; on disk it
+  leaves a sparse file. With MAPC_PERSIST the data stays and the writer only
+  drops its own view of the pages (MADV_DONTNEED). mapc_reclaim() can also be
+  called by hand.
+
+  Readers get notify_fd from a gx_mnotify helper (see gx_mreaders.h).
+
+
  | function                   | description                                                               |
  | -------------------------- | ------------------------------------------------------------------------- |
  | mapc *mapc_open(path,flgs) | Initialize & open reader or writer. Ret null on error.                    |
-
- | new_mapc_pool (SIZE)       | Allocate mapc pool. Ret mapc_pool or NULL on error                        |
- | acquire_mapc  (mapc_pool)  | Get mapc from pool. Ret actual mapc                                       |
+ | mapc_close    (mapc*)      | Unmap, stop notifier, release slot/lock (and unlink if MAPC_VOLATILE w).  |
  | mapc_getmem   (mapc*,len)  | Get a pointer where you can read or write len bytes directly to memory    |
  | mapc_autoseek (mapc*)      | Update fd's offset to c do before fd based read/write/etc. Ret -1=err     |
  | mapc_autotell (mapc*)      | Update c to fd's offset. Ret -1 on error                                  |
- | mapc_broadcast(mapc*,offs) | Signal any readers that care that data at offset offs is new.             |
+ | mapc_broadcast(mapc*,offs) | Signal any readers that care that data up to offset offs is new.          |
+ | mapc_write    (mapc*,b,len)| W: append len bytes and broadcast. Ret -1 on error                        |
+ | mapc_available(mapc*)      | R: bytes published but not yet consumed by this reader                    |
+ | mapc_read     (mapc*,b,len)| R: copy up to len bytes out and advance. Ret bytes read                   |
+ | mapc_advance  (mapc*,len)  | R: consume len bytes (after mapc_getmem etc.)                             |
+ | mapc_sendfile (mapc*,fd,ln)| R: zero-copy up to len bytes to fd and advance. Ret bytes sent or -1      |
+ | mapc_notified (mapc*)      | R: drain notify_fd after it polls readable                                |
+ | mapc_eof      (mapc*)      | R: true when the writer closed and everything has been consumed           |
+ | mapc_reclaim  (mapc*)      | W: free pages all readers are done with. Ret bytes freed or -1            |
 
  TODO
  -----
+  - Readers that want to start at the tail instead of the head
 
 */
 #ifndef GX_MAPC_H
 #define GX_MAPC_H
 
 #include "./gx.h"
-#include "gx_error.h"
+#include "./gx_error.h"
+#include "./gx_pool.h"
+#include "./gx_mreaders.h"
 
 #include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/statfs.h>
+#ifdef __LINUX__
+  #include <sys/sendfile.h>
+  #include <linux/magic.h>
+#endif
+
+#define MAPC_READ        0x01
+#define MAPC_WRITE       0x02
+#define MAPC_VOLATILE    0x04  ///< Data doesn't need to outlive the writer
+#define MAPC_PERSIST     0x08  ///< Never throw away consumed data
+
+#ifndef MAPC_MAX_READERS
+  #define MAPC_MAX_READERS 32
+#endif
+#ifndef MAPC_MAX_SIZE
+  #define MAPC_MAX_SIZE  (UINT64_C(1) << 36) ///< Virtual window for the data- not memory used
+#endif
+#ifndef MAPC_RECLAIM_CHUNK
+  #define MAPC_RECLAIM_CHUNK (UINT64_C(1) << 20) ///< Writer tries reclaiming every time this much is written
+#endif
+#ifndef MAPC_PREMAP
+  #define MAPC_PREMAP    64                  ///< Pages the file is kept truncated ahead of the writer
+#endif
+
+#define _GX_MAPC_FILESIG UINT64_C(0x1c1c1c1c6d617063)
+#define _GX_MAPC_ERR_IF  {log_error("Not a properly formatted mapc file (misc data inside)."); errno=EINVAL; _raise(NULL);}
+
+
+/// Lives in the first page of the file
+typedef struct mapc_head {
+    uint64_t          sig;           ///< Always _GX_MAPC_FILESIG so we don't clobber some unsuspecting file
+    volatile uint32_t seq;           ///< Futex word- changes on every broadcast
+    uint32_t          flags;         ///< MAPC_VOLATILE / MAPC_PERSIST as the writer opened it
+    volatile uint64_t size;          ///< Bytes of data (not counting this page) published
+    volatile uint64_t start_available; ///< Data before this offset may have been freed
+    volatile pid_t    writer;        ///< 0 once the writer has closed
+    uint32_t          _pad;
+    gx_mreader_slot   readers[MAPC_MAX_READERS];
+} mapc_head;
 
 
 /// Holds the state for an mapc- including memory-mapped data pointers.
@@ -77,14 +164,272 @@ typedef struct mapc {
     struct mapc     *_next, *_prev; ///< For resource pooling
     char             type;           ///< Reader or writer
     char             is_volatile;    ///< Used to record whether or not the file is RAM-based
-
-} packed mapc;
+    int              flags;          ///< As given to mapc_open
+    int              fd;             ///< File descriptor, ready for IO operations (offsets include the head page)
+    int              notify_fd;      ///< R: readable when there is new data (notify.notify_fd)
+    int              slot;           ///< R: index into head->readers
+    mapc_head       *head;           ///< Shared header page
+    uint8_t         *data;           ///< Start of the data window
+    size_t           c;              ///< Cursor- write position for writer, read position for readers
+    size_t           off_eof;        ///< W: data bytes currently backed by the file
+    size_t           _next_reclaim;  ///< W: cursor position that triggers the next mapc_reclaim
+    size_t           _dropped;       ///< W: (persistent) own view dropped up to here
+    gx_mnotify       notify;         ///< R: futex -> notify_fd helper
+    char            *path;           ///< Kept so a volatile writer can unlink on close
+} mapc;
 
 gx_pool_init(mapc);
+static mapc_pool *_gx_mapc_pool optional = NULL;
+
+static optional int  mapc_close(mapc *m);
+static optional ssize_t mapc_reclaim(mapc *m);
+static inline   int _mapc_ensure(mapc *m, size_t upto);
+
+
+//------------------------------------------------------------------------------
+// Opening / closing
+//------------------------------------------------------------------------------
+
+static int _mapc_map(mapc *m) {
+    void *head, *data;
+    int   prot = (m->type == MAPC_WRITE) ? PROT_READ | PROT_WRITE : PROT_READ;
+    _M (head = mmap(NULL, pagesize(), PROT_READ | PROT_WRITE, MAP_SHARED, m->fd, 0)) _raise(-1);
+    _M (data = mmap(NULL, MAPC_MAX_SIZE, prot, MAP_SHARED | MAP_NORESERVE,
+                    m->fd, pagesize())) {munmap(head, pagesize()); _raise(-1);}
+    _  (madvise(data, MAPC_MAX_SIZE, MADV_SEQUENTIAL)) _ignore();
+    m->head = (mapc_head *)head;
+    m->data = (uint8_t *)data;
+    return 0;
+}
+
+/**
+ * Open path as the (single) writer or one of up to MAPC_MAX_READERS readers.
+ * A writer reopening an existing mapc continues appending where it left off.
+ * Returns NULL and sets errno on error (EWOULDBLOCK if another writer has it).
+ */
+static optional mapc *mapc_open(const char *path, int flags) {
+    mapc       *m;
+    struct stat st;
+    int         is_w = (flags & MAPC_WRITE) != 0;
+    #ifdef __LINUX__
+      int open_flags = O_RDWR | O_CLOEXEC | O_NOCTTY | (is_w ? O_CREAT : 0);
+    #else
+      int open_flags = O_RDWR | (is_w ? O_CREAT : 0);
+    #endif
+
+    if(rare(!_gx_mapc_pool)) _N(_gx_mapc_pool = new_mapc_pool(4)) _raise(NULL);
+    _N(m = acquire_mapc(_gx_mapc_pool)) _raise(NULL);
+    m->type   = is_w ? MAPC_WRITE : MAPC_READ;
+    m->flags  = flags;
+    m->c      = m->off_eof = 0;
+    m->slot   = -1;
+    m->head   = NULL;
+    m->notify_fd = m->notify.notify_fd = m->notify.in_fd = -1;
+    m->fd        = -1;
+    m->notify.state = 0;
+    _N(m->path = strdup(path))                                         goto fail;
+    _ (m->fd   = open(path, open_flags, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP)) goto fail;
+    #ifdef __LINUX__
+      struct statfs sfs;
+      if(fstatfs(m->fd, &sfs) == 0) m->is_volatile = (sfs.f_type == TMPFS_MAGIC || sfs.f_type == RAMFS_MAGIC);
+      else                          m->is_volatile = 0;
+    #else
+      m->is_volatile = 0;
+    #endif
+
+    if(is_w) {
+        _ (flock(m->fd, LOCK_EX | LOCK_NB)                                ) goto fail;
+        _ (fstat(m->fd, &st)                                              ) goto fail;
+        if(st.st_size == 0) _ (ftruncate(m->fd, pagesize())               ) goto fail;
+        _ (_mapc_map(m)                                                   ) goto fail;
+        if(st.st_size == 0) {
+            memset(m->head, 0, sizeof(mapc_head));
+            m->head->flags = flags & (MAPC_VOLATILE | MAPC_PERSIST);
+            __sync_synchronize();
+            m->head->sig = _GX_MAPC_FILESIG;
+        } else if(m->head->sig != _GX_MAPC_FILESIG || (size_t)st.st_size < pagesize()) {
+            log_error("Not a properly formatted mapc file (misc data inside).");
+            errno = EINVAL; goto fail;
+        }
+        m->c       = m->head->size;
+        m->_dropped      = m->head->start_available;
+        m->_next_reclaim = m->c + MAPC_RECLAIM_CHUNK;
+        m->off_eof = st.st_size > (off_t)pagesize() ? st.st_size - pagesize() : 0;
+        _ (_mapc_ensure(m, m->c)                                          ) goto fail;
+        m->head->writer = getpid();
+    } else {
+        _ (fstat(m->fd, &st)                                              ) goto fail;
+        if((size_t)st.st_size < pagesize()) { errno = EAGAIN;               goto fail; }
+        _ (_mapc_map(m)                                                   ) goto fail;
+        if(m->head->sig != _GX_MAPC_FILESIG) {
+            log_error("Not a properly formatted mapc file (misc data inside).");
+            errno = EINVAL; goto fail;
+        }
+        m->c = m->head->start_available;
+        _ (m->slot = gx_mreader_claim(m->head->readers, MAPC_MAX_READERS, m->c)) goto fail;
+        if(rare(m->c < m->head->start_available)) // Reclaimed while we were claiming
+            m->head->readers[m->slot].off = m->c = m->head->start_available;
+        _ (gx_mnotify_start(&(m->notify), &(m->head->seq), NULL, &(m->head->size),
+                            &(m->head->writer), m->c)                     ) goto fail;
+        m->notify_fd = m->notify.notify_fd;
+    }
+    return m;
+  fail:
+    mapc_close(m);
+    _raise(NULL);
+}
 
+static optional int mapc_close(mapc *m) {
+    int was_w = (m->type == MAPC_WRITE);
+    if(m->head) {
+        if(was_w) {
+            m->head->writer = 0;
+            __sync_fetch_and_add(&(m->head->seq), 1);
+            gx_futex_wake((void *)&(m->head->seq));
+        } else {
+            gx_mnotify_stop(&(m->notify));
+            m->notify_fd = -1;
+            if(m->slot >= 0) m->head->readers[m->slot].pid = 0;
+        }
+        munmap(m->data, MAPC_MAX_SIZE);
+        munmap((void *)m->head, pagesize());
+        m->head = NULL;
+        if(was_w && (m->flags & MAPC_VOLATILE) && m->path) unlink(m->path);
+    }
+    if(m->fd != -1) close(m->fd);
+    m->fd = -1;
+    free(m->path);
+    m->path = NULL;
+    release_mapc(_gx_mapc_pool, m);
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Writer
+//------------------------------------------------------------------------------
+
+/// Make sure the file backs the data window up to (at least) upto bytes.
+static inline int _mapc_ensure(mapc *m, size_t upto) {
+    if(freq(upto <= m->off_eof)) return 0;
+    if(rare(upto > MAPC_MAX_SIZE)) { errno = EFBIG; _raise(-1); }
+    size_t new_eof = min(gx_in_pages(upto) + pagesize() * MAPC_PREMAP, (size_t)MAPC_MAX_SIZE);
+    _ (ftruncate(m->fd, new_eof + pagesize())) _raise(-1);
+    m->off_eof = new_eof;
+    return 0;
+}
+
+/// Publishes everything up to offs (writer cursor moves there) and wakes readers.
+static inline int mapc_broadcast(mapc *m, size_t offs) {
+    m->c = offs;
+    if(offs > m->head->size) m->head->size = offs; // Written only by the writer
+    __sync_fetch_and_add(&(m->head->seq), 1);
+    _ (gx_futex_wake((void *)&(m->head->seq))) _raise(-1);
+    if(rare(offs >= m->_next_reclaim)) {
+        m->_next_reclaim = offs + MAPC_RECLAIM_CHUNK;
+        _ (mapc_reclaim(m)) _raise(-1);
+    }
+    return 0;
+}
 
-static optional mapc_open(mapc *mm, const char *path, int flags) {
+/**
+ * Give back whole pages that the writer and every live reader have moved
+ * past. Returns the number of bytes released (0 if nothing could be).
+ */
+static optional ssize_t mapc_reclaim(mapc *m) {
+    size_t low = gx_mreader_min(m->head->readers, MAPC_MAX_READERS, m->c), upto, from;
+    if(m->head->flags & MAPC_PERSIST) {
+        // Keep the data- just stop holding our own view of it in memory
+        upto = low & ~((size_t)pagesize() - 1);
+        if(upto <= m->_dropped) return 0;
+        from = m->_dropped;
+        _ (madvise(m->data + from, upto - from, MADV_DONTNEED)) _raise(-1);
+        m->_dropped = upto;
+        return upto - from;
+    }
+    from = m->head->start_available;
+    upto = gx_mreader_release(&(m->head->start_available), m->head->readers, MAPC_MAX_READERS, from, low, 0);
+    if(upto <= from) return 0;
+    _ (gx_mreader_punch(m->fd, m->data + from, from + pagesize(), upto - from)) _raise(-1);
+    return upto - from;
+}
+
+static inline int mapc_write(mapc *m, const void *buf, size_t len) {
+    _ (_mapc_ensure(m, m->c + len)) _raise(-1);
+    memcpy(m->data + m->c, buf, len);
+    return mapc_broadcast(m, m->c + len);
+}
+
+/// Writer: room for len bytes at the cursor. Reader: len bytes at the cursor
+/// if they have been published. NULL otherwise.
+static inline void *mapc_getmem(mapc *m, size_t len) {
+    if(m->type == MAPC_WRITE) {
+        _ (_mapc_ensure(m, m->c + len)) _raise(NULL);
+    } else if(rare(m->c + len > m->head->size)) {
+        errno = EAGAIN;
+        return NULL;
+    }
+    return m->data + m->c;
+}
+
+static inline int mapc_autoseek(mapc *m) {
+    _ (lseek(m->fd, m->c + pagesize(), SEEK_SET)) _raise(-1);
+    return 0;
+}
+
+/// After fd-based io- writers should follow with mapc_broadcast(m, m->c).
+static inline int mapc_autotell(mapc *m) {
+    off_t pos;
+    _ (pos = lseek(m->fd, 0, SEEK_CUR)) _raise(-1);
+    m->c = pos > (off_t)pagesize() ? pos - pagesize() : 0;
+    if(m->type == MAPC_WRITE && m->c > m->off_eof) m->off_eof = m->c;
+    else if(m->type == MAPC_READ) m->head->readers[m->slot].off = m->c;
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Readers
+//------------------------------------------------------------------------------
+
+static inline size_t mapc_available(mapc *m) {
+    size_t size = m->head->size;
+    return size > m->c ? size - m->c : 0;
+}
+
+static inline int mapc_eof(mapc *m) {
+    return !m->head->writer && !mapc_available(m);
+}
+
+static inline void mapc_advance(mapc *m, size_t len) {
+    m->c += len;
+    m->head->readers[m->slot].off = m->c;
+}
+
+static inline size_t mapc_read(mapc *m, void *buf, size_t len) {
+    len = min(len, mapc_available(m));
+    memcpy(buf, m->data + m->c, len);
+    mapc_advance(m, len);
+    return len;
+}
+
+static inline ssize_t mapc_sendfile(mapc *m, int out_fd, size_t len) {
+    ssize_t sent;
+    len = min(len, mapc_available(m));
+    if(!len) return 0;
+    #ifdef __LINUX__
+      off_t off = m->c + pagesize();
+      _ (sent = sendfile(out_fd, m->fd, &off, len)) _raise(-1);
+    #else
+      _ (sent = write(out_fd, m->data + m->c, len)) _raise(-1);
+    #endif
+    mapc_advance(m, sent);
+    return sent;
+}
 
+/// Resets notify_fd after the event loop reported it readable.
+static inline int mapc_notified(mapc *m) {
+    return gx_mnotify_drain(&(m->notify));
 }
 
 #endif
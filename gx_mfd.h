@@ -0,0 +1,606 @@
+/**
+ * Fun with memory-maps. The fruits of persistence! Faster than inotify (etc.)
+ * for stuff you are pretty sure is going to be in the page-cache anyway
+ * (recently used files etc.) Not necessarily file-based- or files that will
+ * stay after the process is gone (like, for example, the pre-unlinked files
+ * that gx_ringbuf uses).
+ *
+ * Including a function that returns a filedescriptor that can be used in epoll
+ * etc. when a variable is changed (usually a memory-mapped variable changed by
+ * another process). Coded to be very fast, at least for Linux. At this point
+ * mostly used as a very, very fast alternative to inotify etc. that works even
+ * when the data hasn't been written to any inodes etc.
+ *
+ * At some point I'll probably put in here mome mmap simplifications /
+ * abstractions in order to take advantage of various optimizations since
+ * that'll be the primary usecase for memfd.
+ *
+ *  http://gustedt.wordpress.com/2011/01/28/linux-futexes-non-blocking-integer-valued-condition-variables/
+ * Also, for mac-osx mremap emulation, see:
+ *  https://dank.qemfd.net/bugzilla/show_bug.cgi?id=119
+ *
+ * USAGE:
+ *
+ *   gx_mfd_pool *pool = new_gx_mfd_pool(2);
+ *   gx_mfd      *w    = acquire_gx_mfd(pool);
+ *   gx_mfd_create_w(w, 256, "/some/file");   // or gx_mfd_create_wf(..., GX_MFD_VOLATILE)
+ *   mfd_wbe32(w, len); mfd_wbyte(w, kind);    // typed appends- batch them ...
+ *   mfd_write(w, buf, len);                   // ... and publish (mfd_publish(w) does just that)
+ *   gx_mfd_close(w);
+ *
+ *   gx_mfd *r = acquire_gx_mfd(pool);
+ *   gx_mfd_create_r(r, 256, "/some/file");
+ *   gx_mfd_event_add(loop_name, r);           // notify_fd into a gx_event loop
+ *   ... or just block (futex- no polling):
+ *   while((n = gx_mfd_follow(r, -1)) > 0) { consume(mfd_r(r), n); mfd_advance(r, n); }
+ *
+ *
+ *
+ *        freed/
+ *       removed      active
+ *          v           v
+ *     =---------~~~~~~===#######
+ *     ^           ^            ^
+ *     mfd        marked       "file"-length
+ *     head       dontneed     writer-mapped
+ *                (per proc)   often reader-mapped.
+ *
+ * - Only writing process will free/remove pages under the following
+ *   conditions:
+ *    - Was previously marked dontneed by writer
+ *    - Has been in that state for at least [something] seconds
+ *    - Mincore shows that it is not in resident memory
+ *    - MFD is not marked persistent
+ * - Writer will indicate in the header the offset of the first page that is
+ *   _not_ freed/removed. This is, in effect, the earliest offset besides the
+ *   header page that a reader can operate on.
+ * - A reader has the obligation to lock a page if it really needs to hold onto
+ *   it for a while- only one reader should do this as locks don't stack.
+ * - Initial mapping / remapping should never try to map pages that are marked
+ *   free.
+ *
+ *
+ *  MFD_DEPRICATE   = MADV_FREE |\ MADV_REMOVE
+ *
+ * - Header, then, needs to include
+ *    - persistence
+ *    - (start_freed is always the second page)
+ *    - start_writer_done
+ *    - start_writer_active
+ *    - file_length
+ *
+ * - Each mfd instance will, of course, keep track of its own:
+ *    - start_active (indicating that all pages before this are marked dontneed)
+ *    - map_file_offset
+ *    - mapped_pages
+ *
+ *
+ * TODO:
+ *  - [D] Memory-map resizing as appropriate (mremap, both sides)
+ *  - [D] Page advising on "used" pages (SEQUENTIAL / WILLNEED ahead / DONTNEED behind)
+ *  - [D] Add an easy "add" hook to gx_event for utilizing notify_fd
+ *  - [D] Abstraction for auto-update-files from writer perspective
+ *    * Trigger for waking up waiting processes (FUTEX_WAKE on linux, nothing
+ *      on mac-osx, which is going to be polling) - automatic where possible
+ *      and exposed where not. Writers only make the syscall when a reader is
+ *      actually asleep on the futex (head->waiters).
+ *  - [D] Be sure readonly stuff is set on readers
+ *  - [D] Make sure and mark variable as volatile (in the smallest appropriate
+ *    scope ala wikipedia)
+ *  - Programatically check and warn on bad system limitations
+ *  - [D] W|\ |mfd_write(mfd*, void *src, len)
+ *  - [D] W|\ |mfd_wbyte, wbe16/24/32/64, wle16/24/32/64
+ *
+ * RELEVANT SYSTEM LIMITATIONS:
+ *  - vm.max_map_count  (65530)
+ *  - vm.swappiness (60 - should be more ~ 20 or lower)
+ *  - ulimit / open file descriptors
+ *  - virtual memory available per process (RLIMIT_AS)
+ *  - RLIMIT_MEMLOCK (needs one per writer-mfd at least)
+ *
+ * IMPLEMENTATION (again):
+ *
+ *  - (optimized for sequential write/read, but will allow for random access)
+ *  - (optimized for data persistence, but can easily add unlinking and use
+ *     ram-based filesystems if needed).
+ *
+ *  - [D] Open mfd file or (WRITER) create one
+ *  - [D] Turn off atime modifications to avoid unnecessary IO
+ *  - [D] If a writer, lock the file (other writer attempts will fail)
+ *  - [D] Map only the first page, lock it in RAM, and point the header structure
+ *    to it. It will be redundant but only use up (essentially limitless)
+ *    virtual memory. Must be locked into RAM for futexes / notifications to
+ *    work well etc.
+ *  - [D] Check for a correct header if there is any data
+ *
+ *  (WRITER only)
+ *  - [D] Create a correct header if there is none
+ *  - [D] Map the entire file + page_precache pages
+ *  - [D] ftruncate or lseek+write to extend _just barely_ into the last mapped
+ *    page to eliminate sigbus signals. On Linux at least, if contents to
+ *    happen to write out to disk, a hole will be created and therefore actual
+ *    disk-space won't really be affected.
+ *  - Update header, trigger futex-wake on the current size in page-locked
+ *    header, and wait for write operations.
+ *  - On a write operation, mremap (or mac equiv) occurs if needed, including
+ *    ftruncate et al. Madvise any new pages to be sequential.
+ *  - After a write operation, size variable is changed and futex-wake invoked
+ *    (on Linux).
+ *  - When write cursor advances across page boundaries, mark older pages as
+ *    dontneed.
+ *  - When mfd is closed, clean up futex, clean up memory maps, clean up file
+ *    as appropriate (for persistent mfds, be sure and ftruncate to the end of
+ *    the last page instead of the beginning of it), etc.
+ *
+ *  (READER only)
+ *  - [D] Map the entire file + page_precache pages - but all PROT_READ / RONLY,
+ *    etc. to cause very efficient kernel optimizations. (possibly same w/
+ *    memory-locked header page, but only if it doesn't interfere with the
+ *    futex).
+ *  - [D] Create a new pipe pair
+ *  - [D] Do the cheapest sys_clone possible (vfork on mac, alas), and have one
+ *    branch return the read-end of the pipe (or have it as part of the mfd
+ *    structure that will be referenced).
+ *  - Have the other end do the following:
+ *    - Prepare to handle any specific signals indicating that the writer is
+ *      done or futex doesn't exist any more etc. but without disturbing the
+ *      main process if at all possible.
+ *    - Prepare to gracefully shut down when the parent process needs it to for
+ *      any reason.
+ *    - Block on a volatile futex created on the "size" part of memorymapped
+ *      header - simply waiting for _any_ change on the variable (hence mfd =
+ *      memory-file-descriptor).
+ *    - When futex is awakened, current size is written to the pipe, and then
+ *      the futex is reacquired.
+ *    - All of the above will be a simple poll/sleep loop for mac osx plus the
+ *      signal handling.
+ *  - User can put the "notification fd" (read side of the pipe) in an event
+ *    loop and trigger simple memory read operations whenever desired.
+ *  - When read operations advance the cursor across page boundaries, mark
+ *    earlier pages as dontneed and new pages as sequential, like the writer,
+ *    BUT obviously don't do ftruncate or anything. Any sigbus errors are
+ *    indications that there are serious problems w/ disk or with the
+ *    writer-side, so allow it to propagate at least to parent.
+ *
+ *  (FUTURE)
+ *  - Non-persistent (or, "briefly" persistent) flag:
+ *    Flag on init to decide if the file is going to persist. If not, when the
+ *    mfd is closed: (1) unlink, (2) msync(DIRTY), (3) close-fd, (4) munmap -
+ *    to avoid disk churn as much as possible (or RAM churn if /dev/shm)
+ *    Unfortunately going to have some churn regardless while the file is
+ *    building or else new processes wouldn't be able to find it.
+ *  - Also, possibly for non-persistent/non-random-access mfds: on Linux we can
+ *    possibly madvise pages to be completely freed when they're on a ram-based
+ *    filesystem
+ *
+ */
+#ifndef GX_MFD_H
+#define GX_MFD_H
+
+#include "./gx.h"
+#include "./gx_error.h"
+#include "./gx_pool.h"
+#include "./gx_mreaders.h"
+
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define _GX_MFD_ERR_IF  {log_error("Not a properly formatted mfd file (misc data inside)."); errno=EINVAL; _raise(-1);}
+#define _GX_MFD_FILESIG UINT64_C(0x1c1c1c1c1c1c1c1c)
+
+#define GXMFDR 0
+#define GXMFDW 1
+
+#define GX_MFD_PERSIST   0x01  ///< Keep consumed data (default for gx_mfd_create_w)
+#define GX_MFD_VOLATILE  0x02  ///< Punch out pages all readers are done with
+
+#ifndef GX_MFD_MAX_READERS
+  #define GX_MFD_MAX_READERS 16
+#endif
+#ifndef GX_MFD_RECLAIM_CHUNK
+  #define GX_MFD_RECLAIM_CHUNK (UINT64_C(1) << 20)
+#endif
+
+typedef struct gx_mfd_head {
+    uint64_t  sig;    ///< Will always be 0x1c... - so we don't clobber some unsuspecting file not made for this
+    volatile uint64_t size; ///< Data size (not including header). Host-endian
+
+    uint64_t  h1;     ///< User-defined - there should be a better way to do this...
+    uint64_t  h2;     ///< User-defined
+    uint64_t  h3;     ///< User-defined
+    uint64_t  h4;     ///< User-defined
+    uint64_t  h5;     ///< User-defined
+    uint64_t  h6;     ///< User-defined
+    uint64_t  h7;     ///< User-defined
+
+    volatile uint32_t seq;             ///< Futex word- bumped whenever size changes
+    volatile uint32_t waiters;         ///< Readers asleep on seq- writer skips FUTEX_WAKE when 0
+    volatile pid_t    writer;          ///< 0 when no writer has it open
+    uint32_t          flags;           ///< GX_MFD_PERSIST / GX_MFD_VOLATILE
+    volatile uint64_t start_available; ///< Data offsets before this may have been punched out
+    gx_mreader_slot   readers[GX_MFD_MAX_READERS]; ///< Reader cursors, so the writer knows what it can free
+} gx_mfd_head;
+
+typedef struct gx_mfd {
+    struct gx_mfd    *_next, *_prev; ///< For resource pooling
+    int               type;          ///< Readonly or writeonly at the moment
+    int               premap;        ///< Pages at a time to map- higher avoids more remapping+syscalls
+    int               fd;            ///< File descriptor, ready for IO operations
+    int               fdh;           ///< Reader temporarily opens a write fd so that the futex works
+    size_t            off_eof;       ///< Offset to underlying file's EOF == currently truncated size
+    union {
+        void         *head_map;      ///< Same as first page of map, but locked into RAM
+        gx_mfd_head  *head;          ///< Alternative perspective for accessing futex etc.
+    };
+    void             *map;           ///< Full mapping- may change locations as data grows
+    size_t            off_eom;       ///< Offset to current end of map. Usually >= filesize
+
+    void             *data;          ///< Points into map just after header- used for read/write
+    size_t            off_r;         ///< Current read cursor = offset into data (which may change locations)
+    size_t            off_w;         ///< Current write cursor, also offset into data
+    size_t            off_adv;       ///< Map offset up to which pages behind the cursor were advised away
+    size_t            off_reclaim;   ///< W: off_w that triggers the next gx_mfd_reclaim
+    int               slot;          ///< R: index into head->readers
+
+    int               notify_fd;     ///< R: readable when there is new data (notify.notify_fd)
+    gx_mnotify        notify;        ///< R: futex -> notify_fd helper
+} gx_mfd;
+
+gx_pool_init(gx_mfd);
+
+/// Puts a reader's notify_fd into a gx_eventloop; the misc handler gets the
+/// gx_mfd back as sess->udata.
+#define gx_mfd_event_add(LOOP, MFD) LOOP ## _add_misc((MFD)->notify_fd, (void *)(MFD))
+
+/// Some forward declarations
+static optional int  gx_mfd_create_w    (gx_mfd *mfd, int pages_at_a_time, const char *path);
+static optional int  gx_mfd_create_wf   (gx_mfd *mfd, int pages_at_a_time, const char *path, int flags);
+static optional int  gx_mfd_create_r    (gx_mfd *mfd, int pages_at_a_time, const char *path);
+static optional int  gx_mfd_close       (gx_mfd *mfd);
+static optional ssize_t gx_mfd_reclaim  (gx_mfd *mfd);
+static optional int _gx_initial_mapping (gx_mfd *mfd);
+static inline   int _gx_advise_map      (gx_mfd *mfd);
+static inline   int _gx_update_eof      (gx_mfd *mfd);
+static inline   int _gx_update_fpos     (gx_mfd *mfd);
+static inline   int _gx_mfd_remap       (gx_mfd *mfd, size_t min_eom);
+
+
+static inline int gx_mfd_create_w(gx_mfd *mfd, int pages_at_a_time, const char *path) {
+    return gx_mfd_create_wf(mfd, pages_at_a_time, path, GX_MFD_PERSIST);
+}
+
+/** Initialize an mfd struct for a given file, mapping the file for writes etc.
+ * Pages-at-a-time should be large enough to avoid remapping a fast-growing
+ * file constantly. Set to roughly throughput in bytes/per-second time 3 or 4
+ * divided by page-size (usually 4096)- then bring it lower if too much virtual
+ * memory is being sucked up (will help, at the expense of speed & processor
+ * resources and slightly more churn earlier on).
+ */
+static optional int gx_mfd_create_wf(gx_mfd *mfd, int pages_at_a_time, const char *path, int flags) {
+    #ifdef __LINUX__
+      int open_flags = O_RDWR | O_NONBLOCK | O_CREAT | O_NOATIME | O_NOCTTY;
+    #else
+      int open_flags = O_RDWR | O_NONBLOCK | O_CREAT;
+    #endif
+    size_t initial_size;
+
+    mfd->type      = GXMFDW;
+    mfd->data      = NULL;
+    mfd->premap    = pages_at_a_time > 0 ? pages_at_a_time : 1;
+    mfd->slot      = -1;
+    mfd->notify_fd = mfd->notify.notify_fd = mfd->notify.in_fd = -1;
+    mfd->notify.state = 0;
+    _( mfd->fd=open(path, open_flags, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP)) _raise_alert(-1);
+    _( flock(mfd->fd, LOCK_EX | LOCK_NB)                              ) _raise_alert(-1);
+    _( initial_size = _gx_initial_mapping(mfd)                        ) _raise_alert(-1);
+
+    if(initial_size > 0) {
+        // There should be a valid header in place then.
+        if(mfd->head->sig != _GX_MFD_FILESIG)  _GX_MFD_ERR_IF;
+        if(initial_size < sizeof(gx_mfd_head)) _GX_MFD_ERR_IF;
+        // The file runs past size by the premapped slack unless a persistent
+        // writer closed it cleanly- only missing published data is a problem.
+        if((uint64_t)(initial_size - sizeof(gx_mfd_head)) < mfd->head->size)
+            log_warning("%s in a possibly inconsistent state.", path);
+        mfd->off_w = mfd->head->size;
+    } else {
+        memset(mfd->head, 0, sizeof(gx_mfd_head));
+        mfd->head->flags = flags;
+        __sync_synchronize();
+        mfd->head->sig   = _GX_MFD_FILESIG;
+        mfd->off_w       = 0;
+    }
+    mfd->head->writer = getpid();
+    mfd->data         = mfd->map + sizeof(gx_mfd_head);
+    mfd->off_r        = 0;
+    mfd->off_adv      = mfd->head->start_available + sizeof(gx_mfd_head);
+    mfd->off_reclaim  = mfd->off_w + GX_MFD_RECLAIM_CHUNK;
+    _(_gx_mfd_remap(mfd, mfd->off_w + sizeof(gx_mfd_head))) _raise_alert(-1);
+    _gx_update_fpos(mfd); // Seek to current write position for standard IO
+    return 0;
+}
+
+static optional int gx_mfd_create_r(gx_mfd *mfd, int pages_at_a_time, const char *path) {
+    #ifdef __LINUX__
+      int h_open_flags = O_RDWR   | O_NONBLOCK | O_NOATIME | O_NOCTTY;
+      int open_flags   = O_RDONLY | O_NONBLOCK | O_NOATIME | O_NOCTTY;
+    #else
+      int h_open_flags = O_RDWR   | O_NONBLOCK;
+      int open_flags   = O_RDONLY | O_NONBLOCK;
+    #endif
+
+    mfd->type      = GXMFDR;
+    mfd->data      = NULL;
+    mfd->premap    = pages_at_a_time > 0 ? pages_at_a_time : 1;
+    mfd->slot      = -1;
+    mfd->notify_fd = mfd->notify.notify_fd = mfd->notify.in_fd = -1;
+    mfd->notify.state = 0;
+    _( mfd->fd  = open(path, open_flags)    ) _raise_alert(-1);
+    _( mfd->fdh = open(path, h_open_flags)  ) _raise_alert(-1);
+    _( _gx_initial_mapping(mfd)             ) _raise_alert(-1);
+    _( close(mfd->fdh)                      )  _warning();
+    if(mfd->head->sig != _GX_MFD_FILESIG) _GX_MFD_ERR_IF;
+    mfd->data    = mfd->map + sizeof(gx_mfd_head);
+    mfd->off_w   = mfd->head->size;
+    mfd->off_r   = mfd->head->start_available;
+    mfd->off_adv = mfd->off_r + sizeof(gx_mfd_head);
+
+    _( mfd->slot = gx_mreader_claim(mfd->head->readers, GX_MFD_MAX_READERS, mfd->off_r)) _raise_alert(-1);
+    if(rare(mfd->off_r < mfd->head->start_available))
+        mfd->head->readers[mfd->slot].off = mfd->off_r = mfd->head->start_available;
+    _( gx_mnotify_start(&(mfd->notify), &(mfd->head->seq), &(mfd->head->waiters),
+                        &(mfd->head->size), &(mfd->head->writer), mfd->off_r)) _raise_alert(-1);
+    mfd->notify_fd = mfd->notify.notify_fd;
+    return 0;
+}
+
+static optional int gx_mfd_close(gx_mfd *mfd) {
+    if(mfd->type == GXMFDW) {
+        mfd->head->writer = 0;
+        __sync_fetch_and_add(&(mfd->head->seq), 1);
+        gx_futex_wake((void *)&(mfd->head->seq));
+        if(mfd->head->flags & GX_MFD_PERSIST) // Don't leave the premapped slack on disk
+            _(ftruncate(mfd->fd, mfd->off_w + sizeof(gx_mfd_head))) _warning();
+    } else {
+        gx_mnotify_stop(&(mfd->notify));
+        if(mfd->slot >= 0) mfd->head->readers[mfd->slot].pid = 0;
+        mfd->notify_fd = -1;
+        mfd->slot = -1;
+    }
+    munmap(mfd->map, mfd->off_eom);
+    munlock(mfd->head_map, pagesize());
+    munmap(mfd->head_map, pagesize());
+    _(close(mfd->fd)) _raise(-1);
+    return 0;
+}
+
+/// Will be just like remapping but afaict this is easier for now
+static int _gx_initial_mapping(gx_mfd *mfd) {
+    struct stat filestat;
+    off_t  fsz;
+    int    protection = PROT_READ;
+    int    head_flags = MADV_RANDOM | MADV_WILLNEED;
+
+    _ (fstat(mfd->fd, &filestat) ) _raise(-1);
+    mfd->off_eof = fsz = filestat.st_size;
+    mfd->off_eom = gx_in_pages(fsz) + (pagesize() * mfd->premap);
+    if(mfd->type == GXMFDW) {
+        protection |= PROT_WRITE; // Otherwise will stay read-only for performance
+        _(_gx_update_eof(mfd)                                              ) _raise_alert(-1);
+        _M(mfd->head_map=mmap(NULL,pagesize(),
+                    protection,MAP_SHARED,mfd->fd,0)                       ) _raise_alert(-1);
+    } else {
+        if((size_t)fsz < sizeof(gx_mfd_head)) _GX_MFD_ERR_IF;
+        _M(mfd->head_map=mmap(NULL,pagesize(),
+                    protection|PROT_WRITE,MAP_SHARED,mfd->fdh,0)           ) _raise_alert(-1);
+    }
+    _ (madvise(mfd->head_map, pagesize(), head_flags)                     ) _raise_alert(-1);
+    _ (mlock(mfd->head_map, pagesize())                                   ) _warning(); // RLIMIT_MEMLOCK
+    _M(mfd->map=mmap(NULL,mfd->off_eom,protection,MAP_SHARED,mfd->fd,0)   ) _raise_alert(-1);
+    _ (madvise(mfd->map, mfd->off_eom, MADV_SEQUENTIAL)                   ) _ignore();
+    _ (_gx_advise_map(mfd)                                                 ) _raise_alert(-1);
+    return fsz;
+}
+
+/// Grows the mapping (mremap- the data may move) so map offsets up to
+/// min_eom are covered, premap pages at a time. Writers extend the file first
+/// so nothing they touch can SIGBUS.
+static inline int _gx_mfd_remap(gx_mfd *mfd, size_t min_eom) {
+    if(freq(min_eom <= mfd->off_eom && (mfd->type == GXMFDR || min_eom <= mfd->off_eof))) return 0;
+    size_t new_eom = max(mfd->off_eom, gx_in_pages(min_eom) + pagesize() * mfd->premap);
+    void  *new_map;
+    if(new_eom != mfd->off_eom) {
+        _M(new_map = mremap(mfd->map, mfd->off_eom, new_eom, MREMAP_MAYMOVE)) _raise(-1);
+        _ (madvise(new_map + mfd->off_eom, new_eom - mfd->off_eom, MADV_SEQUENTIAL)) _ignore();
+        mfd->map     = new_map;
+        mfd->data    = new_map + sizeof(gx_mfd_head);
+        mfd->off_eom = new_eom;
+    }
+    if(mfd->type == GXMFDW) _(_gx_update_eof(mfd)) _raise(-1);
+    return 0;
+}
+
+/// Pages just ahead of the cursor get WILLNEED; whole pages behind it that
+/// this process is done with get DONTNEED (it's only our view of them- the
+/// data stays until a reclaim).
+static inline int _gx_advise_map(gx_mfd *mfd) {
+    if(!mfd->data) return 0;
+    size_t cur    = (mfd->type == GXMFDW ? mfd->off_w : mfd->off_r) + sizeof(gx_mfd_head);
+    size_t behind = cur & ~((size_t)pagesize() - 1);
+    if(behind > mfd->off_adv && behind - mfd->off_adv >= pagesize() * (size_t)mfd->premap) {
+        size_t from = max((size_t)pagesize(), mfd->off_adv & ~((size_t)pagesize() - 1));
+        if(behind > from) _(madvise(mfd->map + from, behind - from, MADV_DONTNEED)) _raise(-1);
+        mfd->off_adv = behind;
+        size_t ahead = min(pagesize() * (size_t)mfd->premap, mfd->off_eom - behind);
+        if(ahead) _(madvise(mfd->map + behind, ahead, MADV_WILLNEED)) _ignore();
+    }
+    return 0;
+}
+
+static inline int _gx_update_eof(gx_mfd *mfd) {
+    // The whole mapping is kept backed by the file- bytes written to a page
+    // past EOF aren't guaranteed to survive the file growing later. On Linux
+    // the untouched part stays a hole, so it costs no disk space.
+    if(mfd->off_eof < mfd->off_eom) {
+        _(ftruncate(mfd->fd, mfd->off_eom)) _raise(-1);
+        mfd->off_eof = mfd->off_eom;
+    }
+    return 0;
+}
+
+/// Gets the file position cursor (used for normal IO) synced up with the
+/// position indicated by the mfd structure- when off_w or off_r has changed,
+/// etc.
+static inline int _gx_update_fpos(gx_mfd *mfd) {
+    size_t used_offset = mfd->type == GXMFDW ? mfd->off_w : mfd->off_r;
+    _(lseek(mfd->fd,used_offset+sizeof(gx_mfd_head),SEEK_SET)) _raise(-1);
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+// Writer
+//------------------------------------------------------------------------------
+
+static inline void *mfd_w(gx_mfd *mfd) { return mfd->data + mfd->off_w; }
+
+/// Room for len more bytes at the write cursor.
+static inline int mfd_reserve(gx_mfd *mfd, size_t len) {
+    return _gx_mfd_remap(mfd, mfd->off_w + len + sizeof(gx_mfd_head));
+}
+
+/// Makes everything written so far visible to readers and wakes any that are
+/// asleep. Only costs a syscall when someone is actually waiting.
+static inline int mfd_publish(gx_mfd *mfd) {
+    mfd->head->size = mfd->off_w;
+    __sync_fetch_and_add(&(mfd->head->seq), 1);
+    if(mfd->head->waiters) _(gx_futex_wake((void *)&(mfd->head->seq))) _raise(-1);
+    if(rare(mfd->off_w >= mfd->off_reclaim)) {
+        mfd->off_reclaim = mfd->off_w + GX_MFD_RECLAIM_CHUNK;
+        _ (gx_mfd_reclaim(mfd)) _raise(-1);
+        _ (_gx_advise_map(mfd)) _raise(-1);
+    }
+    return 0;
+}
+
+static inline int mfd_write(gx_mfd *mfd, const void *buf, size_t len) {
+    _(mfd_reserve(mfd, len)) _raise(-1);
+    memcpy(mfd_w(mfd), buf, len);
+    mfd->off_w += len;
+    return mfd_publish(mfd);
+}
+
+// Typed appends- these don't wake readers on their own, so a record made of
+// several of them shows up all at once on the next mfd_publish / mfd_write.
+#define _GX_MFD_WTYPED(NAME, BYTES, BE)                                      \
+    static inline int mfd_ ## NAME(gx_mfd *mfd, uint64_t v) {               \
+        uint8_t *p;                                                          \
+        int      i;                                                          \
+        _(mfd_reserve(mfd, BYTES)) _raise(-1);                               \
+        p = (uint8_t *)mfd_w(mfd);                                           \
+        for(i = 0; i < BYTES; i++)                                           \
+            p[i] = (uint8_t)(v >> (8 * ((BE) ? (BYTES - 1 - i) : i)));       \
+        mfd->off_w += BYTES;                                                 \
+        return 0;                                                            \
+    }
+_GX_MFD_WTYPED(wbyte, 1, 1)
+_GX_MFD_WTYPED(wbe16, 2, 1)
+_GX_MFD_WTYPED(wbe24, 3, 1)
+_GX_MFD_WTYPED(wbe32, 4, 1)
+_GX_MFD_WTYPED(wbe64, 8, 1)
+_GX_MFD_WTYPED(wle16, 2, 0)
+_GX_MFD_WTYPED(wle24, 3, 0)
+_GX_MFD_WTYPED(wle32, 4, 0)
+_GX_MFD_WTYPED(wle64, 8, 0)
+
+/**
+ * Punch out (GX_MFD_VOLATILE) whole pages that the writer and every live
+ * reader have moved past. Persistent mfds keep their data. Returns bytes
+ * released.
+ */
+static optional ssize_t gx_mfd_reclaim(gx_mfd *mfd) {
+    size_t low, from, upto;
+    if(!(mfd->head->flags & GX_MFD_VOLATILE)) return 0;
+    low  = gx_mreader_min(mfd->head->readers, GX_MFD_MAX_READERS, mfd->off_w);
+    // Data offsets- the header page itself is never freed
+    from = max((size_t)pagesize() - sizeof(gx_mfd_head), mfd->head->start_available);
+    upto = gx_mreader_release(&(mfd->head->start_available), mfd->head->readers, GX_MFD_MAX_READERS,
+                              from, low, sizeof(gx_mfd_head));
+    if(upto <= from) return 0;
+    _(gx_mreader_punch(mfd->fd, mfd->data + from, from + sizeof(gx_mfd_head), upto - from)) _raise(-1);
+    return upto - from;
+}
+
+
+//------------------------------------------------------------------------------
+// Reader
+//------------------------------------------------------------------------------
+
+static inline void  *mfd_r(gx_mfd *mfd) { return mfd->data + mfd->off_r; }
+
+static inline size_t mfd_available(gx_mfd *mfd) {
+    size_t size = mfd->head->size;
+    return size > mfd->off_r ? size - mfd->off_r : 0;
+}
+
+/// Consume len bytes- publishes the cursor for the writer's reclaiming and
+/// advises pages we're done with.
+static inline int mfd_advance(gx_mfd *mfd, size_t len) {
+    mfd->off_r += len;
+    mfd->head->readers[mfd->slot].off = mfd->off_r;
+    return _gx_advise_map(mfd);
+}
+
+/**
+ * Follow the writer. Blocks on the futex (no polling) for up to timeout_ms
+ * (-1 = forever) until there is unread data, then makes sure it's mapped.
+ * Returns bytes available at mfd_r(mfd), 0 on timeout or once the writer
+ * has closed and everything was consumed, -1 on error.
+ */
+static optional ssize_t gx_mfd_follow(gx_mfd *mfd, int timeout_ms) {
+    size_t avail;
+    struct timespec ts, *tsp = NULL;
+    if(timeout_ms >= 0) {
+        ts.tv_sec  = timeout_ms / 1000;
+        ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+        tsp = &ts;
+    }
+    for(;;) {
+        uint32_t seq = mfd->head->seq;
+        __sync_synchronize();
+        if((avail = mfd_available(mfd)) || !mfd->head->writer) break;
+        __sync_fetch_and_add(&(mfd->head->waiters), 1);
+        int res = 0;
+        #ifdef __LINUX__
+          if(mfd->head->seq == seq)
+              res = syscall(SYS_futex, (void *)&(mfd->head->seq), FUTEX_WAIT, (int)seq, tsp, NULL, 0);
+        #else
+          gx_sleep(0,2000);
+        #endif
+        __sync_fetch_and_sub(&(mfd->head->waiters), 1);
+        if(res == -1) {
+            if(errno == ETIMEDOUT) { errno = 0; return 0; }
+            if(errno != EAGAIN && errno != EINTR) _raise(-1);
+            errno = 0;
+        }
+    }
+    if(avail) _(_gx_mfd_remap(mfd, mfd->off_r + avail + sizeof(gx_mfd_head))) _raise(-1);
+    return avail;
+}
+
+static inline ssize_t mfd_read(gx_mfd *mfd, void *buf, size_t len) {
+    len = min(len, mfd_available(mfd));
+    if(!len) return 0;
+    _(_gx_mfd_remap(mfd, mfd->off_r + len + sizeof(gx_mfd_head))) _raise(-1);
+    memcpy(buf, mfd_r(mfd), len);
+    _(mfd_advance(mfd, len)) _raise(-1);
+    return len;
+}
+
+/// Resets notify_fd after the event loop reported it readable.
+static inline int mfd_notified(gx_mfd *mfd) {
+    return gx_mnotify_drain(&(mfd->notify));
+}
+
+#endif
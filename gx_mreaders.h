@@ -0,0 +1,214 @@
+/**
+  Reader bookkeeping shared by the single-writer / many-reader mappings
+  (gx_mapc, gx_mfd).
+
+  Both keep a small head page in the shared file with a futex word (seq), the
+  published size, the writer's pid and a table of reader slots. A reader
+  claims a slot and publishes its cursor there so the writer knows which
+  pages everyone is done with; slots of readers that died are taken over (or
+  freed by the writer while it looks for the slowest reader).
+
+  Readers that want to sit in an event loop get a gx_mnotify- a small helper
+  thread that sleeps on seq and bumps an eventfd (a pipe where there are
+  none) whenever the size moves or the writer goes away. A thread rather than
+  gx_clone so that errno etc. stay thread-local. It compares against the
+  cursor it was started with, so data already written when the reader opened
+  is reported right away and nothing is missed while the caller sets up its
+  loop.
+
+ | function                          | description                                                   |
+ | --------------------------------- | ------------------------------------------------------------- |
+ | gx_mreader_claim(slots,n,off)     | Claim a free (or dead reader's) slot with cursor off. Ret idx |
+ | gx_mreader_min(slots,n,low)       | Lowest cursor of the live readers (or low). Frees dead slots  |
+ | gx_mreader_release(start,...)     | W: advance start past what every reader is done with. Ret it  |
+ | gx_mreader_punch(fd,addr,off,len) | Give back a consumed range: punch a hole, else MADV_REMOVE    |
+ | gx_mnotify_start(n,...)           | Start the helper thread. n->notify_fd is the fd to poll       |
+ | gx_mnotify_drain(n)               | Reset notify_fd after it polled readable                      |
+ | gx_mnotify_stop(n)                | Stop the helper and close the fds                             |
+
+*/
+#ifndef GX_MREADERS_H
+#define GX_MREADERS_H
+
+#include "./gx.h"
+#include "./gx_error.h"
+
+#include <sys/mman.h>
+#include <signal.h>
+#ifdef __LINUX__
+  #include <linux/falloc.h>
+  #include <sys/eventfd.h>
+#endif
+
+/// Lives in the shared head page- the layout is part of the file format.
+typedef struct gx_mreader_slot {
+    volatile pid_t    pid;           ///< 0 when free
+    uint32_t          _pad;
+    volatile uint64_t off;           ///< Everything before this has been consumed
+} gx_mreader_slot;
+
+typedef struct gx_mnotify {
+    int                 notify_fd;   ///< Readable when there is new data
+    int                 in_fd;       ///< Write side of notify_fd (== notify_fd for eventfd)
+    volatile int        state;       ///< 0=stopped 1=running 2=stop-requested
+    pthread_t           thread;
+    uint64_t            seen;        ///< Size last reported
+    volatile uint32_t  *seq;         ///< Futex word in the head page
+    volatile uint32_t  *waiters;     ///< Sleeper count the writer checks before waking (or NULL)
+    volatile uint64_t  *size;
+    volatile pid_t     *writer;      ///< 0 once the writer has closed
+} gx_mnotify;
+
+static inline int _gx_mreader_alive(pid_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+/// Claims a free slot (or one left behind by a dead reader). The cursor is
+/// only written once the slot is ours- a racer that loses the CAS must not
+/// touch the winner's. Until then the writer may still see the previous
+/// owner's cursor, so the caller re-checks what's still available afterwards.
+static optional int gx_mreader_claim(gx_mreader_slot *slots, int n, uint64_t off) {
+    int   i;
+    pid_t me = getpid();
+    for(i = 0; i < n; i++) {
+        pid_t p = slots[i].pid;
+        if(p != 0 && _gx_mreader_alive(p)) continue;
+        if(__sync_bool_compare_and_swap(&(slots[i].pid), p, me)) {
+            slots[i].off = off;
+            __sync_synchronize();
+            return i;
+        }
+    }
+    errno = EMFILE;
+    return -1;
+}
+
+/// Lowest cursor of any live reader, or low if they're all past it. Slots of
+/// readers that died are freed on the way.
+static optional uint64_t gx_mreader_min(gx_mreader_slot *slots, int n, uint64_t low) {
+    int i;
+    for(i = 0; i < n; i++) {
+        pid_t pid = slots[i].pid;
+        if(!pid) continue;
+        if(rare(!_gx_mreader_alive(pid))) {
+            __sync_bool_compare_and_swap(&(slots[i].pid), pid, 0);
+            continue;
+        }
+        if(slots[i].off < low) low = slots[i].off;
+    }
+    return low;
+}
+
+/// Writer: moves *start (the readers' starting point) up to the last page
+/// boundary at or below low- a gx_mreader_min() result- and returns how far
+/// data may now be freed (from, the first freeable offset, if nothing). Data
+/// offset d is on a boundary when d + skew is (skew: data's offset within its
+/// page).
+///
+/// A reader attaching meanwhile stores its cursor, fences and then re-reads
+/// start, so the writer does the mirror image: publish the candidate, fence,
+/// and scan the slots again. Either the re-scan sees the new reader or the
+/// reader sees the new start. If the re-scan finds someone lower, start is
+/// pulled back to what's actually freed (readers that already jumped ahead
+/// are unaffected) so a later round can still give those pages back.
+static optional uint64_t gx_mreader_release(volatile uint64_t *start, gx_mreader_slot *slots, int n,
+                                            uint64_t from, uint64_t low, size_t skew) {
+    uint64_t mask = (uint64_t)pagesize() - 1, prev = *start, upto;
+    if((upto = (low + skew) & ~mask) <= from + skew) return from;
+    *start = upto -= skew;
+    __sync_synchronize();
+    if(rare((low = gx_mreader_min(slots, n, upto)) < upto)) {
+        upto = (low + skew) & ~mask;
+        upto = upto <= from + skew ? from : upto - skew;
+        *start = upto > from ? upto : prev;
+        __sync_synchronize();
+    }
+    return upto;
+}
+
+/// Frees len bytes of fd at file offset off (mapped at addr). The caller has
+/// already moved its start_available past them.
+static optional int gx_mreader_punch(int fd, void *addr, off_t off, size_t len) {
+    #ifdef __LINUX__
+      if(fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, off, len) == -1) {
+          if(errno != EOPNOTSUPP) _raise(-1);
+          _ (madvise(addr, len, MADV_REMOVE)) _raise(-1);
+      }
+    #else
+      _ (madvise(addr, len, MADV_DONTNEED)) _raise(-1);
+    #endif
+    return 0;
+}
+
+/// Turns futex wakeups into eventfd/pipe writes.
+static void *_gx_mnotify_loop(void *vn) {
+    gx_mnotify *n   = (gx_mnotify *)vn;
+    uint64_t    one = 1;
+    for(;;) {
+        uint32_t seq = *(n->seq);       // Before anything else so no wakeup gets lost
+        __sync_synchronize();
+        if(rare(n->state != 1)) break;
+        uint64_t size = *(n->size);
+        if(size != n->seen || !*(n->writer)) {
+            n->seen = size;
+            if(write(n->in_fd, &one, sizeof(one)) == -1 && errno != EAGAIN) break;
+            if(!*(n->writer)) break;
+        }
+        if(n->waiters) __sync_fetch_and_add(n->waiters, 1);
+        #ifdef __LINUX__
+          if(*(n->seq) == seq) _gx_futex((void *)n->seq, FUTEX_WAIT, (int)seq);
+        #else
+          gx_sleep(0,2000);
+        #endif
+        if(n->waiters) __sync_fetch_and_sub(n->waiters, 1);
+    }
+    return NULL;
+}
+
+/// seen is the reader's cursor- anything published past it is reported at once.
+static optional int gx_mnotify_start(gx_mnotify *n, volatile uint32_t *seq, volatile uint32_t *waiters,
+                                     volatile uint64_t *size, volatile pid_t *writer, uint64_t seen) {
+    n->seq     = seq;
+    n->waiters = waiters;
+    n->size    = size;
+    n->writer  = writer;
+    n->seen    = seen;
+    #ifdef __LINUX__
+      _ (n->notify_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) _raise(-1);
+      n->in_fd = n->notify_fd;
+    #else
+      int pipes[2];
+      _ (pipe(pipes)                           ) _raise(-1);
+      n->notify_fd = pipes[0];
+      n->in_fd     = pipes[1];
+      _ (fcntl(pipes[0], F_SETFL, O_NONBLOCK)  ) _raise(-1);
+      _ (fcntl(pipes[1], F_SETFL, O_NONBLOCK)  ) _raise(-1);
+    #endif
+    n->state = 1;
+    _E (pthread_create(&(n->thread), NULL, _gx_mnotify_loop, (void *)n)) {n->state = 0; _raise(-1);}
+    return 0;
+}
+
+/// Safe on one that never started (notify_fd/in_fd -1, state 0).
+static optional void gx_mnotify_stop(gx_mnotify *n) {
+    if(n->state == 1) {
+        n->state = 2;
+        __sync_fetch_and_add(n->seq, 1);
+        gx_futex_wake((void *)n->seq);  // Other readers just re-check and go back to sleep
+        pthread_join(n->thread, NULL);
+        n->state = 0;
+    }
+    if(n->notify_fd != -1)                           close(n->notify_fd);
+    if(n->in_fd != -1 && n->in_fd != n->notify_fd)  close(n->in_fd);
+    n->notify_fd = n->in_fd = -1;
+}
+
+static inline int gx_mnotify_drain(gx_mnotify *n) {
+    uint64_t cnt;
+    ssize_t  r;
+    while((r = read(n->notify_fd, &cnt, sizeof(cnt))) > 0);
+    if(r == -1 && errno != EAGAIN && errno != EWOULDBLOCK) _raise(-1);
+    return 0;
+}
+
+#endif
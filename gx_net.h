@@ -1,6 +1,3 @@
-/**
- * @todo  binary version of gx_node_uid
- */
 #ifndef GX_NET_H
 #define GX_NET_H
 
@@ -116,68 +113,87 @@ static inline unsigned int gx_net_daemonize(void) {
 
 
 #ifdef __LINUX__
-#include <sys/ioctl.h>
-#include <net/if.h>
+#include <netpacket/packet.h>
+#include <net/if_arp.h>
 #else
 #include <net/if_dl.h>
 #endif
 
-#define GX_NODE_UID_LEN (SHA256_DIGEST_STRING_LENGTH+1)
-static char _gx_node_uid_memoized[GX_NODE_UID_LEN] = "";
-static int  _gx_node_uid_is_memoized = 0;
-
-static inline int gx_node_uid(char *buf) {
-    if(rare(!_gx_node_uid_is_memoized)) {
-        char             rawdat[1024];
-        size_t           len = 0;
+#define GX_NODE_UID_BINSIZE SHA256_DIGEST_LENGTH
+#define GX_NODE_UID_LEN     (SHA256_DIGEST_STRING_LENGTH+1)
+static uint8_t _gx_node_uid_memoized[GX_NODE_UID_BINSIZE];
+static int     _gx_node_uid_is_memoized = 0;   ///< 0 no, 1 being stored, 2 yes
+
+/// SHA-256 of the host's network config- every ethernet hardware address
+/// plus every IPv4/IPv6 address- so the same for all processes on a host
+/// until its interfaces change.
+///
+/// It all comes out of a single getifaddrs() (one netlink socket on linux,
+/// where the hardware addresses are its AF_PACKET entries- no socket +
+/// ioctl per interface), and is memoized: call it once before forking
+/// workers and they all inherit the value without asking the kernel again.
+/// Threads racing on first use (lazily initialized gx_nonce_local()
+/// machines) each hash into their own buffer; one of them stores the memo
+/// and publishes it with a release, so nobody copies a half-written one.
+static inline int gx_node_uid_bin(uint8_t *bin) {
+    if(rare(__atomic_load_n(&_gx_node_uid_is_memoized, __ATOMIC_ACQUIRE) != 2)) {
         struct ifaddrs  *ifaddr, *ifa;
+        SHA256_CTX       ctx;
+        uint8_t          digest[GX_NODE_UID_BINSIZE];
 
         log_debug("Constructing node uid for the first time.");
         _ (getifaddrs(&ifaddr)) _raise(-1);
-        for(ifa=ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+        SHA256_Init(&ctx);
+        for(ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+            if(!ifa->ifa_addr) continue;
+            switch(ifa->ifa_addr->sa_family) {
           #ifdef __LINUX__
-            struct ifreq ifinfo;
-            int sd, res;
-            strcpy(ifinfo.ifr_name, ifa->ifa_name);
-            _ (sd = socket(AF_INET, SOCK_DGRAM, 0)   ) _warning();
-            _ (res= ioctl(sd, SIOCGIFHWADDR, &ifinfo)) _warning();
-            close(sd);
-
-            if ((res == 0) && (ifinfo.ifr_hwaddr.sa_family == 1)) {
-                memcpy(rawdat + len, ifinfo.ifr_hwaddr.sa_data, IFHWADDRLEN);
-                len += IFHWADDRLEN;
+            case AF_PACKET: {
+                struct sockaddr_ll *ll = (struct sockaddr_ll *)ifa->ifa_addr;
+                if(ll->sll_hatype == ARPHRD_ETHER) SHA256_Update(&ctx, ll->sll_addr, ll->sll_halen);
+                break;
             }
           #else
-            if ((ifa->ifa_addr->sa_family == AF_LINK) && ifa->ifa_addr) {
-                struct sockaddr_dl* sdl = (struct sockaddr_dl*)ifa->ifa_addr;
-                memcpy(rawdat + len, LLADDR(sdl), sdl->sdl_alen);
-                len += sdl->sdl_alen;
-                rawdat[len++] = '|';
+            case AF_LINK: {
+                struct sockaddr_dl *sdl = (struct sockaddr_dl *)ifa->ifa_addr;
+                SHA256_Update(&ctx, (uint8_t *)LLADDR(sdl), sdl->sdl_alen);
+                SHA256_Update(&ctx, (uint8_t *)"|", 1);
+                break;
             }
           #endif
-
-            int family = ifa->ifa_addr->sa_family;
-            if(family == AF_INET) {
-                size_t sz = 4;
-                memcpy(rawdat + len,
-                        &(((struct sockaddr_in *)(ifa->ifa_addr))->sin_addr.s_addr), sz);
-                len += sz;
-            } else if(family == AF_INET6) {
-                size_t sz = 16;
-                memcpy(rawdat + len,
-                        &(((struct sockaddr_in6 *)(ifa->ifa_addr))->sin6_addr.s6_addr), sz);
-                len += sz;
+            case AF_INET:
+                SHA256_Update(&ctx, (uint8_t *)&((struct sockaddr_in *)ifa->ifa_addr)->sin_addr.s_addr, 4);
+                break;
+            case AF_INET6:
+                SHA256_Update(&ctx, ((struct sockaddr_in6 *)ifa->ifa_addr)->sin6_addr.s6_addr, 16);
+                break;
             }
         }
-        rawdat[len] = '\0';
         freeifaddrs(ifaddr);
-        SHA256_Data((sha2_byte *)rawdat, len, _gx_node_uid_memoized);
-        _gx_node_uid_memoized[GX_NODE_UID_LEN-1] = '\0';
-        _gx_node_uid_is_memoized = 1;
+        SHA256_Final(digest, &ctx);
+        if(__sync_bool_compare_and_swap(&_gx_node_uid_is_memoized, 0, 1)) {
+            memcpy(_gx_node_uid_memoized, digest, GX_NODE_UID_BINSIZE);
+            __atomic_store_n(&_gx_node_uid_is_memoized, 2, __ATOMIC_RELEASE);
+        }
+        memcpy(bin, digest, GX_NODE_UID_BINSIZE);
+        return 0;
     }
-    memcpy(buf, _gx_node_uid_memoized, GX_NODE_UID_LEN);
+    memcpy(bin, _gx_node_uid_memoized, GX_NODE_UID_BINSIZE);
     return 0;
 }
 
+/// gx_node_uid_bin as a hex string- buf needs GX_NODE_UID_LEN bytes.
+static inline int gx_node_uid(char *buf) {
+    static const char hex[] = "0123456789abcdef";
+    uint8_t           bin[GX_NODE_UID_BINSIZE];
+    int               i;
+    _ (gx_node_uid_bin(bin)) _raise(-1);
+    for(i = 0; i < GX_NODE_UID_BINSIZE; i++) {
+        buf[i * 2]     = hex[bin[i] >> 4];
+        buf[i * 2 + 1] = hex[bin[i] & 15];
+    }
+    buf[GX_NODE_UID_BINSIZE * 2] = '\0';
+    return 0;
+}
 
 #endif
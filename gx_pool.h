@@ -3,6 +3,73 @@
 
 #include "./gx_error.h"
 
+// Optional instrumentation. Build with -DGX_POOL_STATS for per-pool counters
+// (pool->stats) and -DGX_POOL_TRACE to additionally record where every live
+// object was acquired (implies GX_POOL_STATS). TYPE_pool_dump(pool) prints it
+// all to stderr. Without either flag all of it compiles away.
+#ifdef GX_POOL_TRACE
+  #ifndef GX_POOL_STATS
+    #define GX_POOL_STATS
+  #endif
+#endif
+
+typedef struct gx_pool_stats {
+    uint64_t  acquired;           ///< Successful acquires
+    uint64_t  released;           ///< Releases (including finrelease)
+    uint64_t  in_use;             ///< Currently acquired
+    uint64_t  in_use_peak;        ///< High-water mark of in_use- use it to size initial_number
+    uint64_t  extends;            ///< Times the pool allocated a segment (including the first)
+    uint64_t  bytes_reserved;     ///< Bytes malloced for objects + bookkeeping
+    uint64_t  acquire_ticks;      ///< Total cpu_ts ticks spent inside acquire (incl. extends)
+    uint64_t  acquire_ticks_max;  ///< Slowest single acquire
+} gx_pool_stats;
+
+typedef struct gx_pool_site {
+    const char *file;
+    int         line;
+} gx_pool_site;
+
+#ifdef GX_POOL_STATS
+  #define _gx_pool_stat(...)  __VA_ARGS__
+  #define _gx_pool_stats_of(POOL) (&((POOL)->stats))
+#else
+  #define _gx_pool_stat(...)
+  #define _gx_pool_stats_of(POOL) NULL
+#endif
+#ifdef GX_POOL_TRACE
+  #define _gx_pool_trace(...) __VA_ARGS__
+#else
+  #define _gx_pool_trace(...)
+#endif
+
+/// Acquire that records the call site when built with GX_POOL_TRACE. Same as
+/// acquire_TYPE(POOL) otherwise.
+#define gx_pool_acquire(TYPE, POOL) acquire_ ## TYPE ## _at((POOL), __FILE__, __LINE__)
+
+static inline void _gx_pool_stats_acquired(gx_pool_stats *st, uint64_t ticks) {
+    st->acquired ++;
+    if(++(st->in_use) > st->in_use_peak) st->in_use_peak = st->in_use;
+    st->acquire_ticks += ticks;
+    if(rare(ticks > st->acquire_ticks_max)) st->acquire_ticks_max = ticks;
+}
+
+static optional void gx_pool_stats_dump(const char *name, gx_pool_stats *st, size_t total_items) {
+    fprintf(stderr, "\n---------------- POOL: %s --------------------\n"
+                    "  total_items:    %zu\n", name, total_items);
+#ifdef GX_POOL_STATS
+    fprintf(stderr, "  acquired:       %" PRIu64 "\n" "  released:       %" PRIu64 "\n"
+                    "  in_use:         %" PRIu64 "\n" "  in_use_peak:    %" PRIu64 "\n"
+                    "  extends:        %" PRIu64 "\n" "  bytes_reserved: %" PRIu64 "\n"
+                    "  acquire_ticks:  %" PRIu64 " avg / %" PRIu64 " max\n",
+            st->acquired, st->released, st->in_use, st->in_use_peak, st->extends,
+            st->bytes_reserved, st->acquired ? st->acquire_ticks / st->acquired : 0,
+            st->acquire_ticks_max);
+#else
+    (void)st;
+    fprintf(stderr, "  (build with GX_POOL_STATS for counters)\n");
+#endif
+}
+
 // This macros is provided to help defining the intrusive fields required for objects
 // allocated by a memory pool.
 #define GX_POOL_OBJECT(TYPE)                    \
@@ -26,14 +93,20 @@
 // Reference counted objects have to provide a "void *_pool" and "size_t _refc" fields
   #define GX_POOL_REFC(TYPE, CONSTRUCT)                                                  \
                                                                                          \
-    static inline TYPE *acquire_ ## TYPE(TYPE ## _pool *pool) {                          \
+    static inline TYPE *acquire_ ## TYPE ## _at(TYPE ## _pool *pool,                     \
+                                               optional const char *file,                \
+                                               optional int line) {                      \
         TYPE *res = NULL;                                                                \
+        _gx_pool_stat(typeof(cpu_ts) _ts0 = cpu_ts;)                                     \
         pthread_mutex_lock(&(pool->mutex));                                              \
         if(rare(!pool->available_head))                                                  \
             if(TYPE ## _pool_extend(pool, pool->total_items) == -1) goto fin;            \
         res = pool->available_head;                                                      \
         pool->available_head = res->_next;                                               \
         _prepend_ ## TYPE(pool, res);                                                    \
+        _gx_pool_stat(_gx_pool_stats_acquired(&(pool->stats),                            \
+                                              (typeof(cpu_ts))(cpu_ts - _ts0));)         \
+        _gx_pool_trace(_ ## TYPE ## _pool_set_site(pool, res, file, line);)              \
       fin:                                                                               \
         pthread_mutex_unlock(&(pool->mutex));                                            \
         if(freq(res != NULL)) {                                                          \
@@ -46,6 +119,9 @@
             }                                                                            \
         }                                                                                \
         return res;                                                                      \
+    }                                                                                    \
+    static inline TYPE *acquire_ ## TYPE(TYPE ## _pool *pool) {                          \
+        return acquire_ ## TYPE ## _at(pool, NULL, 0);                                   \
     }                                                                                    \
                                                                                          \
     static inline void TYPE ## _incr_refc(TYPE *entry) {                                 \
@@ -62,14 +138,20 @@
 // memory pool allocates simple objects.
   #define GX_POOL_SIMPLE(TYPE, CONSTRUCT)                                                \
                                                                                          \
-    static inline TYPE *acquire_ ## TYPE(TYPE ## _pool *pool) {                          \
+    static inline TYPE *acquire_ ## TYPE ## _at(TYPE ## _pool *pool,                     \
+                                               optional const char *file,                \
+                                               optional int line) {                      \
         TYPE *res = NULL;                                                                \
+        _gx_pool_stat(typeof(cpu_ts) _ts0 = cpu_ts;)                                     \
         pthread_mutex_lock(&(pool->mutex));                                              \
         if(rare(!pool->available_head))                                                  \
             if(TYPE ## _pool_extend(pool, pool->total_items) == -1) goto fin;            \
         res = pool->available_head;                                                      \
         pool->available_head = res->_next;                                               \
         _prepend_ ## TYPE(pool, res);                                                    \
+        _gx_pool_stat(_gx_pool_stats_acquired(&(pool->stats),                            \
+                                              (typeof(cpu_ts))(cpu_ts - _ts0));)         \
+        _gx_pool_trace(_ ## TYPE ## _pool_set_site(pool, res, file, line);)              \
       fin:                                                                               \
         pthread_mutex_unlock(&(pool->mutex));                                            \
         if(freq(res != NULL)) {                                                          \
@@ -79,6 +161,9 @@
             }                                                                            \
         }                                                                                \
         return res;                                                                      \
+    }                                                                                    \
+    static inline TYPE *acquire_ ## TYPE(TYPE ## _pool *pool) {                          \
+        return acquire_ ## TYPE ## _at(pool, NULL, 0);                                   \
     }
 
 // TYPE must be a type that has a "_next" and "_prev" member that is a pointer to the same
@@ -88,6 +173,8 @@
     typedef struct pool_memory_segment ## TYPE {                                         \
         struct pool_memory_segment ## TYPE  *next;                                       \
         TYPE                                *segment;                                    \
+        _gx_pool_trace(size_t                count;)                                     \
+        _gx_pool_trace(gx_pool_site         *sites;)                                     \
     } pool_memory_segment ## TYPE;                                                       \
                                                                                          \
     typedef struct TYPE ## _pool {                                                       \
@@ -98,6 +185,7 @@
         TYPE                                *active_tail;                                \
         TYPE                                *prereleased[0x10000];                       \
         pool_memory_segment ## TYPE         *memseg_head;                                \
+        _gx_pool_stat(gx_pool_stats          stats;)                                     \
     } TYPE ## _pool;                                                                     \
                                                                                          \
     static int TYPE ## _pool_extend(TYPE ## _pool *pool, size_t by_number);              \
@@ -127,6 +215,7 @@
                 seg2 = seg1;                                                             \
                 seg1 = seg1->next;                                                       \
                 free(seg2->segment);                                                     \
+                _gx_pool_trace(free(seg2->sites);)                                       \
                 free(seg2);                                                              \
             }                                                                            \
             pthread_mutex_unlock(&(pool->mutex));                                        \
@@ -146,6 +235,10 @@
            malloc(sizeof(pool_memory_segment ## TYPE))) _raise(-1);                      \
         memseg_entry->segment = new_seg;                                                 \
         memseg_entry->next    = pool->memseg_head;                                       \
+        _gx_pool_trace(memseg_entry->count = by_number;)                                 \
+        _gx_pool_trace(_N(memseg_entry->sites = (gx_pool_site *)                         \
+                    calloc(by_number, sizeof(gx_pool_site))) {                           \
+            free(memseg_entry); free(new_seg); _raise(-1); })                            \
                                                                                          \
         /* Link them up */                                                               \
         for(curr = 0; curr < by_number; ++curr) {                                        \
@@ -153,6 +246,7 @@
                 while(curr-- != 0) {                                                     \
                     DEALLOCATE(new_seg + curr);                                          \
                 }                                                                        \
+                _gx_pool_trace(free(memseg_entry->sites);)                               \
                 free(memseg_entry);                                                      \
                 free(new_seg);                                                           \
                 _raise(-1);                                                              \
@@ -170,9 +264,41 @@
         pool->available_head = new_seg;                                                  \
         pool->total_items += by_number;                                                  \
         pool->memseg_head = memseg_entry;                                                \
+        _gx_pool_stat(pool->stats.extends ++;)                                           \
+        _gx_pool_stat(pool->stats.bytes_reserved += sizeof(TYPE) * by_number             \
+                    + sizeof(pool_memory_segment ## TYPE)                                \
+                    _gx_pool_trace(+ sizeof(gx_pool_site) * by_number);)                 \
         return 0;                                                                        \
     }                                                                                    \
                                                                                          \
+    _gx_pool_trace(                                                                      \
+    static gx_pool_site *_ ## TYPE ## _pool_site(TYPE ## _pool *pool, TYPE *entry) {     \
+        pool_memory_segment ## TYPE *seg;                                                \
+        for(seg = pool->memseg_head; seg != NULL; seg = seg->next)                       \
+            if(entry >= seg->segment && entry < seg->segment + seg->count)               \
+                return &(seg->sites[entry - seg->segment]);                              \
+        return NULL;                                                                     \
+    }                                                                                    \
+    static inline void _ ## TYPE ## _pool_set_site(TYPE ## _pool *pool, TYPE *entry,     \
+                                                   const char *file, int line) {         \
+        gx_pool_site *site = _ ## TYPE ## _pool_site(pool, entry);                       \
+        if(freq(site != NULL)) { site->file = file; site->line = line; }                 \
+    })                                                                                   \
+                                                                                         \
+    /* Counters, plus (GX_POOL_TRACE) every object that is still acquired */             \
+    static optional void TYPE ## _pool_dump(TYPE ## _pool *pool) {                       \
+        pthread_mutex_lock(&(pool->mutex));                                              \
+        gx_pool_stats_dump(#TYPE, _gx_pool_stats_of(pool), pool->total_items);          \
+        _gx_pool_trace(                                                                  \
+        TYPE *ptr;                                                                       \
+        for(ptr = pool->active_head; ptr != NULL; ptr = ptr->_next) {                    \
+            gx_pool_site *site = _ ## TYPE ## _pool_site(pool, ptr);                     \
+            fprintf(stderr, "  unreleased %p  acquired at %s:%d\n", (void *)ptr,          \
+                    site && site->file ? site->file : "(unknown)", site ? site->line : 0);\
+        })                                                                               \
+        pthread_mutex_unlock(&(pool->mutex));                                            \
+    }                                                                                    \
+                                                                                         \
     static inline void _prepend_ ## TYPE (TYPE ## _pool *pool, TYPE *entry) {            \
         /* put an object at the front of the active list */                              \
         entry->_next = pool->active_head;                                                \
@@ -209,6 +335,7 @@
         entry->_next = pool->available_head;                                             \
         pool->available_head = entry;                                                    \
         pool->prereleased[idx] = NULL;                                                   \
+        _gx_pool_stat(pool->stats.released ++; pool->stats.in_use --;)                   \
         pthread_mutex_unlock(&(pool->mutex));                                            \
     }                                                                                    \
                                                                                          \
@@ -218,6 +345,7 @@
         _remove_ ## TYPE(pool, entry);                                                   \
         entry->_next = pool->available_head;                                             \
         pool->available_head = entry;                                                    \
+        _gx_pool_stat(pool->stats.released ++; pool->stats.in_use --;)                   \
         pthread_mutex_unlock(&(pool->mutex));                                            \
     }                                                                                    \
                                                                                          \
@@ -256,4 +384,253 @@
                         _construct_  ## TYPE,                                            \
                         _destroy_    ## TYPE)
 
+/*=============================================================================
+ * Cross-process (shared-memory) pools
+ *
+ * Same idea as above but the whole pool- bookkeeping, lock and objects- lives
+ * inside a single shared mapping so that several processes can acquire and
+ * release the same objects. Because the mapping can land at different
+ * addresses in different processes, nothing inside it is a pointer: free-list
+ * links are slot indexes and objects are handed between processes as byte
+ * offsets (see TYPE_shpool_ref / TYPE_shpool_deref).
+ *
+ * - path == NULL gives an anonymous shared mapping, inherited by fork()ed
+ *   children. Otherwise the pool is backed by a file (ideally on /dev/shm)
+ *   and any process that opens the same path attaches to the same pool.
+ * - The lock is a robust, process-shared mutex. If a process dies while
+ *   holding it, the next locker rebuilds the free list from the per-slot
+ *   owner pids and reclaims every slot whose owner no longer exists.
+ * - Each slot records the pid that acquired it. TYPE_shpool_reap() returns
+ *   the slots of dead processes to the free list- done automatically when the
+ *   pool runs dry, but at most once per GX_SHPOOL_REAP_MS: it's a kill(0) per
+ *   slot under the lock, and while the pool stays exhausted every acquire
+ *   would otherwise pay for it (and hold up every other process).
+ * - Size is fixed at creation (no extending- other processes could not see a
+ *   new mapping). Attaching maps the size the creator chose, whatever number
+ *   is passed. acquire returns NULL w/ errno=ENOMEM when it's exhausted.
+ * - TYPE does not need the intrusive _next/_prev fields.
+ *
+ *   gx_pool_init_shared(TYPE, CONSTRUCT, DESTROY)
+ *   TYPE_shpool *new_TYPE_shpool     (number, path)
+ *   TYPE        *acquire_shared_TYPE (pool)
+ *   void         release_shared_TYPE (pool, obj)
+ *   uint64_t     TYPE_shpool_ref     (pool, obj)   -> offset valid in any process
+ *   TYPE        *TYPE_shpool_deref   (pool, off)
+ *   int          TYPE_shpool_reap    (pool)        -> number of slots reclaimed
+ *   int          destroy_TYPE_shpool (pool)        -> unmaps (file is left alone)
+ *---------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <sys/file.h>
+#include <signal.h>
+
+#define _GX_SHPOOL_SIG UINT64_C(0x1d1d1d1d1d1d1d1d)
+#ifndef GX_SHPOOL_REAP_MS
+  #define GX_SHPOOL_REAP_MS 100
+#endif
+
+/// System-wide (the same in every process attached to a pool)
+static inline uint64_t _gx_shpool_now_ms() {
+    struct timespec ts;
+#ifdef CLOCK_MONOTONIC_COARSE
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+  #define gx_pool_init_shared(TYPE, CONSTRUCT, DESTROY)                                  \
+                                                                                         \
+    typedef struct TYPE ## _shslot {                                                     \
+        uint32_t                             _next;  /* index+1 of next free, 0=end */   \
+        volatile pid_t                       _owner; /* 0 when free */                   \
+        TYPE                                 obj;                                        \
+    } TYPE ## _shslot;                                                                   \
+                                                                                         \
+    typedef struct TYPE ## _shpool {                                                     \
+        volatile uint64_t                    sig;                                        \
+        pthread_mutex_t                      mutex;                                      \
+        size_t                               map_size;                                   \
+        uint32_t                             total_items;                                \
+        uint32_t                             in_use;                                     \
+        uint32_t                             available_head; /* index+1, 0=empty */      \
+        uint64_t                             next_reap_ms;   /* no dry reap before */    \
+        TYPE ## _shslot                      slots[] __attribute__((aligned(16)));       \
+    } TYPE ## _shpool;                                                                   \
+                                                                                         \
+    static inline int _ ## TYPE ## _shpool_dead(pid_t owner) {                           \
+        return owner != 0 && kill(owner, 0) == -1 && errno == ESRCH;                     \
+    }                                                                                    \
+                                                                                         \
+    /* Rebuild the free list from scratch using the slot owners. Lock held. */           \
+    static int _ ## TYPE ## _shpool_rebuild(TYPE ## _shpool *pool) {                     \
+        uint32_t i, reclaimed = 0;                                                       \
+        pool->available_head = 0;                                                        \
+        pool->in_use         = 0;                                                        \
+        for(i = pool->total_items; i-- > 0; ) {                                          \
+            TYPE ## _shslot *slot = &(pool->slots[i]);                                   \
+            if(rare(_ ## TYPE ## _shpool_dead(slot->_owner))) {                          \
+                DESTROY(&(slot->obj));                                                   \
+                slot->_owner = 0;                                                        \
+                reclaimed ++;                                                            \
+            }                                                                            \
+            if(slot->_owner == 0) {                                                      \
+                slot->_next          = pool->available_head;                             \
+                pool->available_head = i + 1;                                            \
+            } else pool->in_use ++;                                                      \
+        }                                                                                \
+        return reclaimed;                                                                \
+    }                                                                                    \
+                                                                                         \
+    static inline int _ ## TYPE ## _shpool_lock(TYPE ## _shpool *pool) {                 \
+        int res = pthread_mutex_lock(&(pool->mutex));                                    \
+        if(rare(res == EOWNERDEAD)) {                                                    \
+            log_warning("Previous owner of a shared pool died. Recovering.");            \
+            _ ## TYPE ## _shpool_rebuild(pool);                                          \
+            _E(pthread_mutex_consistent(&(pool->mutex))) _raise(-1);                     \
+        } else _E(res) _raise(-1);                                                       \
+        return 0;                                                                        \
+    }                                                                                    \
+                                                                                         \
+    /* Error-path cleanup for new_TYPE_shpool- keeps errno */                          \
+    static void _ ## TYPE ## _shpool_undo(TYPE ## _shpool *res, size_t map_size,        \
+                                         int fd) {                                       \
+        int e = errno;                                                                   \
+        if(res != NULL) munmap(res, map_size);                                           \
+        if(fd != -1) { flock(fd, LOCK_UN); close(fd); }                                  \
+        errno = e;                                                                       \
+    }                                                                                    \
+                                                                                         \
+    static inline TYPE ## _shpool *new_ ## TYPE ## _shpool(size_t number,                \
+                                                           const char *path) {           \
+        TYPE ## _shpool     *res = NULL, hdr;                                            \
+        pthread_mutexattr_t  attr;                                                       \
+        struct stat          st;                                                         \
+        size_t               map_size;                                                   \
+        int                  fd = -1, mflags = MAP_SHARED | MAP_ANON, attach = 0;        \
+        if(rare(number == 0 || number > UINT32_MAX - 1)) {errno = EINVAL; return NULL;}  \
+        map_size = gx_in_pages(sizeof(TYPE ## _shpool)                                   \
+                               + number * sizeof(TYPE ## _shslot));                      \
+        if(path) {                                                                       \
+            _ (fd = open(path, O_RDWR | O_CREAT, S_IRUSR|S_IWUSR|S_IRGRP|S_IWGRP))       \
+                _raise(NULL);                                                            \
+            /* Serializes initialization against other processes attaching */            \
+            _ (flock(fd, LOCK_EX)) {close(fd); _raise(NULL);}                            \
+            _ (fstat(fd, &st)) {_ ## TYPE ## _shpool_undo(NULL, 0, fd); _raise(NULL);}   \
+            /* A live pool keeps its own size- never truncate it under its users */      \
+            if((size_t)st.st_size >= sizeof(hdr)                                         \
+               && pread(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr)                \
+               && hdr.sig == _GX_SHPOOL_SIG) {                                           \
+                if(rare(hdr.map_size > (size_t)st.st_size)) {                            \
+                    _ ## TYPE ## _shpool_undo(NULL, 0, fd);                              \
+                    errno = EINVAL;                                                      \
+                    return NULL;                                                         \
+                }                                                                        \
+                map_size = hdr.map_size;                                                 \
+                attach   = 1;                                                            \
+            } else if((size_t)st.st_size < map_size) {                                   \
+                _ (ftruncate(fd, map_size)) {                                            \
+                    _ ## TYPE ## _shpool_undo(NULL, 0, fd);                              \
+                    _raise(NULL);                                                        \
+                }                                                                        \
+            }                                                                            \
+            mflags = MAP_SHARED;                                                         \
+        }                                                                                \
+        _M(res = (TYPE ## _shpool *)mmap(NULL, map_size, PROT_READ | PROT_WRITE,         \
+                                         mflags, fd, 0)) {                               \
+            _ ## TYPE ## _shpool_undo(NULL, 0, fd);                                      \
+            _raise(NULL);                                                                \
+        }                                                                                \
+        if(!attach) {                                                                    \
+            memset(res, 0, sizeof(TYPE ## _shpool));                                     \
+            res->map_size    = map_size;                                                 \
+            res->total_items = (uint32_t)number;                                         \
+            _E(pthread_mutexattr_init(&attr)) {                                          \
+                _ ## TYPE ## _shpool_undo(res, map_size, fd);                            \
+                _raise(NULL);                                                            \
+            }                                                                            \
+            _E(pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED)) _goto(_failed);\
+            _E(pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST))    _goto(_failed);\
+            _E(pthread_mutex_init(&(res->mutex), &attr))                    _goto(_failed);\
+            pthread_mutexattr_destroy(&attr);                                            \
+            _ ## TYPE ## _shpool_rebuild(res);                                           \
+            __sync_synchronize();                                                        \
+            res->sig = _GX_SHPOOL_SIG;                                                   \
+        }                                                                                \
+        if(fd != -1) {                                                                   \
+            flock(fd, LOCK_UN);                                                          \
+            close(fd); /* mapping stays valid */                                         \
+        }                                                                                \
+        return res;                                                                      \
+    _failed:                                                                             \
+        pthread_mutexattr_destroy(&attr);                                                \
+        _ ## TYPE ## _shpool_undo(res, map_size, fd);                                    \
+        _raise(NULL);                                                                    \
+    }                                                                                    \
+                                                                                         \
+    static inline int destroy_ ## TYPE ## _shpool(TYPE ## _shpool *pool) {               \
+        if(pool != NULL) _ (munmap(pool, pool->map_size)) _raise(-1);                    \
+        return 0;                                                                        \
+    }                                                                                    \
+                                                                                         \
+    static inline int TYPE ## _shpool_reap(TYPE ## _shpool *pool) {                      \
+        int reclaimed;                                                                   \
+        _ (_ ## TYPE ## _shpool_lock(pool)) _raise(-1);                                  \
+        reclaimed = _ ## TYPE ## _shpool_rebuild(pool);                                  \
+        pthread_mutex_unlock(&(pool->mutex));                                            \
+        return reclaimed;                                                                \
+    }                                                                                    \
+                                                                                         \
+    static inline uint64_t TYPE ## _shpool_ref(TYPE ## _shpool *pool, TYPE *obj) {       \
+        return (uint64_t)((char *)obj - (char *)pool);                                   \
+    }                                                                                    \
+                                                                                         \
+    static inline TYPE *TYPE ## _shpool_deref(TYPE ## _shpool *pool, uint64_t off) {     \
+        return (TYPE *)((char *)pool + off);                                             \
+    }                                                                                    \
+                                                                                         \
+    static inline TYPE ## _shslot *_ ## TYPE ## _shslot_of(TYPE *obj) {                  \
+        return (TYPE ## _shslot *)((char *)obj - offsetof(TYPE ## _shslot, obj));        \
+    }                                                                                    \
+                                                                                         \
+    static inline void release_shared_ ## TYPE(TYPE ## _shpool *pool, TYPE *entry);      \
+    static inline TYPE *acquire_shared_ ## TYPE(TYPE ## _shpool *pool) {                 \
+        TYPE ## _shslot *slot = NULL;                                                    \
+        _ (_ ## TYPE ## _shpool_lock(pool)) _raise(NULL);                                \
+        if(rare(!pool->available_head)) {                                                \
+            uint64_t now = _gx_shpool_now_ms();                                          \
+            if(now >= pool->next_reap_ms) {                                              \
+                pool->next_reap_ms = now + GX_SHPOOL_REAP_MS;                            \
+                _ ## TYPE ## _shpool_rebuild(pool);                                      \
+            }                                                                            \
+        }                                                                                \
+        if(freq(pool->available_head)) {                                                 \
+            slot = &(pool->slots[pool->available_head - 1]);                             \
+            pool->available_head = slot->_next;                                          \
+            slot->_next          = 0;                                                    \
+            slot->_owner         = getpid();                                             \
+            pool->in_use ++;                                                             \
+        }                                                                                \
+        pthread_mutex_unlock(&(pool->mutex));                                            \
+        if(rare(!slot)) {errno = ENOMEM; return NULL;}                                   \
+        if(rare(CONSTRUCT(&(slot->obj)) != 0)) {                                         \
+            release_shared_ ## TYPE(pool, &(slot->obj));                                 \
+            return NULL;                                                                 \
+        }                                                                                \
+        return &(slot->obj);                                                             \
+    }                                                                                    \
+                                                                                         \
+    static inline void release_shared_ ## TYPE(TYPE ## _shpool *pool, TYPE *entry) {     \
+        TYPE ## _shslot *slot = _ ## TYPE ## _shslot_of(entry);                          \
+        DESTROY(entry);                                                                  \
+        if(rare(_ ## TYPE ## _shpool_lock(pool) == -1)) return;                          \
+        if(freq(slot->_owner)) {                                                         \
+            slot->_owner         = 0;                                                    \
+            slot->_next          = pool->available_head;                                 \
+            pool->available_head = (uint32_t)(slot - pool->slots) + 1;                   \
+            pool->in_use --;                                                             \
+        }                                                                                \
+        pthread_mutex_unlock(&(pool->mutex));                                            \
+    }
+
 #endif
@@ -1,38 +1,160 @@
 #ifndef _GX_STRING_H
 #define _GX_STRING_H
 /// For doing very fast inline sprintfs. tstr = tmpstring
-#define $BUFSIZE 4096
+///
+/// $() formats into a per-thread arena and returns the string, which stays
+/// valid until $reset()- the logger does that after every record, so $()
+/// strings are good for exactly one log call's arguments. The arena starts
+/// as an inline $BUFSIZE chunk and grows by whole chunks (never moving what
+/// was already handed out) instead of truncating. Grown chunks are kept for
+/// reuse after a reset, so once a thread has seen its largest record it
+/// stops allocating. (They're freed when the thread exits.)
+///
+/// $d/$u/$x/$f/$p are the same for a single integer (decimal / hex), double
+/// or pointer without going through snprintf- most $() calls in logging are
+/// just that. They write in place via gx_fmt.h ($f: shortest digits that
+/// read back to the same double).
+///
+/// $S & co. do the same with a gx_strbuf of your own- zero-initialized
+/// ({.p = NULL}) is ready to use, and $Sfree() gives back its grown chunks.
+#include "./gx_fmt.h"
+
+#define $BUFSIZE   4096
+#define $CHUNKSIZE (4 * $BUFSIZE)
+
+typedef struct gx_strchunk {
+    struct gx_strchunk *next;
+    size_t              size;
+    char                buf[];
+} gx_strchunk;
+
 typedef struct gx_strbuf {
-    char  buf[$BUFSIZE];
-    char *p;
+    char         buf[$BUFSIZE];      ///< First chunk- most records never leave it
+    char        *p;                  ///< Next free byte (NULL until first use)
+    char        *end;                ///< End of the chunk p is in
+    gx_strchunk *cur;                ///< That chunk (NULL while it's buf)
+    gx_strchunk *more;               ///< Grown chunks, kept across resets
 } gx_strbuf;
-static gx_strbuf _gx_tstr_buf = {.buf={0},.p=NULL};
+
+static __thread gx_strbuf _gx_tstr_buf = {.buf={0},.p=NULL}; ///< Per-thread so $() is thread-safe
 static char  _gx_tstr_empty[]   = "";
-#define $(FMT,...) $S(_gx_tstr_buf, FMT, ##__VA_ARGS__)
-#define $reset() $Sreset(_gx_tstr_buf)
-
-#define $S(STRBUF, FMT, ...) (char *)({                                   \
-        if(rare(!(STRBUF).p)) (STRBUF).p = (STRBUF).buf;                  \
-        char *_res = (STRBUF).p;                                          \
-        int   _rem = sizeof((STRBUF).buf) - ((STRBUF).p - (STRBUF).buf);  \
-        if(rare(_rem < 25)) _res = _gx_tstr_empty;                        \
-        else {                                                            \
-            int _len = snprintf((STRBUF).p,                               \
-                sizeof((STRBUF).buf) - ((STRBUF).p - (STRBUF).buf),       \
-                FMT, ##__VA_ARGS__);                                      \
-            if(freq(_len > 0)) (STRBUF).p += _len;                        \
-            if(rare((STRBUF).p > (STRBUF).buf + sizeof((STRBUF).buf)))    \
-                (STRBUF).p = &((STRBUF).buf[sizeof((STRBUF).buf) - 2]);   \
-            (STRBUF).p[0] = (STRBUF).p[1] = '\0';                         \
-            (STRBUF).p += 1;                                              \
-        }                                                                 \
-        _res;                                                             \
-    })
+
+#define $(FMT,...)           $S(_gx_tstr_buf, FMT, ##__VA_ARGS__)
+#define $d(X)                $Sd(_gx_tstr_buf, X)
+#define $u(X)                $Su(_gx_tstr_buf, X)
+#define $x(X)                $Sx(_gx_tstr_buf, X)
+#define $f(X)                $Sf(_gx_tstr_buf, X)
+#define $p(X)                $Sp(_gx_tstr_buf, X)
+#define $reset()             $Sreset(_gx_tstr_buf)
+
+#define $S(STRBUF, FMT, ...) _gx_strbuf_fmt(&(STRBUF), FMT, ##__VA_ARGS__)
+#define $Sd(STRBUF, X)       _gx_strbuf_i64(&(STRBUF), (int64_t)(X))
+#define $Su(STRBUF, X)       _gx_strbuf_u64(&(STRBUF), (uint64_t)(X), 0)
+#define $Sx(STRBUF, X)       _gx_strbuf_u64(&(STRBUF), (uint64_t)(X), 1)
+#define $Sf(STRBUF, X)       _gx_strbuf_f64(&(STRBUF), (double)(X))
+#define $Sp(STRBUF, X)       _gx_strbuf_ptr(&(STRBUF), (const void *)(X))
+
+#define $Sfree(STRBUF)       _gx_tstr_free(&(STRBUF))
 
 #define $Sreset(STRBUF) do {                                              \
     (STRBUF).buf[0] = '\0';                                               \
-    (STRBUF).p = (STRBUF).buf;                                            \
-} while(0);
+    (STRBUF).p   = (STRBUF).buf;                                          \
+    (STRBUF).end = (STRBUF).buf + $BUFSIZE;                               \
+    (STRBUF).cur = NULL;                                                  \
+} while(0)
+
+//-----------------------------------------------------------------------------
+static pthread_key_t  _gx_tstr_key;
+static pthread_once_t _gx_tstr_key_once = PTHREAD_ONCE_INIT;
+
+static void _gx_tstr_free(void *arg) {
+    gx_strbuf   *sb = (gx_strbuf *)arg;
+    gx_strchunk *c, *next;
+    for(c = sb->more; c; c = next) { next = c->next; free(c); }
+    sb->more = sb->cur = NULL;
+    sb->p    = NULL;
+}
+static void _gx_tstr_key_init(void) { pthread_key_create(&_gx_tstr_key, _gx_tstr_free); }
+
+/// Moves p to the next chunk with room for need bytes (allocating it if
+/// there isn't one yet). NULL if out of memory.
+static noinline char *_gx_strbuf_grow(gx_strbuf *sb, size_t need) {
+    gx_strchunk **link = sb->cur ? &sb->cur->next : &sb->more, *c;
+    while((c = *link) && c->size < need) link = &c->next;
+    if(!c) {
+        size_t size = max(need, (size_t)$CHUNKSIZE);
+        if(rare(!(c = (gx_strchunk *)malloc(sizeof(*c) + size)))) return NULL;
+        c->next = NULL;
+        c->size = size;
+        if(sb == &_gx_tstr_buf && !sb->more) {
+            pthread_once(&_gx_tstr_key_once, _gx_tstr_key_init);
+            pthread_setspecific(_gx_tstr_key, sb);
+        }
+        *link = c;
+    }
+    sb->cur = c;
+    sb->p   = c->buf;
+    sb->end = c->buf + c->size;
+    return sb->p;
+}
+
+/// p with room for need bytes- in the current chunk if they fit.
+static inline char *_gx_strbuf_room(gx_strbuf *sb, size_t need) {
+    if(rare(!sb->p)) $Sreset(*sb);
+    if(freq((size_t)(sb->end - sb->p) >= need)) return sb->p;
+    return _gx_strbuf_grow(sb, need);
+}
+
+static optional __attribute__((format(printf, 2, 3)))
+char *_gx_strbuf_fmt(gx_strbuf *sb, const char *fmt, ...) {
+    va_list ap, again;
+    char   *res;
+    int     len;
+    if(rare(!sb->p)) $Sreset(*sb);
+    va_start(ap, fmt);
+    va_copy(again, ap);
+    len = vsnprintf(sb->p, sb->end - sb->p, fmt, ap);
+    va_end(ap);
+    if(freq(len >= 0 && len < sb->end - sb->p)) res = sb->p;
+    else if(rare(len < 0 || !(res = _gx_strbuf_grow(sb, (size_t)len + 1)))) res = NULL;
+    else vsnprintf(res, (size_t)len + 1, fmt, again);
+    va_end(again);
+    if(rare(!res)) return _gx_tstr_empty;
+    sb->p = res + len + 1;
+    return res;
+}
+
+//-----------------------------------------------------------------------------
+/// Terminates the n chars gx_fmt_* wrote at p and moves past them.
+static inline char *_gx_strbuf_done(gx_strbuf *sb, char *p, size_t n) {
+    p[n]  = '\0';
+    sb->p = p + n + 1;
+    return p;
+}
+
+static optional inline char *_gx_strbuf_u64(gx_strbuf *sb, uint64_t v, int hex) {
+    char *p = _gx_strbuf_room(sb, GX_FMT_MAX);
+    if(rare(!p)) return _gx_tstr_empty;
+    return _gx_strbuf_done(sb, p, hex ? gx_fmt_hex(p, v) : gx_fmt_u64(p, v));
+}
+
+static optional inline char *_gx_strbuf_i64(gx_strbuf *sb, int64_t v) {
+    char *p = _gx_strbuf_room(sb, GX_FMT_MAX);
+    if(rare(!p)) return _gx_tstr_empty;
+    return _gx_strbuf_done(sb, p, gx_fmt_i64(p, v));
+}
+
+static optional inline char *_gx_strbuf_f64(gx_strbuf *sb, double v) {
+    char *p = _gx_strbuf_room(sb, GX_FMT_MAX);
+    if(rare(!p)) return _gx_tstr_empty;
+    return _gx_strbuf_done(sb, p, gx_fmt_double(p, v));
+}
+
+static optional inline char *_gx_strbuf_ptr(gx_strbuf *sb, const void *v) {
+    char *p = _gx_strbuf_room(sb, GX_FMT_MAX);
+    if(rare(!p)) return _gx_tstr_empty;
+    return _gx_strbuf_done(sb, p, gx_fmt_ptr(p, v));
+}
 
 
 #endif
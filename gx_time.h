@@ -0,0 +1,239 @@
+/**
+  Fast wall-clock time for timing + log timestamps.
+
+  GOALS (unchanged from the incubator sketch):
+    - SPEED + PRECISION + PARALLELISM especially for TIMING + LOGGING
+    - Minimize syscalls as much as possible, make as parallel as possible
+    - High resolution - nanoseconds
+    - Synced at initialization to walltime UTC
+    - ISO-8601 string output- native, so no strftime/gmtime etc.
+    - Populate the calendar part once and on subsequent calls update it with
+      a much smaller algorithm than the full from-epoch calculation.
+    - Tradeoffs (things it deliberately will _NOT_ try to do well):
+      - While precise, not necessarily accurate (skips leap-seconds etc.)
+      - Real monotonicity- allows NTP adjustments and won't try to be
+        monotonic across cpus/cores. Each re-anchor (see below) can move a
+        thread's clock a few microseconds either way.
+      - Years 0000-9999 only.
+
+  How:
+    - The first call calibrates the TSC against CLOCK_MONOTONIC_RAW for
+      GX_TIME_CALIBRATE_MS, giving ns-per-tick as 32.32 fixed point.
+    - Each thread keeps its own anchor (tsc, CLOCK_REALTIME ns, ns-per-tick)
+      so there's no shared state on the fast path. gx_time_ns() is a full
+      64-bit rdtsc, a subtract, a multiply and a shift.
+    - Every GX_TIME_REANCHOR_MS of ticks the thread re-reads CLOCK_REALTIME
+      (vdso- still no syscall), which picks up NTP slewing, and uses the
+      interval to refine its ns-per-tick.
+    - No usable TSC (other architectures, a TSC that isn't invariant- i.e.
+      changes rate with P/C-states- or calibration came out 0): every call
+      is a plain clock_gettime(CLOCK_REALTIME).
+
+  The same calibration converts raw cpu_ts / cpu_ts_start / cpu_ts_end
+  intervals (see gx.h) to ns with gx_ticks_ns(), and gx_time_mono_ns() is a
+  CLOCK_MONOTONIC substitute (same units, different epoch) that's just an
+  rdtsc when the TSC is invariant.
+
+  ISO-8601 strings are cached per gx_time_isostr: a call in the same second only
+  rewrites the nine fraction digits, a new second rewrites ss (and hh:mm when
+  the minute changed), and the date is only recomputed when the day changes.
+
+  | function / macro          | description                                                  |
+  | ------------------------- | ------------------------------------------------------------ |
+  | gx_time_ns()              | Nanoseconds since the unix epoch (UTC, TSC-interpolated)     |
+  | gx_time_mono_ns()         | Monotonic ns (TSC if invariant, else CLOCK_MONOTONIC)        |
+  | gx_ticks_ns(ticks)        | cpu_ts interval -> ns                                         |
+  | gx_time_tps()             | Calibrated cpu_ts ticks per second                           |
+  | gx_time_tsc_invariant()   | 1 if the cpu says its TSC runs at a constant rate            |
+  | gx_time_iso(c, ns)        | ns -> "YYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ" in c's buffer (cached) |
+  | gx_time_calibrate()       | Calibrate now instead of on first use (blocks ~CALIBRATE_MS) |
+  | GX_TIME_ISO_LEN           | strlen of gx_time_iso() output (30)                          |
+
+  Example:
+
+      static __thread gx_time_isostr stamp;
+      printf("%s\n", gx_time_iso(&stamp, gx_time_ns()));
+
+      uint64_t t0 = cpu_ts_start;
+      work();
+      printf("%" PRIu64 "ns\n", gx_ticks_ns(cpu_ts_end - t0));
+*/
+#ifndef _GX_TIME_H
+#define _GX_TIME_H
+
+#include "./gx.h"
+#include <time.h>
+
+#ifndef GX_TIME_CALIBRATE_MS
+  #define GX_TIME_CALIBRATE_MS 10
+#endif
+#ifndef GX_TIME_REANCHOR_MS
+  #define GX_TIME_REANCHOR_MS  1000      ///< Keep under ~4000 or the tick->ns multiply can overflow
+#endif
+
+#define GX_TIME_ISO_LEN 30               ///< 2012-09-17T09:49:02.123456789Z
+
+#if (__GNUC__ && (__x86_64__ || __amd64__ || __i386__))
+  #include <cpuid.h>
+#endif
+
+typedef struct _gx_time_anchor {
+    uint64_t tsc;                        ///< Tick the anchor was taken at
+    uint64_t ns;                         ///< CLOCK_REALTIME at that tick
+    uint64_t mult;                       ///< ns per tick, 32.32 fixed point
+    uint64_t span;                       ///< Ticks until the next re-anchor (0 = never anchored)
+} _gx_time_anchor;
+
+typedef struct gx_time_isostr {
+    uint64_t sec;                        ///< Unix second the string currently shows
+    uint64_t day;                        ///< Unix second of that day's midnight
+    char     str[GX_TIME_ISO_LEN + 1];
+} gx_time_isostr;
+
+static uint64_t                 _gx_time_mult = 0;   ///< Calibrated ns per tick (32.32). 0 = no TSC
+static int                      _gx_time_tsc_ok = 0; ///< Calibrated and invariant- fit for wall/mono time
+static pthread_once_t           _gx_time_once = PTHREAD_ONCE_INIT;
+static __thread _gx_time_anchor _gx_time_tls;
+
+static inline uint64_t _gx_time_clock_ns(clockid_t clk) {
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static optional int gx_time_tsc_invariant() {
+#if (__GNUC__ && (__x86_64__ || __amd64__ || __i386__))
+    unsigned a, b, c, d;
+    if(!__get_cpuid(0x80000000, &a, &b, &c, &d) || a < 0x80000007) return 0;
+    __get_cpuid(0x80000007, &a, &b, &c, &d);
+    return (d >> 8) & 1;
+#else
+    return 0;
+#endif
+}
+
+#if GX_HAS_TSC
+/// Clock reading bracketed by two tsc reads- the tick is their midpoint.
+static inline uint64_t _gx_time_pair(clockid_t clk, uint64_t *tsc) {
+    uint64_t t0 = cpu_ts, ns = _gx_time_clock_ns(clk), t1 = cpu_ts;
+    *tsc = t0 + (t1 - t0) / 2;
+    return ns;
+}
+
+static void _gx_time_do_calibrate() {
+    uint64_t t0, t1, n0, n1;
+    n0 = _gx_time_pair(CLOCK_MONOTONIC_RAW, &t0);
+    do n1 = _gx_time_pair(CLOCK_MONOTONIC_RAW, &t1);
+    while(n1 - n0 < GX_TIME_CALIBRATE_MS * 1000000ULL);
+    if(freq(t1 > t0)) _gx_time_mult = ((n1 - n0) << 32) / (t1 - t0);
+    _gx_time_tsc_ok = _gx_time_mult && gx_time_tsc_invariant();
+}
+
+static optional void gx_time_calibrate() { pthread_once(&_gx_time_once, _gx_time_do_calibrate); }
+
+static noinline uint64_t _gx_time_reanchor() {
+    _gx_time_anchor *a = &_gx_time_tls;
+    uint64_t         tsc, ns;
+
+    gx_time_calibrate();
+    if(rare(!_gx_time_tsc_ok)) return _gx_time_clock_ns(CLOCK_REALTIME);
+    ns = _gx_time_pair(CLOCK_REALTIME, &tsc);
+    if(freq(a->span) && tsc > a->tsc && tsc - a->tsc < 2 * a->span && ns > a->ns) {
+        // Refine from the (much longer) interval since the last anchor, but
+        // ignore it if the wall clock was stepped in the meantime.
+        uint64_t m = ((ns - a->ns) << 32) / (tsc - a->tsc);
+        if(m > _gx_time_mult - (_gx_time_mult >> 10) && m < _gx_time_mult + (_gx_time_mult >> 10))
+            a->mult = m;
+    } else a->mult = _gx_time_mult;
+    a->tsc  = tsc;
+    a->ns   = ns;
+    a->span = ((uint64_t)GX_TIME_REANCHOR_MS * 1000000ULL << 32) / a->mult;
+    return ns;
+}
+
+/// Split so it can't overflow for any realistic tick count (no __int128 on i386).
+static inline uint64_t _gx_ticks_ns(uint64_t ticks, uint64_t mult) {
+    return (ticks >> 32) * mult + (((ticks & 0xffffffffULL) * mult) >> 32);
+}
+
+static inline uint64_t gx_ticks_ns(uint64_t ticks) {
+    if(rare(!_gx_time_mult)) gx_time_calibrate();
+    return _gx_ticks_ns(ticks, _gx_time_mult);
+}
+
+static inline uint64_t gx_time_mono_ns() {
+    if(rare(!_gx_time_tsc_ok)) {
+        gx_time_calibrate();
+        if(!_gx_time_tsc_ok) return _gx_time_clock_ns(CLOCK_MONOTONIC);
+    }
+    return _gx_ticks_ns(cpu_ts, _gx_time_mult);
+}
+
+static optional uint64_t gx_time_tps() {
+    gx_time_calibrate();
+    return _gx_time_mult ? (1000000000ULL << 32) / _gx_time_mult : 0;
+}
+#else
+static optional void     gx_time_calibrate()           { }
+static inline   uint64_t gx_ticks_ns(uint64_t ticks)   { return ticks; }          // cpu_ts is already ns
+static inline   uint64_t gx_time_mono_ns()             { return _gx_time_clock_ns(CLOCK_MONOTONIC); }
+static optional uint64_t gx_time_tps()                 { return 1000000000ULL; }
+#endif
+
+static inline uint64_t gx_time_ns() {
+#if GX_HAS_TSC
+    _gx_time_anchor *a = &_gx_time_tls;
+    uint64_t         d = cpu_ts - a->tsc;
+    if(rare(d >= a->span)) return _gx_time_reanchor();     // Also: first call, and tsc behind the anchor (migrated)
+    return a->ns + ((d * a->mult) >> 32);
+#else
+    return _gx_time_clock_ns(CLOCK_REALTIME);
+#endif
+}
+
+static inline void _gx_time_2d(char *p, unsigned v) { p[0] = '0' + v / 10; p[1] = '0' + v % 10; }
+
+/// Full date for a new day (civil-from-days, no gmtime).
+static noinline void _gx_time_iso_day(gx_time_isostr *c, uint64_t sec) {
+    uint64_t days = sec / 86400;
+    uint64_t z    = days + 719468;                         // Shifted to 0000-03-01
+    uint64_t era  = z / 146097;
+    unsigned doe  = z - era * 146097;
+    unsigned yoe  = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    unsigned doy  = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    unsigned mp   = (5 * doy + 2) / 153;
+    unsigned d    = doy - (153 * mp + 2) / 5 + 1;
+    unsigned m    = mp < 10 ? mp + 3 : mp - 9;
+    unsigned y    = yoe + era * 400 + (m <= 2);
+
+    _gx_time_2d(c->str,      y / 100 % 100);
+    _gx_time_2d(c->str + 2,  y % 100);
+    c->str[4]  = '-'; _gx_time_2d(c->str + 5, m);
+    c->str[7]  = '-'; _gx_time_2d(c->str + 8, d);
+    c->str[10] = 'T'; c->str[13] = ':'; c->str[16] = ':'; c->str[19] = '.';
+    c->str[29] = 'Z'; c->str[30] = '\0';
+    c->day = days * 86400;
+    c->sec = ~0ULL;                                        // Force hh:mm
+}
+
+static inline char *gx_time_iso(gx_time_isostr *c, uint64_t ns) {
+    uint64_t sec  = ns / 1000000000ULL;
+    unsigned frac = ns % 1000000000ULL;
+    char    *p;
+
+    if(rare(sec != c->sec || !c->str[0])) {
+        unsigned sod;
+        if(sec - c->day >= 86400 || !c->str[0]) _gx_time_iso_day(c, sec);
+        sod = sec - c->day;
+        if(sec / 60 != c->sec / 60) {
+            _gx_time_2d(c->str + 11, sod / 3600);
+            _gx_time_2d(c->str + 14, sod / 60 % 60);
+        }
+        _gx_time_2d(c->str + 17, sod % 60);
+        c->sec = sec;
+    }
+    for(p = c->str + 28; p > c->str + 19; p--) { *p = '0' + frac % 10; frac /= 10; }
+    return c->str;
+}
+
+#endif
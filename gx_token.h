@@ -6,13 +6,15 @@
  * Ideally it should cache everything it can. Possibly even cache the
  * clock-tick and reuse by all threads/processes.
  *
- * @todo  gx_nonce_next_base64 combo function to skip all those intermediates.
- * @todo  fix the node_uid so that it's binary to speed up initialization.
+ * Self-contained: AES-256-GCM is implemented below with AES-NI + PCLMULQDQ
+ * (picked at runtime) and a slow portable fallback.
  *
- *
- * WARNING: This isn't a standalone header yet. At the moment it requires
- * ae.h and something to be compiled against it, which in turn usually needs
- * either native AES cpu instructions or openssl or something.
+ *     gx_token_key k;
+ *     gx_token_key_init(&k, secret32);                 // Once- key schedule, H
+ *     char tok[GX_TOKEN_STRSIZE(sizeof(payload))];
+ *     gx_token_mint(&k, NULL, 1, &payload, sizeof(payload), tok);
+ *     ...
+ *     if(gx_token_open(&k, tok, strlen(tok), &version, &payload) < 0) reject();
  *
  * Basic Composition of the Token
  * ------------------------------
@@ -49,7 +51,7 @@
  *                              8 least-sig.-bytes of host's monotonic-clock-tick)
  * PLAINTEXT             := compress+serialize(PAYLOAD)
  * AAD                   := VERSION [that's all at the moment]
- * CIPHERTEXT, TAG       := aes-[mode](KEY, PLAINTEXT, NONCE, AAD)
+ * CIPHERTEXT, TAG       := aes-256-gcm(KEY, PLAINTEXT, NONCE, AAD)
  *
  * RAW_TOKEN             := cat(VERSION, compress(NONCE), CIPHERTEXT, TAG)
  * TOKEN                 := base64-url-encode(RAW_TOKEN)
@@ -146,23 +148,34 @@
 
 #include "./gx.h"
 #include "./gx_net.h"
-//#include "ae.h"
+#include "./gx_hash.h"
+#include "./gx_base64.h"
 
 //-----------------------------------------------------------------------------
-/// Will have to fetch more random data after this many nonces have been generated.
-#define _GX_RPSIZE 256
+/// Counter gaps come from a per-machine xorshift64* that is reseeded from
+/// gx_dev_random after this many nonces- i.e., no syscalls on the nonce path.
+/// (The gaps are public anyway- they only have to be unpredictable enough to
+/// keep colliding machines leapfrogging, see above.)
+#ifndef GX_NONCE_RESEED
+  #define GX_NONCE_RESEED 65536
+#endif
+#ifndef GX_RANDOM_POOL
+  #define GX_RANDOM_POOL 256        ///< Per-thread gx_dev_random buffer (bytes)
+#endif
+#ifndef GX_RANDOM_MIX_RDRAND
+  #define GX_RANDOM_MIX_RDRAND 0    ///< 1: also xor RDRAND/RDSEED into gx_dev_random output
+#endif
 
 
 //-----------------------------------------------------------------------------
 /// Helpers for getting structure sizes
-#define GX_BASE64_SIZE(DATSIZE) (4 * (DATSIZE) / 3 + 1)
 #define GX_NONCE_BINSIZE 12
 #define GX_NONCE_STRSIZE GX_BASE64_SIZE(GX_NONCE_BINSIZE)
 
 //-----------------------------------------------------------------------------
 typedef struct _gx_nm_identcomps {
     uint32_t          rand1;                    ///< Entropic random data as part of the signature
-    char              node_uid[GX_NODE_UID_LEN];///< Unique per network config (ip-addrs + hdwr-addrs)
+    uint8_t           node_uid[GX_NODE_UID_BINSIZE]; ///< Unique per network config (ip-addrs + hdwr-addrs)
     uint64_t          ts1;                      ///< CPU timestamp when first allocated
     int               tid;                      ///< Result of gettid - like pid but unique when threaded
 
@@ -187,9 +200,15 @@ typedef union __attribute__((__packed__)) _gx_nonce {
 
 typedef struct gx_nonce_machine {
     _gx_nm_identcomps     ident;                ///< Help us to be pretty darn unique
-    volatile _gx_nonce    nonce;                ///< Actual current value
-    uint8_t               rand_pool[_GX_RPSIZE];///< Used for increment values
-    int                   rand_pool_pos;        ///< Points to current randpool pos
+    // 16-byte aligned so the atomically incremented counter (bytes 4-11)
+    // never straddles a cache line- a split lock is hundreds of times
+    // slower, and kernels with split-lock detection throttle the thread.
+    volatile _gx_nonce    nonce __attribute__((aligned(16)));  ///< Actual current value
+    uint64_t              rnd;                  ///< xorshift64* state for the counter gaps
+    uint64_t              rnd_bits;             ///< Unused gap bytes from the last draw
+    int                   rnd_left;             ///< How many bytes are left in rnd_bits
+    int                   reseed_in;            ///< Draws (of 8 gaps) until rnd is reseeded
+    unsigned              fork_gen;             ///< _gx_nonce_fork_gen when ident was last taken
 } gx_nonce_machine;
 
 
@@ -199,67 +218,116 @@ static int _gx_misc_primes[] optional = {11, 13, 17, 19, 23, 29, 31, 37, 41,
     199, 211, 223, 227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281,
     283, 293, 307, 311, 313, 317, 331, 313};
 
+//-----------------------------------------------------------------------------
+/// Fork detection. Instead of a gettid syscall per nonce, a pthread_atfork
+/// child handler bumps a generation counter (shared by all translation units
+/// via the common section) and each machine re-identifies itself when it
+/// sees a generation it hasn't. Children made with a raw clone()/syscall
+/// (no CLONE_VM) don't run atfork handlers- call gx_nonce_forked() first
+/// thing in them. (gx_clone children share memory, and so the machine's
+/// atomic counter, with the parent- nothing to do there.)
+asm ("\n .comm _gx_nonce_fork_gen," _STR(__SIZEOF_INT__) ",4 \n");
+extern volatile unsigned _gx_nonce_fork_gen;
+static pthread_once_t    _gx_nonce_atfork_once = PTHREAD_ONCE_INIT;
+
+static void gx_nonce_forked()               { __sync_add_and_fetch(&_gx_nonce_fork_gen, 1); }
+static void _gx_nonce_atfork()              { pthread_atfork(NULL, NULL, gx_nonce_forked); }
+
+//-----------------------------------------------------------------------------
+/// Per-thread machine, initialized on first use- the cheapest way to mint
+/// nonces from many threads. (Still uses the atomic counter, because a
+/// gx_clone child runs on its parent's thread-local storage.)
+static __thread gx_nonce_machine _gx_nonce_tls;
+static __thread int              _gx_nonce_tls_ok;
+
 //-----------------------------------------------------------------------------
 /// Forward Declarations
 static optional           int     gx_nonce_init(gx_nonce_machine *nm, int hardened);
 static optional inline int        gx_nonce_next(gx_nonce_machine *nm, char *buf);
+static optional inline int        gx_nonce_next_n(gx_nonce_machine *nm, char *buf, size_t n);
+static optional inline gx_nonce_machine *gx_nonce_local();
+static optional inline int        gx_nonce_next_base64(gx_nonce_machine *nm, char *buf);
 
 static optional           int     gx_dev_random(void *dest, size_t len, int is_strict);
-static optional inline uint64_t   gx_hash64(const char *key, uint64_t len, uint64_t seed);
 
 
 //-----------------------------------------------------------------------------
-static optional int gx_nonce_init(gx_nonce_machine *nm, int hardened) {
-    memset(nm, 0, sizeof(*nm));
-    _ (gx_node_uid  (nm->ident.node_uid)                                    ) _raise(-1);
-    _ (gx_dev_random(&(nm->ident.rand1), sizeof(nm->ident.rand1), hardened) ) _raise(-1);
-    _ (gx_dev_random(nm->rand_pool,      sizeof(nm->rand_pool),   0)        ) _raise(-1);
-    // The following are direct syscalls so that glibc etc. doesn't cache the values.
+/// (Re)takes everything that is unique to this process/thread- on init and
+/// in a child after a fork. Direct syscalls so that glibc etc. doesn't cache
+/// the values.
+static int _gx_nonce_ident(gx_nonce_machine *nm) {
+    nm->fork_gen = _gx_nonce_fork_gen;
   #ifdef __LINUX__
     _ (nm->ident.tid     = syscall(SYS_gettid)) _raise(-1);
   #else
     _ (nm->ident.tid     = syscall(SYS_thread_selfid)) _raise(-1);
   #endif
     nm->ident.ts1        = cpu_ts;
-    nm->nonce.rand2[0]   = nm->rand_pool[0];
-    nm->nonce.rand2[1]   = nm->rand_pool[1];
-    nm->nonce.rand2[2]   = nm->rand_pool[2];
-    nm->nonce.rand2[3]   = nm->rand_pool[3];
-    nm->nonce.ident_hash = gx_hash64((void *)&(nm->ident), sizeof(nm->ident), (uint64_t)nm->rand_pool[4]);
-    nm->rand_pool_pos    = 5;
+    _ (gx_dev_random(&nm->rnd, sizeof(nm->rnd), 0)) _raise(-1);
+    nm->rnd             |= 1;                   // xorshift state must not be 0
+    nm->rnd_left         = 0;
+    nm->reseed_in        = GX_NONCE_RESEED / 8;   // Counted in 8-gap draws
+    nm->nonce.ident_hash = gx_hash64((void *)&(nm->ident), sizeof(nm->ident), nm->rnd);
+    return 0;
+}
+
+static optional int gx_nonce_init(gx_nonce_machine *nm, int hardened) {
+    uint8_t rand2[4];
+    memset(nm, 0, sizeof(*nm));
+    pthread_once(&_gx_nonce_atfork_once, _gx_nonce_atfork);
+    _ (gx_node_uid_bin(nm->ident.node_uid)                                  ) _raise(-1);
+    _ (gx_dev_random(&(nm->ident.rand1), sizeof(nm->ident.rand1), hardened) ) _raise(-1);
+    _ (gx_dev_random(rand2,              sizeof(rand2),           0)        ) _raise(-1);
+    memcpy((void *)nm->nonce.rand2, rand2, sizeof(rand2));
+    _ (_gx_nonce_ident(nm)                                                  ) _raise(-1);
     return 0;
 }
 
+static optional inline gx_nonce_machine *gx_nonce_local() {
+    if(rare(!_gx_nonce_tls_ok)) {
+        _ (gx_nonce_init(&_gx_nonce_tls, 0)) _raise(NULL);
+        _gx_nonce_tls_ok = 1;
+    }
+    return &_gx_nonce_tls;
+}
+
+
+//-----------------------------------------------------------------------------
+/// Next counter gap: one byte of xorshift64* output picks a prime and a
+/// multiplier (1-4) for it. Not atomic- threads sharing a machine can at
+/// worst get the same gap, never the same counter value. Two of them taking
+/// the last byte at once leave rnd_left (or reseed_in) below zero, so both
+/// are tested with <= 0 rather than for exactly zero.
+static inline int _gx_nonce_gap(gx_nonce_machine *nm, unsigned *incby) {
+    if(rare(nm->rnd_left <= 0)) {
+        if(rare(--nm->reseed_in <= 0)) {
+            _ (gx_dev_random(&nm->rnd, sizeof(nm->rnd), 0)) _raise(-1);
+            nm->rnd      |= 1;
+            nm->reseed_in = GX_NONCE_RESEED / 8;
+        }
+        nm->rnd     ^= nm->rnd >> 12;
+        nm->rnd     ^= nm->rnd << 25;
+        nm->rnd     ^= nm->rnd >> 27;
+        nm->rnd_bits = nm->rnd * 0x2545f4914f6cdd1dULL;
+        nm->rnd_left = 8;
+    }
+    uint8_t r     = nm->rnd_bits;
+    nm->rnd_bits >>= 8;
+    nm->rnd_left--;
+    *incby = _gx_misc_primes[r & 0x3f] * (((r & 0xc0) >> 6) + 1);
+    return 0;
+}
 
 //-----------------------------------------------------------------------------
 /// Defaulting to 12 byte nonces at the moment.
 static optional inline int gx_nonce_next(gx_nonce_machine *nm, char *buf) {
     _gx_nonce res;
+    unsigned  incby = 0;
 
-    // Double checking for tid changes doesn't seem to add much overhead at
-    // all, so keeping it here for now to avoid collisions when the same
-    // gx_nonce_machine instance is initialized _before_ forking /
-    // thread-spawning. Feel free to remove this part for a small speed boost
-    // if you're absolutely certain that the nonce-machine is initialized
-    // _after_ any forking/cloning/spawning.
-    int new_tid;
-  #ifdef __LINUX__
-    _ (new_tid = syscall(SYS_gettid)) _raise(-1);
-  #else
-    _ (new_tid = syscall(SYS_thread_selfid)) _raise(-1);
-  #endif
-    if(rare(new_tid != nm->ident.tid)) {
-        nm->ident.tid = new_tid;
-        nm->nonce.ident_hash = gx_hash64((void *)&(nm->ident), sizeof(nm->ident), (uint64_t)nm->rand_pool[4]);
-    }
-
-    if(rare(nm->rand_pool_pos >= _GX_RPSIZE)) {
-        _ (gx_dev_random(nm->rand_pool, sizeof(nm->rand_pool), 0)) _raise(-1);
-        nm->rand_pool_pos = 0;
-    }
-
-    uint8_t      rnd   = nm->rand_pool[nm->rand_pool_pos++];
-    unsigned int incby = _gx_misc_primes[rnd & 0x3f] * (((rnd & 0xc0) >> 6) + 1);
+    // Protects a machine that was initialized _before_ a fork. (Threads
+    // sharing a machine are already kept apart by the atomic counter.)
+    if(rare(nm->fork_gen != _gx_nonce_fork_gen)) _ (_gx_nonce_ident(nm)) _raise(-1);
+    _ (_gx_nonce_gap(nm, &incby)) _raise(-1);
 
     res.top_part = nm->nonce.top_part;
     res.counter  = __sync_add_and_fetch(&nm->nonce.counter, incby);
@@ -268,141 +336,587 @@ static optional inline int gx_nonce_next(gx_nonce_machine *nm, char *buf) {
     return 0;
 }
 
+//-----------------------------------------------------------------------------
+/// n nonces into buf (n * GX_NONCE_BINSIZE bytes) for one atomic add per 64:
+/// the gaps are drawn first and their sum reserved as one block of counter
+/// space, so the nonces are exactly what n gx_nonce_next calls would have
+/// produced without anyone else interleaving.
+static optional inline int gx_nonce_next_n(gx_nonce_machine *nm, char *buf, size_t n) {
+    _gx_nonce res;
+    unsigned  incs[64];
+    uint64_t  total;
+    size_t    i, cnt;
+
+    if(rare(nm->fork_gen != _gx_nonce_fork_gen)) _ (_gx_nonce_ident(nm)) _raise(-1);
+    res.top_part = nm->nonce.top_part;
+    for(; n; n -= cnt) {
+        cnt = n < 64 ? n : 64;
+        for(i = 0, total = 0; i < cnt; i++) {
+            _ (_gx_nonce_gap(nm, &incs[i])) _raise(-1);
+            total += incs[i];
+        }
+        res.counter = __sync_fetch_and_add(&nm->nonce.counter, total);
+        for(i = 0; i < cnt; i++, buf += GX_NONCE_BINSIZE) {
+            res.counter += incs[i];
+            memcpy(buf, (char *)res.as_bytes, sizeof(res.as_bytes));
+        }
+    }
+    return 0;
+}
+
 
 
 //-----------------------------------------------------------------------------
-/// This will give high quality non-deterministic random data.
-/// BUT it may block a bit on Linux, so use it only where needed or set
-/// is_strict to false.
-static int _gx_devrandom_fd  = -1;
-static int _gx_devurandom_fd = -1;
-static optional int gx_dev_random(void *dest, size_t len, int is_strict) {
-    int     tries = 0;
-    ssize_t rcv_count;
-    if(rare(len == 0 || dest == NULL)) {
-        errno = EINVAL;
-        return -1;
+/// Next nonce straight to its GX_NONCE_STRSIZE base64 form (16 chars + '\0').
+static optional inline int gx_nonce_next_base64(gx_nonce_machine *nm, char *buf) {
+    char bin[GX_NONCE_BINSIZE];
+    _ (gx_nonce_next(nm, bin)) _raise(-1);
+    gx_base64_urlencode_m3(bin, GX_NONCE_BINSIZE, buf);
+    return 0;
+}
+
+
+
+//-----------------------------------------------------------------------------
+/// AES-256-GCM
+///
+/// AES-NI + PCLMULQDQ when the cpu has them (checked once per key), else a
+/// portable byte-oriented AES and bitwise GHASH. The portable path is slow
+/// and its s-box lookups aren't constant-time- it's there so tokens still
+/// work everywhere, not for hosts that mint at volume.
+///
+/// The key schedule, the GHASH key H and its byte-reversed form are all
+/// computed once by gx_token_key_init().
+typedef struct gx_token_key {
+    uint8_t               rk[15][16];           ///< AES-256 round keys
+    uint8_t               h[16];                ///< GHASH key E(K, 0^128)
+    uint8_t               h_rev[16];            ///< ...byte-reversed, as pclmul wants it
+    int                   hw;                   ///< 1 = AES-NI + PCLMULQDQ
+} __attribute__((aligned(16))) gx_token_key;
+
+static const uint8_t _gx_aes_sbox[256] optional = {
+    0x63,0x7c,0x77,0x7b,0xf2,0x6b,0x6f,0xc5,0x30,0x01,0x67,0x2b,0xfe,0xd7,0xab,0x76,
+    0xca,0x82,0xc9,0x7d,0xfa,0x59,0x47,0xf0,0xad,0xd4,0xa2,0xaf,0x9c,0xa4,0x72,0xc0,
+    0xb7,0xfd,0x93,0x26,0x36,0x3f,0xf7,0xcc,0x34,0xa5,0xe5,0xf1,0x71,0xd8,0x31,0x15,
+    0x04,0xc7,0x23,0xc3,0x18,0x96,0x05,0x9a,0x07,0x12,0x80,0xe2,0xeb,0x27,0xb2,0x75,
+    0x09,0x83,0x2c,0x1a,0x1b,0x6e,0x5a,0xa0,0x52,0x3b,0xd6,0xb3,0x29,0xe3,0x2f,0x84,
+    0x53,0xd1,0x00,0xed,0x20,0xfc,0xb1,0x5b,0x6a,0xcb,0xbe,0x39,0x4a,0x4c,0x58,0xcf,
+    0xd0,0xef,0xaa,0xfb,0x43,0x4d,0x33,0x85,0x45,0xf9,0x02,0x7f,0x50,0x3c,0x9f,0xa8,
+    0x51,0xa3,0x40,0x8f,0x92,0x9d,0x38,0xf5,0xbc,0xb6,0xda,0x21,0x10,0xff,0xf3,0xd2,
+    0xcd,0x0c,0x13,0xec,0x5f,0x97,0x44,0x17,0xc4,0xa7,0x7e,0x3d,0x64,0x5d,0x19,0x73,
+    0x60,0x81,0x4f,0xdc,0x22,0x2a,0x90,0x88,0x46,0xee,0xb8,0x14,0xde,0x5e,0x0b,0xdb,
+    0xe0,0x32,0x3a,0x0a,0x49,0x06,0x24,0x5c,0xc2,0xd3,0xac,0x62,0x91,0x95,0xe4,0x79,
+    0xe7,0xc8,0x37,0x6d,0x8d,0xd5,0x4e,0xa9,0x6c,0x56,0xf4,0xea,0x65,0x7a,0xae,0x08,
+    0xba,0x78,0x25,0x2e,0x1c,0xa6,0xb4,0xc6,0xe8,0xdd,0x74,0x1f,0x4b,0xbd,0x8b,0x8a,
+    0x70,0x3e,0xb5,0x66,0x48,0x03,0xf6,0x0e,0x61,0x35,0x57,0xb9,0x86,0xc1,0x1d,0x9e,
+    0xe1,0xf8,0x98,0x11,0x69,0xd9,0x8e,0x94,0x9b,0x1e,0x87,0xe9,0xce,0x55,0x28,0xdf,
+    0x8c,0xa1,0x89,0x0d,0xbf,0xe6,0x42,0x68,0x41,0x99,0x2d,0x0f,0xb0,0x54,0xbb,0x16};
+
+static inline uint8_t _gx_aes_xtime(uint8_t x) { return (x << 1) ^ ((x >> 7) * 0x1b); }
+
+static void _gx_aes_encrypt_sw(const gx_token_key *k, const uint8_t in[16], uint8_t out[16]) {
+    uint8_t s[16], t[16];
+    int     r, c, i;
+    for(i = 0; i < 16; i++) s[i] = in[i] ^ k->rk[0][i];
+    for(r = 1; r < 15; r++) {
+        for(i = 0; i < 16; i++) t[i] = _gx_aes_sbox[s[(i + 4 * (i % 4)) % 16]];   // SubBytes + ShiftRows
+        if(r < 14) for(c = 0; c < 16; c += 4) {                                 // MixColumns
+            uint8_t a0 = t[c], a1 = t[c + 1], a2 = t[c + 2], a3 = t[c + 3], x = a0 ^ a1 ^ a2 ^ a3;
+            t[c]     ^= x ^ _gx_aes_xtime(a0 ^ a1);
+            t[c + 1] ^= x ^ _gx_aes_xtime(a1 ^ a2);
+            t[c + 2] ^= x ^ _gx_aes_xtime(a2 ^ a3);
+            t[c + 3] ^= x ^ _gx_aes_xtime(a3 ^ a0);
+        }
+        for(i = 0; i < 16; i++) s[i] = t[i] ^ k->rk[r][i];
     }
-init:
-    if(rare(_gx_devrandom_fd == -1))
-        switch_esys( _gx_devrandom_fd = open("/dev/random", O_RDONLY | O_NONBLOCK)) {
-            case EINTR: goto init;
-            default:    _raise(-1);
+    memcpy(out, s, 16);
+}
+
+/// GHASH multiply, straight from the spec (bit-reflected, R = 0xe1 || 0^120).
+static void _gx_ghash_mul_sw(uint8_t x[16], const uint8_t h[16]) {
+    uint64_t zh = 0, zl = 0, vh = 0, vl = 0, xh = 0, xl = 0, m;
+    int      i;
+    for(i = 0; i < 8; i++) {
+        vh = vh << 8 | h[i]; vl = vl << 8 | h[i + 8];
+        xh = xh << 8 | x[i]; xl = xl << 8 | x[i + 8];
+    }
+    for(i = 0; i < 128; i++) {
+        m   = -((i < 64 ? xh >> (63 - i) : xl >> (127 - i)) & 1);
+        zh ^= vh & m; zl ^= vl & m;
+        m   = -(vl & 1);
+        vl  = (vl >> 1) | (vh << 63);
+        vh  = (vh >> 1) ^ (0xe100000000000000ULL & m);
+    }
+    for(i = 0; i < 8; i++) { x[7 - i] = zh >> (8 * i); x[15 - i] = zl >> (8 * i); }
+}
+
+static inline void _gx_ghash_sw(const gx_token_key *k, uint8_t x[16], const uint8_t *in, size_t len) {
+    size_t i;
+    for(; len; in += i, len -= i) {
+        for(i = 0; i < 16 && i < len; i++) x[i] ^= in[i];
+        _gx_ghash_mul_sw(x, k->h);
+    }
+}
+
+static inline void _gx_gcm_lenblock(uint8_t b[16], size_t alen, size_t clen) {
+    uint64_t a = bswap64((uint64_t)alen * 8), c = bswap64((uint64_t)clen * 8);
+    memcpy(b, &a, 8);
+    memcpy(b + 8, &c, 8);
+}
+
+/// in -> out (may be the same buffer), tag over aad + the ciphertext. dir: 1
+/// seals (ciphertext is out), 0 opens (ciphertext is in).
+static void _gx_gcm_sw(const gx_token_key *k, const uint8_t iv[12], const uint8_t *aad, size_t alen,
+                       const uint8_t *in, size_t len, uint8_t *out, uint8_t tag[16], int dir) {
+    uint8_t  ctr[16], ks[16], x[16] = {0}, lb[16];
+    uint32_t c = 1, be;
+    size_t   i, n;
+    if(!dir) _gx_ghash_sw(k, x, aad, alen), _gx_ghash_sw(k, x, in, len);
+    else     _gx_ghash_sw(k, x, aad, alen);
+    memcpy(ctr, iv, 12);
+    be = bswap32(c);
+    memcpy(ctr + 12, &be, 4);
+    _gx_aes_encrypt_sw(k, ctr, tag);                          // E(K, J0)
+    for(i = 0; i < len; i += n) {
+        be = bswap32(++c);
+        memcpy(ctr + 12, &be, 4);
+        _gx_aes_encrypt_sw(k, ctr, ks);
+        for(n = 0; n < 16 && i + n < len; n++) out[i + n] = in[i + n] ^ ks[n];
+    }
+    if(dir) _gx_ghash_sw(k, x, out, len);
+    _gx_gcm_lenblock(lb, alen, len);
+    _gx_ghash_sw(k, x, lb, 16);
+    for(i = 0; i < 16; i++) tag[i] ^= x[i];
+}
+
+#if (__GNUC__ && (__x86_64__ || __amd64__ || __i386__))
+#include <immintrin.h>
+#define _GX_AESNI __attribute__((target("aes,pclmul,ssse3")))
+
+#define _GX_BSWAP128 _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)
+
+/// GF(2^128) multiply of byte-reversed operands (Intel's carry-less
+/// multiplication whitepaper, algorithm 5: shift-left-by-one + reduction).
+static _GX_AESNI inline __m128i _gx_gf_mul(__m128i a, __m128i b) {
+    __m128i t2, t3, t4, t5, t6, t7, t8, t9;
+    t3 = _mm_clmulepi64_si128(a, b, 0x00);
+    t4 = _mm_clmulepi64_si128(a, b, 0x10);
+    t5 = _mm_clmulepi64_si128(a, b, 0x01);
+    t6 = _mm_clmulepi64_si128(a, b, 0x11);
+    t4 = _mm_xor_si128(t4, t5);
+    t5 = _mm_slli_si128(t4, 8);
+    t4 = _mm_srli_si128(t4, 8);
+    t3 = _mm_xor_si128(t3, t5);
+    t6 = _mm_xor_si128(t6, t4);
+    t7 = _mm_srli_epi32(t3, 31);
+    t8 = _mm_srli_epi32(t6, 31);
+    t3 = _mm_slli_epi32(t3, 1);
+    t6 = _mm_slli_epi32(t6, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    t3 = _mm_or_si128(t3, t7);
+    t6 = _mm_or_si128(t6, t8);
+    t6 = _mm_or_si128(t6, t9);
+    t7 = _mm_slli_epi32(t3, 31);
+    t8 = _mm_slli_epi32(t3, 30);
+    t9 = _mm_slli_epi32(t3, 25);
+    t7 = _mm_xor_si128(t7, t8);
+    t7 = _mm_xor_si128(t7, t9);
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    t3 = _mm_xor_si128(t3, t7);
+    t2 = _mm_srli_epi32(t3, 1);
+    t4 = _mm_srli_epi32(t3, 2);
+    t5 = _mm_srli_epi32(t3, 7);
+    t2 = _mm_xor_si128(t2, t4);
+    t2 = _mm_xor_si128(t2, t5);
+    t2 = _mm_xor_si128(t2, t8);
+    t3 = _mm_xor_si128(t3, t2);
+    return _mm_xor_si128(t6, t3);
+}
+
+/// Partial final blocks are zero-padded- both for GHASH and for CTR, so
+/// neither ever reads or writes past the caller's buffers.
+static _GX_AESNI inline __m128i _gx_load_partial(const uint8_t *p, size_t n) {
+    uint8_t b[16] __attribute__((aligned(16))) = {0};
+    if(freq(n >= 16)) return _mm_loadu_si128((const __m128i *)p);
+    memcpy(b, p, n);
+    return _mm_load_si128((const __m128i *)b);
+}
+
+static _GX_AESNI inline __m128i _gx_ghash_hw(__m128i x, __m128i h, const uint8_t *in, size_t len) {
+    const __m128i bs = _GX_BSWAP128;
+    size_t        n;
+    for(; len; in += n, len -= n) {
+        n = len < 16 ? len : 16;
+        x = _gx_gf_mul(_mm_xor_si128(x, _mm_shuffle_epi8(_gx_load_partial(in, n), bs)), h);
+    }
+    return x;
+}
+
+/// Up to 4 independent blocks through all 14 rounds, interleaved so the
+/// aesenc latency is hidden.
+static _GX_AESNI inline void _gx_aes_enc4_hw(const gx_token_key *k, __m128i *b, int cnt) {
+    __m128i rk = _mm_load_si128((const __m128i *)k->rk[0]);
+    int     r, i;
+    for(i = 0; i < cnt; i++) b[i] = _mm_xor_si128(b[i], rk);
+    for(r = 1; r < 14; r++) {
+        rk = _mm_load_si128((const __m128i *)k->rk[r]);
+        for(i = 0; i < cnt; i++) b[i] = _mm_aesenc_si128(b[i], rk);
+    }
+    rk = _mm_load_si128((const __m128i *)k->rk[14]);
+    for(i = 0; i < cnt; i++) b[i] = _mm_aesenclast_si128(b[i], rk);
+}
+
+static _GX_AESNI inline __m128i _gx_ctr_block(uint8_t j0[16], uint32_t c) {
+    uint32_t be = bswap32(c);
+    memcpy(j0 + 12, &be, 4);
+    return _mm_load_si128((const __m128i *)j0);
+}
+
+static _GX_AESNI inline size_t _gx_ctr_xor_hw(const __m128i *b, int cnt, const uint8_t *in, uint8_t *out, size_t i, size_t len) {
+    __m128i t;
+    size_t  n;
+    int     j;
+    for(j = 0; j < cnt; j++, i += n) {
+        n = len - i < 16 ? len - i : 16;
+        t = _mm_xor_si128(_gx_load_partial(in + i, n), b[j]);
+        if(freq(n == 16)) _mm_storeu_si128((__m128i *)(out + i), t);
+        else { uint8_t tb[16]; _mm_storeu_si128((__m128i *)tb, t); memcpy(out + i, tb, n); }
+    }
+    return i;
+}
+
+static _GX_AESNI void _gx_gcm_hw(const gx_token_key *k, const uint8_t iv[12], const uint8_t *aad, size_t alen,
+                                 const uint8_t *in, size_t len, uint8_t *out, uint8_t tag[16], int dir) {
+    const __m128i bs = _GX_BSWAP128, h = _mm_load_si128((const __m128i *)k->h_rev);
+    uint8_t       j0[16] __attribute__((aligned(16)));
+    __m128i       x = _mm_setzero_si128(), b[4], t;
+    size_t        i, left = (len + 15) / 16;
+    uint32_t      c = 1;
+    int           cnt;
+
+    x = _gx_ghash_hw(x, h, aad, alen);
+    if(!dir) x = _gx_ghash_hw(x, h, in, len);
+    // The tag mask E(K, J0) rides along with the first three counter blocks
+    memcpy(j0, iv, 12);
+    b[0] = _gx_ctr_block(j0, c);
+    for(cnt = 1; cnt < 4 && left; left--) b[cnt++] = _gx_ctr_block(j0, ++c);
+    _gx_aes_enc4_hw(k, b, cnt);
+    _mm_storeu_si128((__m128i *)tag, b[0]);
+    i = _gx_ctr_xor_hw(b + 1, cnt - 1, in, out, 0, len);
+    while(left) {
+        for(cnt = 0; cnt < 4 && left; left--) b[cnt++] = _gx_ctr_block(j0, ++c);
+        _gx_aes_enc4_hw(k, b, cnt);
+        i = _gx_ctr_xor_hw(b, cnt, in, out, i, len);
+    }
+    if(dir) x = _gx_ghash_hw(x, h, out, len);
+    _gx_gcm_lenblock(j0, alen, len);
+    x = _gx_gf_mul(_mm_xor_si128(x, _mm_shuffle_epi8(_mm_load_si128((const __m128i *)j0), bs)), h);
+    t = _mm_xor_si128(_mm_loadu_si128((const __m128i *)tag), _mm_shuffle_epi8(x, bs));
+    _mm_storeu_si128((__m128i *)tag, t);
+}
+/// Opens up to 4 tokens in lockstep: their GHASH chains are independent, and
+/// block j of every token goes through the same _gx_aes_enc4_hw() call.
+/// raw[l] is VERSION | NONCE | CIPHERTEXT (decrypted in place), tags go to tag[l].
+static _GX_AESNI void _gx_gcm_open4_hw(const gx_token_key *k, uint8_t *raw[4], const size_t len[4], uint8_t tag[4][16], int lanes) {
+    const __m128i bs = _GX_BSWAP128, h = _mm_load_si128((const __m128i *)k->h_rev);
+    uint8_t       j0[4][16] __attribute__((aligned(16))), lb[16] __attribute__((aligned(16)));
+    __m128i       x[4], b[4];
+    size_t        blk, nblk = 0, off;
+    int           l, cnt, lane[4];
+
+    for(l = 0; l < lanes; l++) {
+        x[l] = _gx_gf_mul(_mm_shuffle_epi8(_gx_load_partial(raw[l], 1), bs), h);
+        memcpy(j0[l], raw[l] + 1, 12);
+        if((len[l] + 15) / 16 > nblk) nblk = (len[l] + 15) / 16;
+    }
+    for(blk = 0, off = 0; blk < nblk; blk++, off += 16)
+        for(l = 0; l < lanes; l++) if(off < len[l]) {
+            size_t n = len[l] - off < 16 ? len[l] - off : 16;
+            x[l] = _gx_gf_mul(_mm_xor_si128(x[l], _mm_shuffle_epi8(_gx_load_partial(raw[l] + 13 + off, n), bs)), h);
         }
-    if(rare(!is_strict && (_gx_devurandom_fd == -1)))
-        switch_esys( _gx_devurandom_fd = open("/dev/urandom", O_RDONLY)) {
-            case EINTR: goto init;
-            default:    _raise(-1);
+    for(l = 0; l < lanes; l++) {
+        _gx_gcm_lenblock(lb, 1, len[l]);
+        x[l] = _gx_gf_mul(_mm_xor_si128(x[l], _mm_shuffle_epi8(_mm_load_si128((const __m128i *)lb), bs)), h);
+        b[l] = _gx_ctr_block(j0[l], 1);
+    }
+    _gx_aes_enc4_hw(k, b, lanes);
+    for(l = 0; l < lanes; l++) _mm_storeu_si128((__m128i *)tag[l], _mm_xor_si128(b[l], _mm_shuffle_epi8(x[l], bs)));
+    for(blk = 0, off = 0; blk < nblk; blk++, off += 16) {
+        for(l = 0, cnt = 0; l < lanes; l++)
+            if(off < len[l]) { lane[cnt] = l; b[cnt++] = _gx_ctr_block(j0[l], blk + 2); }
+        _gx_aes_enc4_hw(k, b, cnt);
+        for(l = 0; l < cnt; l++) _gx_ctr_xor_hw(b + l, 1, raw[lane[l]] + 13, raw[lane[l]] + 13, off, len[lane[l]]);
+    }
+}
+#define _GX_AESNI_OK() (__builtin_cpu_supports("aes") && __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3"))
+#else
+#define _GX_AESNI_OK() 0
+#define _gx_gcm_hw     _gx_gcm_sw
+#define _gx_gcm_open4_hw(K, RAW, LEN, TAG, LANES) do { } while(0)
+#endif
+
+
+//-----------------------------------------------------------------------------
+/// Tokens (see the composition at the top):
+///     RAW_TOKEN := VERSION | NONCE | CIPHERTEXT | TAG,  AAD := VERSION
+///     TOKEN     := base64-url-encode(RAW_TOKEN)   (_gx_t64 alphabet, no padding)
+/// The nonce isn't compressed- it's already 12 bytes of mostly entropy.
+#define GX_TOKEN_KEYSIZE        32
+#define GX_TOKEN_TAGSIZE        16
+#define GX_TOKEN_OVERHEAD       (1 + GX_NONCE_BINSIZE + GX_TOKEN_TAGSIZE)
+#define GX_TOKEN_RAWSIZE(PLEN)  (GX_TOKEN_OVERHEAD + (PLEN))
+#define GX_TOKEN_STRSIZE(PLEN)  GX_BASE64_SIZE(GX_TOKEN_RAWSIZE(PLEN))    ///< Including the '\0'
+#ifndef GX_TOKEN_MAX_PAYLOAD
+  #define GX_TOKEN_MAX_PAYLOAD  1024
+#endif
+
+static optional void gx_token_key_init(gx_token_key *k, const void *key) {
+    static const uint8_t rcon[8] = {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40};
+    uint8_t *w = (uint8_t *)k->rk, t[4], zero[16] = {0}, u;
+    int      i, j;
+
+    memcpy(w, key, GX_TOKEN_KEYSIZE);
+    for(i = 8; i < 60; i++) {
+        memcpy(t, w + 4 * (i - 1), 4);
+        if(i % 8 == 0) {
+            u    = t[0];
+            t[0] = _gx_aes_sbox[t[1]] ^ rcon[i / 8];
+            t[1] = _gx_aes_sbox[t[2]];
+            t[2] = _gx_aes_sbox[t[3]];
+            t[3] = _gx_aes_sbox[u];
+        } else if(i % 8 == 4) for(j = 0; j < 4; j++) t[j] = _gx_aes_sbox[t[j]];
+        for(j = 0; j < 4; j++) w[4 * i + j] = w[4 * (i - 8) + j] ^ t[j];
+    }
+    _gx_aes_encrypt_sw(k, zero, k->h);
+    for(i = 0; i < 16; i++) k->h_rev[i] = k->h[15 - i];
+    k->hw = _GX_AESNI_OK();
+}
+
+static inline int _gx_token_tag_eq(const uint8_t *a, const uint8_t *b) {
+    uint8_t d = 0;
+    int     i;
+    for(i = 0; i < GX_TOKEN_TAGSIZE; i++) d |= a[i] ^ b[i];
+    return !d;
+}
+
+/// Fused nonce + encrypt + encode: a fresh nonce from nm (NULL = this
+/// thread's gx_nonce_local() machine) lands directly in the raw token, the
+/// payload is sealed behind it and the whole thing is base64'd into out,
+/// which needs GX_TOKEN_STRSIZE(plen) bytes. Returns the token's strlen.
+static optional inline ssize_t gx_token_mint(const gx_token_key *k, gx_nonce_machine *nm, uint8_t version,
+                                             const void *payload, size_t plen, char *out) {
+    uint8_t raw[GX_TOKEN_RAWSIZE(GX_TOKEN_MAX_PAYLOAD)];
+    if(rare(plen > GX_TOKEN_MAX_PAYLOAD)) {errno = EMSGSIZE; return -1;}
+    if(!nm) _N(nm = gx_nonce_local()) _raise(-1);
+    raw[0] = version;
+    _ (gx_nonce_next(nm, (char *)raw + 1)) _raise(-1);
+    if(freq(k->hw)) _gx_gcm_hw(k, raw + 1, raw, 1, payload, plen, raw + 13, raw + 13 + plen, 1);
+    else            _gx_gcm_sw(k, raw + 1, raw, 1, payload, plen, raw + 13, raw + 13 + plen, 1);
+    return gx_base64_urlencode(raw, GX_TOKEN_RAWSIZE(plen), out) - 1;
+}
+
+/// Decodes + authenticates + decrypts. On success the payload (up to
+/// toklen * 3 / 4 - GX_TOKEN_OVERHEAD bytes) is in payload, the version in
+/// *version, and its length is returned. Otherwise -1, with errno EINVAL
+/// (not a token), EMSGSIZE (too long) or EBADMSG (didn't authenticate- the
+/// payload is untouched). Failures are expected input, so nothing is logged.
+static inline ssize_t _gx_token_decode(const char *tok, size_t toklen, uint8_t *raw) {
+    ssize_t rlen;
+    if(rare(toklen >= GX_TOKEN_STRSIZE(GX_TOKEN_MAX_PAYLOAD))) {errno = EMSGSIZE; return -1;}
+    if(rare((rlen = gx_base64_urldecode(tok, toklen, raw)) < GX_TOKEN_OVERHEAD)) {errno = EINVAL; return -1;}
+    return rlen - GX_TOKEN_OVERHEAD;
+}
+
+static inline ssize_t _gx_token_accept(const uint8_t *raw, ssize_t plen, const uint8_t *tag, uint8_t *version, void *payload) {
+    if(rare(!_gx_token_tag_eq(tag, raw + 13 + plen))) {errno = EBADMSG; return -1;}
+    if(version) *version = raw[0];
+    memcpy(payload, raw + 13, plen);
+    return plen;
+}
+
+static optional inline ssize_t gx_token_open(const gx_token_key *k, const char *tok, size_t toklen,
+                                             uint8_t *version, void *payload) {
+    uint8_t raw[GX_TOKEN_RAWSIZE(GX_TOKEN_MAX_PAYLOAD)], tag[GX_TOKEN_TAGSIZE];
+    ssize_t plen;
+    if(rare((plen = _gx_token_decode(tok, toklen, raw)) < 0)) return -1;
+    if(freq(k->hw)) _gx_gcm_hw(k, raw + 1, raw, 1, raw + 13, plen, raw + 13, tag, 0);
+    else            _gx_gcm_sw(k, raw + 1, raw, 1, raw + 13, plen, raw + 13, tag, 0);
+    return _gx_token_accept(raw, plen, tag, version, payload);
+}
+
+/// Batch verify: toks[i] (lens[i] chars) -> the payload at payloads + i * stride,
+/// its length (or -1, see gx_token_open) in plens[i] and, if versions isn't
+/// NULL, its version in versions[i]. Returns how many authenticated. With
+/// AES-NI four tokens at a time share every AES and GHASH pass.
+static optional size_t gx_token_open_n(const gx_token_key *k, const char *const *toks, const size_t *lens, size_t n,
+                                       uint8_t *versions, void *payloads, size_t stride, ssize_t *plens) {
+    uint8_t  raws[4][GX_TOKEN_RAWSIZE(GX_TOKEN_MAX_PAYLOAD)], tags[4][16], *raw[4];
+    size_t   len[4], i, ok = 0;
+    ssize_t  pl;
+    int      l, lanes, idx[4];
+
+    for(i = 0; i < n; ) {
+        if(!k->hw) {
+            plens[i] = gx_token_open(k, toks[i], lens[i], versions ? versions + i : NULL, (uint8_t *)payloads + i * stride);
+            ok += plens[i++] >= 0;
+            continue;
+        }
+        for(lanes = 0; lanes < 4 && i < n; i++) {
+            if(rare((pl = _gx_token_decode(toks[i], lens[i], raws[lanes])) < 0)) { plens[i] = -1; continue; }
+            raw[lanes] = raws[lanes];
+            len[lanes] = pl;
+            idx[lanes++] = i;
+        }
+        if(!lanes) continue;
+        _gx_gcm_open4_hw(k, raw, len, tags, lanes);
+        for(l = 0; l < lanes; l++) {
+            plens[idx[l]] = _gx_token_accept(raw[l], len[l], tags[l], versions ? versions + idx[l] : NULL,
+                                             (uint8_t *)payloads + idx[l] * stride);
+            ok += plens[idx[l]] >= 0;
         }
-exec:
-    switch_esys(rcv_count = read(_gx_devrandom_fd, dest, len)) {
-        case EINTR:   goto exec;
-        case EAGAIN:  if(is_strict) {
-                          if(tries++ < 10) {
-                              gx_sleep(0,100);
-                              goto exec;
-                          } else {errno = EAGAIN; return -1;}
-                      } else {
-                          log_warning("Getting subpar random numbers.");
-                          switch_esys(rcv_count = read(_gx_devurandom_fd, dest, len)) {
-                              case EINTR: goto exec;
-                              default:    close(_gx_devurandom_fd);
-                                          _gx_devurandom_fd = -1;
-                                          if(tries++ < 2) goto init;
-                                          else _raise(-1);
-                          }
-                      }
-                      break;
-        default:      close(_gx_devrandom_fd);
-                      _gx_devrandom_fd = -1;
-                      if(tries++ < 2) goto init;
-                      else _raise(-1);
     }
-    if((size_t)rcv_count < len) {
-        if(tries++ < 2) goto exec;
-        else {errno = EIO; return -1;}
+    return ok;
+}
+
+
+
+//-----------------------------------------------------------------------------
+/// Random bytes from the kernel's CSPRNG via getrandom(2)- never blocking
+/// request handling.
+///
+/// is_strict = 0: served from a per-thread pool that one getrandom call
+///   refills GX_RANDOM_POOL bytes at a time, so nonce init and reseeds cost a
+///   memcpy rather than a syscall. Bytes are wiped from the pool as they're
+///   handed out, and a forked child (same fork generation as the nonce
+///   machines) drops its copy, so parent and child never share any. Before
+///   the kernel's pool is initialized (early boot only) it warns and reads
+///   /dev/urandom instead of waiting.
+/// is_strict = 1 (hardened- keys etc.): unbuffered, straight from getrandom,
+///   and it does wait for the kernel's pool to be initialized.
+///
+/// With GX_RANDOM_MIX_RDRAND set, RDRAND (pool refills) / RDSEED (hardened)
+/// output is also xor'd in where the CPU has it. It can only add to the
+/// kernel's randomness, never stand in for it.
+#ifdef __LINUX__
+#include <sys/random.h>
+#else
+#define GRND_NONBLOCK 1                         // (getentropy never blocks anyway)
+#endif
+
+typedef struct _gx_random_pool {
+    uint8_t  buf[GX_RANDOM_POOL];
+    unsigned left;                              ///< Unused bytes, at the end of buf
+    unsigned fork_gen;                          ///< _gx_nonce_fork_gen when filled
+} _gx_random_pool;
+
+static __thread _gx_random_pool _gx_rnd_pool;
+static int                      _gx_devurandom_fd = -1;
+
+/// All of len, or -1. (flags GRND_NONBLOCK -> EAGAIN instead of waiting.)
+static int _gx_getrandom(void *dest, size_t len, int flags) {
+    uint8_t *p = (uint8_t *)dest;
+    ssize_t  got;
+    while(len) {
+  #ifdef __LINUX__
+        got = getrandom(p, len, flags);
+  #else
+        got = min(len, (size_t)256);
+        if(getentropy(p, got)) got = -1;
+  #endif
+        if(rare(got < 0)) {
+            if(errno == EINTR) continue;
+            return -1;
+        }
+        p   += got;
+        len -= got;
     }
     return 0;
 }
 
+static int _gx_urandom(void *dest, size_t len) {
+    uint8_t *p = (uint8_t *)dest;
+    ssize_t  got;
+    if(rare(_gx_devurandom_fd == -1))
+        _ (_gx_devurandom_fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC)) _raise(-1);
+    while(len) {
+        switch_esys(got = read(_gx_devurandom_fd, p, len)) {
+            case EINTR: continue;
+            default:    _raise(-1);
+        }
+        if(rare(got == 0)) { errno = EIO; _raise(-1); }
+        p   += got;
+        len -= got;
+    }
+    return 0;
+}
 
-//-----------------------------------------------------------------------------
-/// Very fast 64 bit hash of misc data with good properties. Only works on 64-bit machines.
-/// Based on CrapWow64 - http://www.team5150.com/~andrew/noncryptohashzoo/CrapWow64.html
-/// Unknown license. It has close to ideal lack of collisions and speed.
-static optional inline uint64_t gx_hash64(const char *key, uint64_t len, uint64_t seed) {
-    const uint64_t m = 0x95b47aa3355ba1a1, n = 0x8a970be7488fda55;
-    uint64_t hash;
-    // 3 = m, 4 = n
-    // r12 = h, r13 = k, ecx = seed, r12 = key
-    asm(
-        "leaq (%%rcx,%4), %%r13\n"
-        "movq %%rdx, %%r14\n"
-        "movq %%rcx, %%r15\n"
-        "movq %%rcx, %%r12\n"
-        "addq %%rax, %%r13\n"
-        "andq $0xfffffffffffffff0, %%rcx\n"
-        "jz QW%=\n"
-        "addq %%rcx, %%r14\n\n"
-        "negq %%rcx\n"
-    "XW%=:\n"
-        "movq %4, %%rax\n"
-        "mulq (%%r14,%%rcx)\n"
-        "xorq %%rax, %%r12\n"
-        "xorq %%rdx, %%r13\n"
-        "movq %3, %%rax\n"
-        "mulq 8(%%r14,%%rcx)\n"
-        "xorq %%rdx, %%r12\n"
-        "xorq %%rax, %%r13\n"
-        "addq $16, %%rcx\n"
-        "jnz XW%=\n"
-    "QW%=:\n"
-        "movq %%r15, %%rcx\n"
-        "andq $8, %%r15\n"
-        "jz B%=\n"
-        "movq %4, %%rax\n"
-        "mulq (%%r14)\n"
-        "addq $8, %%r14\n"
-        "xorq %%rax, %%r12\n"
-        "xorq %%rdx, %%r13\n"
-    "B%=:\n"
-        "andq $7, %%rcx\n"
-        "jz F%=\n"
-        "movq $1, %%rdx\n"
-        "shlq $3, %%rcx\n"
-        "movq %3, %%rax\n"
-        "shlq %%cl, %%rdx\n"
-        "addq $-1, %%rdx\n"
-        "andq (%%r14), %%rdx\n"
-        "mulq %%rdx\n"
-        "xorq %%rdx, %%r12\n"
-        "xorq %%rax, %%r13\n"
-    "F%=:\n"
-        "leaq (%%r13,%4), %%rax\n"
-        "xorq %%r12, %%rax\n"
-        "mulq %4\n"
-        "xorq %%rdx, %%rax\n"
-        "xorq %%r12, %%rax\n"
-        "xorq %%r13, %%rax\n"
-        : "=a"(hash), "=c"(key), "=d"(key)
-        : "r"(m), "r"(n), "a"(seed), "c"(len), "d"(key)
-        : "%r12", "%r13", "%r14", "%r15", "cc");
-    return hash;
-/*#elif !defined(INTEL)
-   #define cwfold(a, b, lo, hi) { p = (uint64_t)(a) * (u128)(b); lo ^= (uint64_t)p; hi ^= (uint64_t)(p >> 64); }
-   #define cwmixa( in ) { cwfold( in, m, k, h ); }
-   #define cwmixb( in ) { cwfold( in, n, h, k ); }
-
-    const uint64_t *key8 = (const uint64_t *)key;
-    uint64_t h = len, k = len + seed + n;
-    u128 p;
-
-    while ( len >= 16 ) { cwmixb(key8[0]) cwmixa(key8[1]) key8 += 2; len -= 16; }
-    if ( len >= 8 ) { cwmixb(key8[0]) key8 += 1; len -= 8; }
-    if ( len ) { cwmixa( key8[0] & ( ( (uint64_t)1 << ( len * 8 ) ) - 1 ) ) }
-    cwmixb( h ^ (k + n) )
-        return k ^ h;
+#if GX_RANDOM_MIX_RDRAND && (__GNUC__ && (__x86_64__ || __amd64__))
+/// xor RDSEED (if seed and the CPU has it) or RDRAND output into p. Gives up
+/// quietly when the instructions keep failing- it's only a mixer.
+static __attribute__((target("rdrnd,rdseed"))) void _gx_random_mix(uint8_t *p, size_t len, int seed) {
+    static int         have = -1;               // bit 0: RDRAND, bit 1: RDSEED
+    unsigned long long r;
+    size_t             i, n;
+    int                tries, ok;
+    if(rare(have < 0)) {
+        __builtin_cpu_init();
+        have = !!__builtin_cpu_supports("rdrnd") | !!__builtin_cpu_supports("rdseed") << 1;
+    }
+    for(; len; p += n, len -= n) {
+        ok = 0;
+        if(seed && (have & 2)) for(tries = 0; !ok && tries < 10; tries++) ok = _rdseed64_step(&r);
+        if(!ok && (have & 1))  for(tries = 0; !ok && tries < 10; tries++) ok = _rdrand64_step(&r);
+        if(rare(!ok)) return;
+        for(i = 0, n = min(len, sizeof(r)); i < n; i++) p[i] ^= (uint8_t)(r >> (i * 8));
+    }
+    r = 0;
+}
+#else
+#define _gx_random_mix(P, LEN, SEED) do {} while(0)
 #endif
-*/
+
+/// Non-blocking fill for the pool and for large non-strict requests.
+static int _gx_random_fill(void *dest, size_t len) {
+    if(rare(_gx_getrandom(dest, len, GRND_NONBLOCK))) {
+        if(errno != EAGAIN && errno != ENOSYS) _raise(-1);
+        log_warning("Getting subpar random numbers.");
+        _ (_gx_urandom(dest, len)) _raise(-1);
+    }
+    _gx_random_mix((uint8_t *)dest, len, 0);
+    return 0;
+}
+
+static optional int gx_dev_random(void *dest, size_t len, int is_strict) {
+    _gx_random_pool *pl = &_gx_rnd_pool;
+    uint8_t         *src;
+    unsigned         gen;
+    if(rare(len == 0 || dest == NULL)) {
+        errno = EINVAL;
+        return -1;
+    }
+    if(is_strict) {
+        _ (_gx_getrandom(dest, len, 0)) _raise(-1);
+        _gx_random_mix((uint8_t *)dest, len, 1);
+        return 0;
+    }
+    if(rare(len > GX_RANDOM_POOL / 4)) return _gx_random_fill(dest, len);
+
+    gen = _gx_nonce_fork_gen;
+    if(rare(pl->left < len || pl->fork_gen != gen)) {
+        pthread_once(&_gx_nonce_atfork_once, _gx_nonce_atfork);
+        _ (_gx_random_fill(pl->buf, GX_RANDOM_POOL)) { pl->left = 0; _raise(-1); }
+        pl->left     = GX_RANDOM_POOL;
+        pl->fork_gen = gen;
+    }
+    src = pl->buf + GX_RANDOM_POOL - pl->left;
+    memcpy(dest, src, len);
+    memset(src, 0, len);
+    pl->left -= len;
+    return 0;
 }
+
+
 #endif
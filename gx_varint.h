@@ -0,0 +1,253 @@
+/**
+  Varints: LEB128 and big-endian VLQ, zigzag, bounds-checked decoding and
+  bulk forms.
+
+  Two byte orders of the same 7-bits-per-byte idea (high bit = more follows):
+    - gx_leb128_*: least significant group first- protobuf, DWARF, wasm.
+    - gx_vlq_*:    most significant group first- exactly what uint_to_vlq /
+      vlq_to_uint in gx.h produce and read (so the binary log format).
+  Either way a uint64 takes 1-10 bytes (gx_varint_len), and signed values go
+  through gx_zigzag first so small negatives stay short.
+
+  Instead of a byte at a time, everything up to 8 bytes (values < 2^56) is
+  one 8-byte load or store: the terminating byte is a ctz / clz of the
+  inverted high bits, and the 7-bit groups are packed / spread with three
+  shift-and-mask steps (a portable pext / pdep). So there's no per-byte
+  branch- only the rare 9 or 10 byte values take the slow path. That's why
+  put writes (and get, when it can, reads) a whole GX_VARINT_MAX bytes: out
+  always needs that much room, but the returned length is what counts.
+
+  Decoding never reads past end. It returns the position after the value,
+  or NULL with errno ENODATA (ran out of input- more may come) or EOVERFLOW
+  (over 10 bytes, or more than 64 bits). Non-minimal encodings (extra
+  0x80 groups) decode like protobuf does, to the same value.
+
+  The _n forms do arrays. Decoding checks 16 bytes at a time and when none
+  have the high bit (all 1-byte values- most of them, in compact records)
+  widens them straight to 16 values; otherwise it falls back to the word
+  path value by value. (Masked-VByte's full 4096-entry shuffle tables aren't
+  worth carrying in a header for what records here look like- see the
+  benchmark in tst/test_gx_varint.c.)
+
+  | function / macro                     | description                                        |
+  | ------------------------------------ | -------------------------------------------------- |
+  | gx_varint_len(x)                     | Bytes x takes, 1-10 (either order)                 |
+  | gx_zigzag(i) / gx_unzigzag(u)        | int64 <-> uint64, small magnitudes -> small values |
+  | gx_leb128_put(x, out)                | -> bytes written (out needs GX_VARINT_MAX room)    |
+  | gx_leb128_get(p, end, &x)            | -> after the value, or NULL (ENODATA, EOVERFLOW)   |
+  | gx_vlq_put(x, out)                   | Same, big-endian (== uint_to_vlq)                  |
+  | gx_vlq_get(p, end, &x)               | Same, big-endian (bounds-checked vlq_to_uint)      |
+  | gx_leb128_put_n(vals, n, out)        | -> bytes written (out needs n * GX_VARINT_MAX)     |
+  | gx_leb128_get_n(p, end, vals, n)     | -> after the n'th value, or NULL                   |
+  | gx_vlq_put_n / gx_vlq_get_n          | Same, big-endian                                   |
+*/
+#ifndef _GX_VARINT_H
+#define _GX_VARINT_H
+
+#include "./gx.h"
+#include "./gx_endian.h"
+
+#define GX_VARINT_MAX 10
+
+#define _GX_VI_HI  0x8080808080808080ULL
+#define _GX_VI_LO  0x7f7f7f7f7f7f7f7fULL
+
+static optional inline uint64_t gx_zigzag(int64_t i)    { return ((uint64_t)i << 1) ^ (uint64_t)(i >> 63); }
+static optional inline int64_t  gx_unzigzag(uint64_t u) { return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+
+/// 9 * significant-bits / 64, rounded up, is exactly ceil(bits / 7) for 1-64.
+static optional inline int gx_varint_len(uint64_t x) {
+    return (9 * (64 - __builtin_clzll(x | 1)) + 64) / 64;
+}
+
+static inline uint64_t _gx_vi_ld64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return gx_bytes_BE ? bswap64(v) : v;
+}
+
+static inline void _gx_vi_st64(uint8_t *p, uint64_t v) {
+    if(gx_bytes_BE) v = bswap64(v);
+    memcpy(p, &v, 8);
+}
+
+/// Byte i's 7 low bits -> bits 7i..7i+6 (8 groups -> 56 bits), and back.
+static inline uint64_t _gx_vi_pack(uint64_t w) {
+    w = (w & 0x007f007f007f007fULL) | ((w & 0x7f007f007f007f00ULL) >> 1);
+    w = (w & 0x00003fff00003fffULL) | ((w & 0x3fff00003fff0000ULL) >> 2);
+    return (w & 0x000000000fffffffULL) | ((w & 0x0fffffff00000000ULL) >> 4);
+}
+
+static inline uint64_t _gx_vi_spread(uint64_t x) {
+    x = (x & 0x000000000fffffffULL) | ((x & 0x00fffffff0000000ULL) << 4);
+    x = (x & 0x00003fff00003fffULL) | ((x & 0x0fffc0000fffc000ULL) << 2);
+    return (x & 0x007f007f007f007fULL) | ((x & 0x3f803f803f803f80ULL) << 1);
+}
+
+//-----------------------------------------------------------------------------
+static optional inline int gx_leb128_put(uint64_t x, uint8_t *out) {
+    int len = gx_varint_len(x);
+    if(freq(len <= 8)) {
+        _gx_vi_st64(out, _gx_vi_spread(x) | (_GX_VI_HI & ((1ULL << (8 * len - 8)) - 1)));
+        return len;
+    }
+    _gx_vi_st64(out, _gx_vi_spread(x & 0x00ffffffffffffffULL) | _GX_VI_HI);
+    out[8] = ((x >> 56) & 0x7f) | (len > 9 ? 0x80 : 0);
+    out[9] = 1;                          // (Harmless scratch when len is 9)
+    return len;
+}
+
+static optional inline const uint8_t *gx_leb128_get(const uint8_t *p, const uint8_t *end, uint64_t *x) {
+    uint64_t w, stop, v;
+    int      i;
+    if(freq(end - p >= 8)) {
+        w    = _gx_vi_ld64(p);
+        stop = ~w & _GX_VI_HI;
+        if(freq(stop)) {                 // Terminator in the first 8: keep bytes up to it
+            *x = _gx_vi_pack(w & (stop ^ (stop - 1)) & _GX_VI_LO);
+            return p + __builtin_ctzll(stop) / 8 + 1;
+        }
+        v = _gx_vi_pack(w & _GX_VI_LO);
+        i = 8;
+    } else v = 0, i = 0;
+    for(;; i++) {
+        if(rare(p + i >= end)) {errno = ENODATA; return NULL;}
+        if(rare(i == 9 && p[i] > 1)) {errno = EOVERFLOW; return NULL;}
+        v |= (uint64_t)(p[i] & 0x7f) << (7 * i);
+        if(!(p[i] & 0x80)) break;
+    }
+    *x = v;
+    return p + i + 1;
+}
+
+//-----------------------------------------------------------------------------
+static optional inline int gx_vlq_put(uint64_t x, uint8_t *out) {
+    int len = gx_varint_len(x), i;
+    if(freq(len <= 8)) {                 // Groups 1.. get the high bit, then group len-1 goes first
+        uint64_t s = _gx_vi_spread(x) | (_GX_VI_HI & (~0ULL >> (64 - 8 * len)) & ~0xffULL);
+        _gx_vi_st64(out, bswap64(s << (64 - 8 * len)));
+        return len;
+    }
+    i = len - 8;                         // 1 or 2 head bytes (bit 63, then bits 56-62), then the low 56 as above
+    out[0] = 0x81;
+    out[i - 1] = ((x >> 56) & 0x7f) | 0x80;
+    _gx_vi_st64(out + i, bswap64(_gx_vi_spread(x & 0x00ffffffffffffffULL) | (_GX_VI_HI & ~0xffULL)));
+    return len;
+}
+
+static optional inline const uint8_t *gx_vlq_get(const uint8_t *p, const uint8_t *end, uint64_t *x) {
+    uint64_t w, stop, v;
+    int      i, hb;
+    if(freq(end - p >= 8)) {
+        w    = bswap64(_gx_vi_ld64(p));  // First byte on top
+        stop = ~w & _GX_VI_HI;
+        if(freq(stop)) {                 // Topmost terminator; drop the bytes after it
+            hb = 63 - __builtin_clzll(stop);
+            *x = _gx_vi_pack((w >> (hb - 7)) & _GX_VI_LO);
+            return p + 8 - hb / 8;
+        }
+        v = _gx_vi_pack(w & _GX_VI_LO);
+        i = 8;
+    } else v = 0, i = 0;
+    for(;; i++) {
+        if(rare(p + i >= end)) {errno = ENODATA; return NULL;}
+        if(rare(i == GX_VARINT_MAX || v >> 57)) {errno = EOVERFLOW; return NULL;}
+        v = (v << 7) | (p[i] & 0x7f);
+        if(!(p[i] & 0x80)) break;
+    }
+    *x = v;
+    return p + i + 1;
+}
+
+//-----------------------------------------------------------------------------
+// Bulk. be is a constant once these are (forcibly) inlined, so each public
+// form gets its own loop.
+static always_inline size_t _gx_varint_put_n(const uint64_t *vals, size_t n, uint8_t *out, int be) {
+    uint8_t *o = out;
+    size_t   i;
+    for(i = 0; i < n; i++) o += be ? gx_vlq_put(vals[i], o) : gx_leb128_put(vals[i], o);
+    return o - out;
+}
+
+/// High bits of p[0..15] -> bits 0..15 without SIMD: each half's bit 7s are
+/// shifted down to bit 0 of their bytes and the multiply gathers byte k's
+/// into bit 56 + k (nothing below carries that far). Always built, so the
+/// tests can hold it against the SSE2 one.
+static inline unsigned _gx_varint_mask16_swar(const uint8_t *p) {
+    return  (unsigned)((((_gx_vi_ld64(p)     & _GX_VI_HI) >> 7) * 0x0102040810204080ULL) >> 56)
+         | ((unsigned)((((_gx_vi_ld64(p + 8) & _GX_VI_HI) >> 7) * 0x0102040810204080ULL) >> 56) << 8);
+}
+
+#if (__GNUC__ && (__x86_64__ || __amd64__))
+#include <emmintrin.h>
+/// High bits of p[0..15] -> bits 0..15
+static inline unsigned _gx_varint_mask16(const uint8_t *p) {
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p));
+}
+
+/// 16 one-byte values
+static inline void _gx_varint_widen16(const uint8_t *p, uint64_t *vals) {
+    __m128i b = _mm_loadu_si128((const __m128i *)p), z = _mm_setzero_si128(), w, d;
+    int     k;
+    for(k = 0; k < 2; k++) {
+        w = k ? _mm_unpackhi_epi8(b, z) : _mm_unpacklo_epi8(b, z);
+        d = _mm_unpacklo_epi16(w, z);
+        _mm_storeu_si128((__m128i *)(vals + 8 * k),     _mm_unpacklo_epi32(d, z));
+        _mm_storeu_si128((__m128i *)(vals + 8 * k + 2), _mm_unpackhi_epi32(d, z));
+        d = _mm_unpackhi_epi16(w, z);
+        _mm_storeu_si128((__m128i *)(vals + 8 * k + 4), _mm_unpacklo_epi32(d, z));
+        _mm_storeu_si128((__m128i *)(vals + 8 * k + 6), _mm_unpackhi_epi32(d, z));
+    }
+}
+#else
+static inline unsigned _gx_varint_mask16(const uint8_t *p) { return _gx_varint_mask16_swar(p); }
+
+static inline void _gx_varint_widen16(const uint8_t *p, uint64_t *vals) {
+    int k;
+    for(k = 0; k < 16; k++) vals[k] = p[k];
+}
+#endif
+
+/// Masked-VByte style: one mask per 16-byte window says where every value
+/// in it ends, so each is a load + pack that doesn't wait on the one before
+/// (unlike a chain of single gets, where the next start is the last result).
+/// Windows need 24 readable bytes (a value can start at 15 and is loaded as
+/// 8); the rest, and anything over 8 bytes, goes through the single get.
+static always_inline const uint8_t *_gx_varint_get_n(const uint8_t *p, const uint8_t *end, uint64_t *vals, size_t n, int be) {
+    size_t   i = 0;
+    unsigned term;
+    int      start, len;
+    uint64_t w;
+    while(i < n && end - p >= 24) {
+        term = ~_gx_varint_mask16(p) & 0xffff;
+        if(term == 0xffff && n - i >= 16) { _gx_varint_widen16(p, vals + i); p += 16; i += 16; continue; }
+        for(start = 0; term && i < n; term &= term - 1) {
+            len = __builtin_ctz(term) + 1 - start;
+            if(rare(len > 8)) break;
+            w = _gx_vi_ld64(p + start);
+            vals[i++] = be ? _gx_vi_pack((bswap64(w) >> (64 - 8 * len)) & _GX_VI_LO)
+                           : _gx_vi_pack(w & (~0ULL >> (64 - 8 * len)) & _GX_VI_LO);
+            start += len;
+        }
+        p += start;
+        if(rare(!start)) break;          // Starts with a long (or bad) one
+    }
+    for(; i < n; i++)
+        if(rare(!(p = be ? gx_vlq_get(p, end, vals + i) : gx_leb128_get(p, end, vals + i)))) return NULL;
+    return p;
+}
+
+static optional inline size_t gx_leb128_put_n(const uint64_t *vals, size_t n, uint8_t *out) {
+    return _gx_varint_put_n(vals, n, out, 0);
+}
+static optional inline size_t gx_vlq_put_n(const uint64_t *vals, size_t n, uint8_t *out) {
+    return _gx_varint_put_n(vals, n, out, 1);
+}
+static optional inline const uint8_t *gx_leb128_get_n(const uint8_t *p, const uint8_t *end, uint64_t *vals, size_t n) {
+    return _gx_varint_get_n(p, end, vals, n, 0);
+}
+static optional inline const uint8_t *gx_vlq_get_n(const uint8_t *p, const uint8_t *end, uint64_t *vals, size_t n) {
+    return _gx_varint_get_n(p, end, vals, n, 1);
+}
+
+#endif
@@ -0,0 +1,225 @@
+  #define ADHOC_OFFSET 32
+  #define KV_ENTRIES   72
+
+  static kv_head_t _key_sizes_master[] = {
+      4   + 1 + sizeof(kv_head_t),
+        8   + 1 + sizeof(kv_head_t),
+        4   + 1 + sizeof(kv_head_t),
+        3   + 1 + sizeof(kv_head_t),
+        6   + 1 + sizeof(kv_head_t),
+        6   + 1 + sizeof(kv_head_t),
+        8   + 1 + sizeof(kv_head_t),
+        8   + 1 + sizeof(kv_head_t),
+        12  + 1 + sizeof(kv_head_t),
+        14  + 1 + sizeof(kv_head_t),
+        12  + 1 + sizeof(kv_head_t),
+        10  + 1 + sizeof(kv_head_t),
+        10  + 1 + sizeof(kv_head_t),
+        9   + 1 + sizeof(kv_head_t),
+        7   + 1 + sizeof(kv_head_t),
+        9   + 1 + sizeof(kv_head_t),
+        9   + 1 + sizeof(kv_head_t),
+        9   + 1 + sizeof(kv_head_t),
+        8   + 1 + sizeof(kv_head_t),
+        9   + 1 + sizeof(kv_head_t),
+        11  + 1 + sizeof(kv_head_t),
+        11  + 1 + sizeof(kv_head_t),
+        9   + 1 + sizeof(kv_head_t),
+        7   + 1 + sizeof(kv_head_t),
+        8   + 1 + sizeof(kv_head_t),
+        7   + 1 + sizeof(kv_head_t),
+        8   + 1 + sizeof(kv_head_t),
+        12  + 1 + sizeof(kv_head_t),
+        14  + 1 + sizeof(kv_head_t),
+        11  + 1 + sizeof(kv_head_t),
+        13  + 1 + sizeof(kv_head_t),
+        14  + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t)
+  };
+  static kv_head_t _val_sizes_master[] = {
+      7   + 1 + sizeof(kv_head_t),
+        11  + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t),
+        0   + 1 + sizeof(kv_head_t)
+  };
+  static _gx_kv msg_tab_master[] = {
+      {&(_key_sizes_master[ 0]), sizeof(kv_head_t), "type"        , 5, &(_val_sizes_master[ 0]), sizeof(kv_head_t), "unknown"     , 8},
+        {&(_key_sizes_master[ 1]), sizeof(kv_head_t), "severity"    , 9, &(_val_sizes_master[ 1]), sizeof(kv_head_t), "SEV_UNKNOWN" , 12},
+        {&(_key_sizes_master[ 2]), 0, "name"        , 0, &(_val_sizes_master[ 2]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[ 3]), 0, "msg"         , 0, &(_val_sizes_master[ 3]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[ 4]), 0, "report"      , 0, &(_val_sizes_master[ 4]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[ 5]), 0, "result"      , 0, &(_val_sizes_master[ 5]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[ 6]), 0, "src_file"    , 0, &(_val_sizes_master[ 6]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[ 7]), 0, "src_line"    , 0, &(_val_sizes_master[ 7]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[ 8]), 0, "src_function", 0, &(_val_sizes_master[ 8]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[ 9]), 0, "src_expression", 0, &(_val_sizes_master[ 9]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[10]), 0, "err_severity", 0, &(_val_sizes_master[10]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[11]), 0, "err_family"  , 0, &(_val_sizes_master[11]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[12]), 0, "err_number"  , 0, &(_val_sizes_master[12]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[13]), 0, "err_label"   , 0, &(_val_sizes_master[13]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[14]), 0, "err_msg"     , 0, &(_val_sizes_master[14]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[15]), 0, "err_depth"   , 0, &(_val_sizes_master[15]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[16]), 0, "err_group"   , 0, &(_val_sizes_master[16]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[17]), 0, "err_stack"   , 0, &(_val_sizes_master[17]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[18]), 0, "sys_time"    , 0, &(_val_sizes_master[18]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[19]), 0, "sys_ticks"   , 0, &(_val_sizes_master[19]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[20]), 0, "sys_program" , 0, &(_val_sizes_master[20]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[21]), 0, "sys_version" , 0, &(_val_sizes_master[21]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[22]), 0, "sys_cpuid"   , 0, &(_val_sizes_master[22]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[23]), 0, "sys_pid"     , 0, &(_val_sizes_master[23]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[24]), 0, "sys_ppid"    , 0, &(_val_sizes_master[24]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[25]), 0, "sys_tid"     , 0, &(_val_sizes_master[25]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[26]), 0, "net_host"    , 0, &(_val_sizes_master[26]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[27]), 0, "net_bound_ip", 0, &(_val_sizes_master[27]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[28]), 0, "net_bound_port", 0, &(_val_sizes_master[28]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[29]), 0, "net_peer_ip" , 0, &(_val_sizes_master[29]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[30]), 0, "net_peer_port", 0, &(_val_sizes_master[30]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[31]), 0, "net_peer_state", 0, &(_val_sizes_master[31]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[32]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[32]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[33]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[33]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[34]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[34]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[35]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[35]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[36]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[36]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[37]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[37]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[38]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[38]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[39]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[39]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[40]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[40]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[41]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[41]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[42]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[42]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[43]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[43]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[44]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[44]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[45]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[45]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[46]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[46]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[47]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[47]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[48]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[48]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[49]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[49]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[50]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[50]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[51]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[51]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[52]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[52]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[53]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[53]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[54]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[54]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[55]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[55]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[56]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[56]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[57]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[57]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[58]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[58]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[59]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[59]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[60]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[60]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[61]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[61]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[62]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[62]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[63]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[63]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[64]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[64]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[65]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[65]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[66]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[66]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[67]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[67]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[68]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[68]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[69]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[69]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[70]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[70]), 0, _GX_NULLSTRING, 0},
+        {&(_key_sizes_master[71]), 0, _GX_NULLSTRING, 0, &(_val_sizes_master[71]), 0, _GX_NULLSTRING, 0}
+  };
@@ -0,0 +1,489 @@
+#ifndef _GXE_LOG_BINARY_H
+#define _GXE_LOG_BINARY_H
+/**
+   @file      gxe/log_binary.h
+   @brief     Compact binary logger + decoder (see util/gx_logdecode.c)
+   @author    Joseph A Wecker <joseph.wecker@gmail.com>
+   @copyright
+     Except where otherwise noted, Copyright (C) 2012 Joseph A Wecker
+
+     MIT License
+
+     Permission is hereby granted, free of charge, to any person obtaining a
+     copy of this software and associated documentation files (the "Software"),
+     to deal in the Software without restriction, including without limitation
+     the rights to use, copy, modify, merge, publish, distribute, sublicense,
+     and/or sell copies of the Software, and to permit persons to whom the
+     Software is furnished to do so, subject to the following conditions:
+
+     The above copyright notice and this permission notice shall be included in
+     all copies or substantial portions of the Software.
+
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+     IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+     FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+     THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+     LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+     FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+     DEALINGS IN THE SOFTWARE.
+
+
+   @details
+     Same kv_msg_iov as every other logger, but instead of text it writes:
+       - standard keys as their enum index, adhoc keys as strings
+       - no time / ticks / severity strings- a raw tick delta per record plus
+         a wall-clock anchor (unix ns + the tick read with it + ticks-per-
+         second) at the start of every chunk. Ticks are the full 64-bit
+         cpu_ts, so the delta never wraps; it is signed because a record
+         staged just before its chunk was anchored comes out slightly negative.
+       - values that are canonical unsigned decimals as varints (gx_vlq_put)
+       - values that come straight from msg_tab_master (program, pid, host,
+         ...) once per chunk as "context" instead of once per record
+
+     Records are buffered per thread and written as self-contained chunks
+     with a single write() (O_APPEND), so threads never interleave inside a
+     chunk and each chunk decodes on its own. A chunk goes out when it's
+     GX_LOG_BIN_CHUNK bytes, when it's older than GX_LOG_BIN_ANCHOR_MS, on any
+     record at or above GX_LOG_BIN_FLUSH_SEV, at thread exit, and on
+     gx_log_bin_flush().
+
+     File layout (vlq = gx_vlq_put, the same bytes as uint_to_vlq):
+
+         file    : "GXLB" u8(version) chunk*
+         chunk   : vlq(body-len) anchor (context | record)*
+         anchor  : 'A' vlq(unix-ns) vlq(tick) vlq(ticks-per-sec, 0=unknown)
+         context : 'C' field                      sticky until the chunk ends
+         record  : 'R' u8(severity) vlq(zigzag(tick - anchor-tick)) vlq(n) field*n
+         field   : vlq(key << 1 | is-num) [vlq(len) key-bytes] value
+                     - key bytes only when key == GX_LOG_BIN_ADHOC
+                     - value is vlq(n) if is-num, else vlq(len) bytes
+
+   | function                      | description                                         |
+   | ----------------------------- | --------------------------------------------------- |
+   | gx_log_bin_open(path)         | Append binary records to path and enable the logger |
+   | gx_log_bin_flush()            | Write out the calling thread's pending chunk        |
+   | gx_log_bin_dropped()          | Records lost to allocation or write failures        |
+   | gx_log_bin_close()            | Flush (this thread), disable the logger, close      |
+   | gx_log_bin_decode(buf,len,cb) | Walk a binary log, calling cb for every record      |
+
+*/
+#include <time.h>
+#include "../gx_varint.h"
+
+#ifndef GX_LOG_BIN_CHUNK
+  #define GX_LOG_BIN_CHUNK     4096          ///< Target chunk size (bytes)
+#endif
+#ifndef GX_LOG_BIN_ANCHOR_MS
+  #define GX_LOG_BIN_ANCHOR_MS 250           ///< Max chunk age- bounds how far a record's time is extrapolated
+#endif
+#ifndef GX_LOG_BIN_FLUSH_SEV
+  #define GX_LOG_BIN_FLUSH_SEV SEV_WARNING   ///< This or more severe goes out immediately
+#endif
+#ifndef GX_SEV_BINARY
+  #define GX_SEV_BINARY        SEV_DEBUG
+#endif
+
+#define GX_LOGGER_BINARY     3
+#define GX_LOG_BIN_MAGIC     "GXLB"
+#define GX_LOG_BIN_VERSION   1
+#define GX_LOG_BIN_ADHOC     ADHOC_OFFSET    ///< Key id meaning "key string follows"
+#define GX_LOG_BIN_PREFIX    10              ///< Room reserved in front of a chunk for its length
+
+typedef struct _gx_log_bin_tls {
+    uint8_t     *buf;          ///< GX_LOG_BIN_PREFIX + chunk body
+    size_t       cap;
+    size_t       len;          ///< Body bytes (0 = no chunk open)
+    uint64_t     anchor_tick;
+    uint64_t     anchor_mono;  ///< CLOCK_MONOTONIC ns at the anchor
+    unsigned int master_gen;   ///< _gx_log_master_gen the context was written for
+    unsigned int nrec;         ///< Records in the open chunk
+} _gx_log_bin_tls;
+
+static int                      _gx_log_bin_fd  = -1;
+static volatile uint64_t        _gx_log_bin_tps = 0;   ///< Ticks per second, shared estimate
+static volatile uint64_t        _gx_log_bin_dropped = 0;
+static pthread_key_t            _gx_log_bin_key;
+static pthread_once_t           _gx_log_bin_once = PTHREAD_ONCE_INIT;
+static __thread _gx_log_bin_tls _gx_log_bin     = {NULL, 0, 0, 0, 0, 0, 0};
+
+static inline uint64_t _gx_log_bin_ns(clockid_t clk) {
+    struct timespec ts;
+    clock_gettime(clk, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/// Inverse of _gx_cpu_ts_str()- the tick string is sortable base64 (_gx_t64).
+static inline uint64_t _gx_log_bin_ticks(const char *s, size_t len) {
+    uint64_t v = 0;
+    for(; len > 0 && *s; s++, len--) {
+        char c = *s;
+        int  d = c >= '0' && c <= '9' ? c - '0'
+               : c >= 'A' && c <= 'Z' ? c - 'A' + 10
+               : c == '_'             ? 36
+               : c >= 'a' && c <= 'z' ? c - 'a' + 37
+               : c == '-'             ? 63 : 0;
+        v = (v << 6) | (uint64_t)d;
+    }
+    return v;
+}
+
+/// Canonical unsigned decimal (no sign, no leading zeros, fits in 64 bits)?
+static inline int _gx_log_bin_num(const char *s, size_t len, uint64_t *out) {
+    uint64_t v = 0;
+    size_t   i;
+    if(len == 0 || len > 19 || (s[0] == '0' && len > 1)) return 0;
+    for(i = 0; i < len; i++) {
+        if(s[i] < '0' || s[i] > '9') return 0;
+        v = v * 10 + (uint64_t)(s[i] - '0');
+    }
+    *out = v;
+    return 1;
+}
+
+#define _gx_log_bin_vlq(P, V)    ((P) += gx_vlq_put((uint64_t)(V), (P)))   ///< Stores 8+ bytes- reserves allow for it
+
+/// Appends one field. Caller has made sure there is room.
+static inline uint8_t *_gx_log_bin_field(uint8_t *p, int idx, _gx_kv *kv) {
+    const char *val  = (const char *)kv->val_data_base;
+    size_t      vlen = kv->val_data_size - 1;
+    uint64_t    n;
+    int         num  = _gx_log_bin_num(val, vlen, &n);
+    if(idx >= ADHOC_OFFSET) {
+        size_t klen = kv->key_data_size ? kv->key_data_size - 1 : 0;
+        _gx_log_bin_vlq(p, (GX_LOG_BIN_ADHOC << 1) | num);
+        _gx_log_bin_vlq(p, klen);
+        memcpy(p, kv->key_data_base, klen); p += klen;
+    } else _gx_log_bin_vlq(p, (idx << 1) | num);
+    if(num) _gx_log_bin_vlq(p, n);
+    else {
+        _gx_log_bin_vlq(p, vlen);
+        memcpy(p, val, vlen); p += vlen;
+    }
+    return p;
+}
+
+/// Not per-record data: the entry is exactly what msg_tab_master has.
+#define _gx_log_bin_is_ctx(MSG, I)                                             \
+    ((MSG)->msg_tab[I].val_data_base == msg_tab_master[I].val_data_base &&     \
+     (MSG)->msg_tab[I].val_data_size == msg_tab_master[I].val_data_size)
+#define _gx_log_bin_skip(I) ((I) == K_severity || (I) == K_sys_time || (I) == K_sys_ticks)
+
+/// -1 if the buffer couldn't grow- it's left as it was.
+static int _gx_log_bin_reserve(size_t need) {
+    _gx_log_bin_tls *b = &_gx_log_bin;
+    size_t           cap;
+    uint8_t         *nb;
+    if(freq(GX_LOG_BIN_PREFIX + b->len + need <= b->cap)) return 0;
+    cap = max((size_t)GX_LOG_BIN_PREFIX + GX_LOG_BIN_CHUNK * 2, (GX_LOG_BIN_PREFIX + b->len + need) * 2);
+    if(rare(!(nb = (uint8_t *)realloc(b->buf, cap)))) return -1;
+    b->buf = nb;
+    b->cap = cap;
+    return 0;
+}
+
+/// Returns -1 (errno set) if the chunk couldn't be written; its records are
+/// counted in gx_log_bin_dropped(). A chunk cut short by an error mid-way
+/// leaves a truncated tail that the decoder reports as EILSEQ.
+static optional int gx_log_bin_flush() {
+    _gx_log_bin_tls *b = &_gx_log_bin;
+    uint8_t          vlq[GX_VARINT_MAX];
+    uint8_t         *p;
+    size_t           left;
+    ssize_t          w;
+    int              n, rv = 0;
+    if(!b->len) return 0;
+    if(_gx_log_bin_fd != -1) {
+        n    = gx_vlq_put(b->len, vlq);
+        p    = b->buf + GX_LOG_BIN_PREFIX - n;
+        left = b->len + n;
+        memcpy(p, vlq, n);
+        while(left) {
+            if(rare((w = write(_gx_log_bin_fd, p, left)) == -1)) {
+                if(errno == EINTR) continue;
+                __sync_fetch_and_add(&_gx_log_bin_dropped, b->nrec);
+                rv = -1;
+                break;
+            }
+            p    += w;
+            left -= (size_t)w;
+        }
+    }
+    b->len  = 0;
+    b->nrec = 0;
+    return rv;
+}
+
+static optional uint64_t gx_log_bin_dropped() { return _gx_log_bin_dropped; }
+
+static void _gx_log_bin_thread_exit(optional void *unused) {
+    gx_log_bin_flush();
+    free(_gx_log_bin.buf);
+    _gx_log_bin.buf = NULL;
+    _gx_log_bin.cap = 0;
+}
+
+static void _gx_log_bin_key_init() {
+    pthread_key_create(&_gx_log_bin_key, _gx_log_bin_thread_exit);
+}
+
+/// Signed distance between two ticks, zigzagged.
+static inline uint64_t _gx_log_bin_tdelta(uint64_t tick, uint64_t anchor) {
+    return gx_zigzag((int64_t)(tick - anchor));
+}
+
+/// Starts a chunk: anchor + every context entry. -1 (and no chunk) if the
+/// buffer can't hold them.
+static int _gx_log_bin_begin(uint64_t mono) {
+    _gx_log_bin_tls *b = &_gx_log_bin;
+    uint64_t         real = _gx_log_bin_ns(CLOCK_REALTIME);
+    uint64_t         tick = cpu_ts;
+    uint8_t         *p;
+    int              i;
+
+    // Refine the shared rate whenever two anchors are far enough apart to be
+    // accurate but close enough that the multiply can't overflow.
+    if(b->anchor_mono && mono - b->anchor_mono >= 100000000ULL && mono - b->anchor_mono < 900000000ULL)
+        _gx_log_bin_tps = (tick - b->anchor_tick) * 1000000000ULL
+                        / (mono - b->anchor_mono);
+    b->anchor_tick = tick;
+    b->anchor_mono = mono;
+    b->master_gen  = _gx_log_master_gen;
+
+    if(rare(_gx_log_bin_reserve(32))) return -1;
+    p = b->buf + GX_LOG_BIN_PREFIX;
+    *p++ = 'A';
+    _gx_log_bin_vlq(p, real);
+    _gx_log_bin_vlq(p, tick);
+    _gx_log_bin_vlq(p, _gx_log_bin_tps);
+    b->len = p - (b->buf + GX_LOG_BIN_PREFIX);
+
+    for(i = 0; i < ADHOC_OFFSET; i++) {
+        _gx_kv *kv = &(msg_tab_master[i]);
+        if(kv->val_data_size <= 1 || _gx_log_bin_skip(i)) continue;
+        if(rare(_gx_log_bin_reserve(kv->val_data_size + 16))) { b->len = 0; return -1; }
+        p    = b->buf + GX_LOG_BIN_PREFIX + b->len;
+        *p++ = 'C';
+        p    = _gx_log_bin_field(p, i, kv);
+        b->len = p - (b->buf + GX_LOG_BIN_PREFIX);
+    }
+    return 0;
+}
+
+static inline void log_binary(gx_severity severity, kv_msg_iov *msg) {
+    _gx_log_bin_tls *b = &_gx_log_bin;
+    _gx_kv          *kv;
+    uint64_t         tick, mono = _gx_log_bin_ns(CLOCK_MONOTONIC_COARSE);
+    size_t           need = 32;
+    uint8_t         *p;
+    int              i, n = 0;
+
+    if(rare(_gx_log_bin_fd == -1)) return;
+    if(rare(!b->buf)) pthread_setspecific(_gx_log_bin_key, b);
+
+    kv   = &(msg->msg_tab[K_sys_ticks]);
+    tick = kv->val_data_size > 1 ? _gx_log_bin_ticks((const char *)kv->val_data_base, kv->val_data_size - 1)
+                                 : (uint64_t)cpu_ts;
+
+    if(b->len && (b->len >= GX_LOG_BIN_CHUNK
+                  || mono - b->anchor_mono >= GX_LOG_BIN_ANCHOR_MS * 1000000ULL)) gx_log_bin_flush();
+    if(rare(b->len && b->master_gen != _gx_log_master_gen))
+        gx_log_bin_flush();                      // gx_log_set() since the context went out
+    if(!b->len && rare(_gx_log_bin_begin(mono))) goto dropped;
+
+    for(i = 0; i < KV_ENTRIES; i++) {
+        kv = &(msg->msg_tab[i]);
+        if(kv->val_data_size <= 1 || _gx_log_bin_skip(i)) continue;
+        if(i < ADHOC_OFFSET && _gx_log_bin_is_ctx(msg, i)) continue;
+        need += kv->val_data_size + kv->key_data_size + 24;
+        n ++;
+    }
+    if(rare(_gx_log_bin_reserve(need))) goto dropped;
+
+    p    = b->buf + GX_LOG_BIN_PREFIX + b->len;
+    *p++ = 'R';
+    *p++ = (uint8_t)severity;
+    _gx_log_bin_vlq(p, _gx_log_bin_tdelta(tick, b->anchor_tick));
+    _gx_log_bin_vlq(p, n);
+    for(i = 0; i < KV_ENTRIES; i++) {
+        kv = &(msg->msg_tab[i]);
+        if(kv->val_data_size <= 1 || _gx_log_bin_skip(i)) continue;
+        if(i < ADHOC_OFFSET && _gx_log_bin_is_ctx(msg, i)) continue;
+        p = _gx_log_bin_field(p, i, kv);
+    }
+    b->len = p - (b->buf + GX_LOG_BIN_PREFIX);
+    b->nrec ++;
+    if(severity <= GX_LOG_BIN_FLUSH_SEV) gx_log_bin_flush();
+    return;
+dropped:
+    __sync_fetch_and_add(&_gx_log_bin_dropped, 1);
+}
+
+static void _gx_log_bin_atexit() { gx_log_bin_flush(); }
+
+/// Returns -1 (errno set) if the file can't be opened / written.
+static optional int gx_log_bin_open(const char *path) {
+    struct stat st;
+    uint8_t     hdr[5] = {'G', 'X', 'L', 'B', GX_LOG_BIN_VERSION};
+    int         fd;
+    static int  exit_hooked = 0;
+
+    if((fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)) == -1) return -1;
+    if(fstat(fd, &st) == -1 || (st.st_size == 0 && write(fd, hdr, sizeof(hdr)) != sizeof(hdr))) {
+        close(fd);
+        return -1;
+    }
+    pthread_once(&_gx_log_bin_once, _gx_log_bin_key_init);
+    if(!_gx_log_bin_tps) _gx_log_bin_tps = gx_time_tps();   // Until the anchors refine it
+    if(!exit_hooked) { atexit(_gx_log_bin_atexit); exit_hooked = 1; }
+    if(_gx_log_bin_fd != -1) close(_gx_log_bin_fd);
+    _gx_log_bin_fd = fd;
+    gx_loggers[GX_LOGGER_BINARY].enabled = 1;
+    gx_log_update_sevmask();
+    return 0;
+}
+
+/// Other threads' pending chunks are lost- have them gx_log_bin_flush() first.
+static optional void gx_log_bin_close() {
+    gx_log_bin_flush();
+    gx_log_disable(GX_LOGGER_BINARY);
+    if(_gx_log_bin_fd != -1) close(_gx_log_bin_fd);
+    _gx_log_bin_fd = -1;
+}
+
+
+//------------------------------------------------------------------------------
+// Decoding
+//------------------------------------------------------------------------------
+
+typedef struct gx_log_bin_field {
+    int          key;          ///< Standard key index, or GX_LOG_BIN_ADHOC
+    const char  *key_str;      ///< Key name (standard ones from msg_tab_master)
+    size_t       key_len;
+    int          is_num;
+    uint64_t     num;
+    const char  *val;          ///< Not NUL-terminated
+    size_t       val_len;
+} gx_log_bin_field;
+
+typedef struct gx_log_bin_record {
+    gx_severity       severity;
+    uint64_t          tick;         ///< Raw cpu_ts (anchor tick + delta)
+    uint64_t          unix_ns;      ///< Wall-clock time interpolated from the anchor
+    int               nfields;
+    gx_log_bin_field  fields[KV_ENTRIES];
+    int               nctx;         ///< Context in effect for this record
+    gx_log_bin_field  ctx[ADHOC_OFFSET];
+} gx_log_bin_record;
+
+typedef int (*gx_log_bin_visit)(gx_log_bin_record *rec, void *udata);
+
+/// Bounds-checked vlq read; NULL on truncated (or over-long) input.
+#define _gx_log_bin_rvlq(P, END, V) gx_vlq_get(P, END, V)
+
+static inline const uint8_t *_gx_log_bin_rfield(const uint8_t *p, const uint8_t *end, gx_log_bin_field *f) {
+    uint64_t k, len;
+    if(!(p = _gx_log_bin_rvlq(p, end, &k)) || (k >> 1) > (uint64_t)GX_LOG_BIN_ADHOC) return NULL;
+    f->key    = (int)(k >> 1);
+    f->is_num = (int)(k & 1);
+    if(f->key == GX_LOG_BIN_ADHOC) {
+        if(!(p = _gx_log_bin_rvlq(p, end, &len)) || len > (uint64_t)(end - p)) return NULL;
+        f->key_str = (const char *)p;
+        f->key_len = len;
+        p += len;
+    } else {
+        f->key_str = (const char *)msg_tab_master[f->key].key_data_base;
+        f->key_len = strlen(f->key_str);
+    }
+    if(f->is_num) {
+        if(!(p = _gx_log_bin_rvlq(p, end, &(f->num)))) return NULL;
+        f->val = NULL; f->val_len = 0;
+    } else {
+        if(!(p = _gx_log_bin_rvlq(p, end, &len)) || len > (uint64_t)(end - p)) return NULL;
+        f->val = (const char *)p; f->val_len = len;
+        p += len;
+    }
+    return p;
+}
+
+/// Walks a whole binary log (header included). Stops early if visit returns
+/// non-zero. Returns the number of records, or -1 (errno=EILSEQ) if the data is
+/// malformed- records before the bad spot have already been visited.
+/// @param default_tps  used for chunks whose anchor didn't know the rate yet
+static optional ssize_t gx_log_bin_decode(const void *data, size_t size, uint64_t default_tps,
+                                          gx_log_bin_visit visit, void *udata) {
+    const uint8_t      *p = (const uint8_t *)data, *end = p + size;
+    gx_log_bin_record  *rec;
+    ssize_t             count = 0;
+    int                 stop = 0;
+
+    if(size < 5 || memcmp(p, GX_LOG_BIN_MAGIC, 4) || p[4] != GX_LOG_BIN_VERSION) { errno = EILSEQ; return -1; }
+    if(!(rec = (gx_log_bin_record *)malloc(sizeof(*rec)))) return -1;
+    p += 5;
+    while(p < end && !stop) {
+        uint64_t       clen, anchor_ns, anchor_tick, tps, v;
+        const uint8_t *cend;
+        if(!(p = _gx_log_bin_rvlq(p, end, &clen)) || clen > (uint64_t)(end - p)) goto bad;
+        cend = p + clen;
+        if(p >= cend || *p++ != 'A') goto bad;
+        if(!(p = _gx_log_bin_rvlq(p, cend, &anchor_ns))   ||
+           !(p = _gx_log_bin_rvlq(p, cend, &anchor_tick)) ||
+           !(p = _gx_log_bin_rvlq(p, cend, &tps))) goto bad;
+        if(!tps) tps = default_tps;
+        rec->nctx = 0;
+        while(p < cend && !stop) {
+            uint8_t tag = *p++;
+            if(tag == 'C') {
+                gx_log_bin_field f;
+                int              i;
+                if(!(p = _gx_log_bin_rfield(p, cend, &f))) goto bad;
+                for(i = 0; i < rec->nctx && rec->ctx[i].key != f.key; i++);
+                if(i == ADHOC_OFFSET) continue;
+                rec->ctx[i] = f;
+                if(i == rec->nctx) rec->nctx ++;
+            } else if(tag == 'R') {
+                int i;
+                if(p >= cend) goto bad;
+                rec->severity = (gx_severity)*p++;
+                if(!(p = _gx_log_bin_rvlq(p, cend, &v))) goto bad;
+                int64_t d    = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+                rec->tick    = anchor_tick + (uint64_t)d;
+                rec->unix_ns = anchor_ns + (tps ? (int64_t)((double)d * 1e9 / (double)tps) : 0);
+                if(!(p = _gx_log_bin_rvlq(p, cend, &v)) || v > KV_ENTRIES) goto bad;
+                rec->nfields = (int)v;
+                for(i = 0; i < rec->nfields; i++)
+                    if(!(p = _gx_log_bin_rfield(p, cend, &(rec->fields[i])))) goto bad;
+                count ++;
+                stop = visit(rec, udata);
+            } else goto bad;
+        }
+    }
+    free(rec);
+    return count;
+bad:
+    free(rec);
+    errno = EILSEQ;
+    return -1;
+}
+
+/// First non-zero rate in the file (gx_log_bin_decode's default_tps).
+static optional uint64_t gx_log_bin_first_tps(const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t *)data, *end = p + size;
+    uint64_t       clen, v, tps;
+    if(size < 5) return 0;
+    for(p += 5; p < end; p += clen) {
+        const uint8_t *q;
+        if(!(p = _gx_log_bin_rvlq(p, end, &clen)) || clen > (uint64_t)(end - p)) return 0;
+        q = p;
+        if(clen < 1 || *q++ != 'A') return 0;
+        if(!(q = _gx_log_bin_rvlq(q, p + clen, &v)) || !(q = _gx_log_bin_rvlq(q, p + clen, &v)) ||
+           !(q = _gx_log_bin_rvlq(q, p + clen, &tps))) return 0;
+        if(tps) return tps;
+    }
+    return 0;
+}
+
+#undef _gx_log_bin_vlq
+#undef _gx_log_bin_is_ctx
+#undef _gx_log_bin_skip
+
+#endif
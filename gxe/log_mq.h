@@ -0,0 +1,121 @@
+#ifndef _GXE_LOG_MQ_H
+#define _GXE_LOG_MQ_H
+/**
+   @file      gxe/log_mq.h
+   @brief     Logger that ships raw kv records to a collector over a posix message queue.
+   @author    Joseph A Wecker <joseph.wecker@gmail.com>
+   @copyright
+     Except where otherwise noted, Copyright (C) 2012 Joseph A Wecker
+
+     MIT License
+
+     Permission is hereby granted, free of charge, to any person obtaining a
+     copy of this software and associated documentation files (the "Software"),
+     to deal in the Software without restriction, including without limitation
+     the rights to use, copy, modify, merge, publish, distribute, sublicense,
+     and/or sell copies of the Software, and to permit persons to whom the
+     Software is furnished to do so, subject to the following conditions:
+
+     The above copyright notice and this permission notice shall be included in
+     all copies or substantial portions of the Software.
+
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+     IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+     FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+     THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+     LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+     FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+     DEALINGS IN THE SOFTWARE.
+
+
+   @details
+     Each record goes out as one message: the kv_msg_iov flattened exactly as
+     it's laid out for scatter-io-
+
+         | u32 total | (u16 klen | key\0 | u16 vlen | val\0)* | 03 00 \0 03 00 \0 |
+
+     where total covers the whole message, each u16 is the length of what
+     follows it + the NUL + 2, and the empty pair at the end terminates it.
+     Only keys that are set are present.
+
+     The queue is opened O_NONBLOCK (and created with GX_MQUEUE_MSG_COUNT x
+     GX_MQUEUE_MSG_SIZE if the collector hasn't made it yet), so a full queue
+     or an oversized record never blocks the caller- the record is counted in
+     gx_log_mq_dropped() instead.
+
+     Talks to the kernel directly (no librt) since gx_mqueue.h sits on top of
+     gx_error.h and so can't be used from inside the logger.
+
+   | function                | description                                        |
+   | ----------------------- | -------------------------------------------------- |
+   | gx_log_mq_open(name)    | Open/create the queue ("/name") and enable the sink |
+   | gx_log_mq_close()       | Disable the sink and close the queue                |
+   | gx_log_mq_dropped()     | Records dropped (queue full / too big) so far       |
+
+*/
+#ifndef GX_MQUEUE_MSG_COUNT
+  #define GX_MQUEUE_MSG_COUNT 10
+#endif
+#ifndef GX_MQUEUE_MSG_SIZE
+  #define GX_MQUEUE_MSG_SIZE  8192
+#endif
+
+#define GX_LOGGER_MQ 2
+
+#ifdef __LINUX__
+  #include <mqueue.h>
+#endif
+
+static int               _gx_log_mq_fd      = -1;
+static volatile uint64_t _gx_log_mq_dropped = 0;
+static __thread char     _gx_log_mq_buf[GX_MQUEUE_MSG_SIZE];
+
+static inline void log_mq(gx_severity severity, kv_msg_iov *msg) {
+    struct iovec *iov = MSG_AS_IOV(*msg);   // Already laid out for scatter-io
+    size_t        len = 0;
+    int           i;
+
+    if(rare(_gx_log_mq_fd == -1)) return;
+    for(i = 0; i < KV_IOV_COUNT; i++) {
+        if(!iov[i].iov_len) continue;
+        if(rare(len + iov[i].iov_len > sizeof(_gx_log_mq_buf))) goto drop;
+        memcpy(_gx_log_mq_buf + len, iov[i].iov_base, iov[i].iov_len);
+        len += iov[i].iov_len;
+    }
+    // Higher severity = lower gx_severity value = should be read first
+#ifdef __LINUX__
+    if(freq(syscall(SYS_mq_timedsend, _gx_log_mq_fd, _gx_log_mq_buf, len,
+                    (unsigned)(SEV_DEBUG - severity), NULL) == 0)) return;
+#endif
+drop:
+    __sync_fetch_and_add(&_gx_log_mq_dropped, 1);
+}
+
+/// Returns -1 (errno set) on failure. ENOSYS off linux.
+static optional int gx_log_mq_open(const char *name) {
+#ifdef __LINUX__
+    struct mq_attr attr = {.mq_maxmsg = GX_MQUEUE_MSG_COUNT, .mq_msgsize = GX_MQUEUE_MSG_SIZE};
+    int            fd;
+    if(!name || name[0] != '/') { errno = EINVAL; return -1; }
+    if((fd = syscall(SYS_mq_open, name + 1, O_WRONLY | O_CREAT | O_NONBLOCK | O_CLOEXEC,
+                     0600, &attr)) == -1) return -1;
+    if(_gx_log_mq_fd != -1) close(_gx_log_mq_fd);
+    _gx_log_mq_fd = fd;
+    gx_loggers[GX_LOGGER_MQ].enabled = 1;
+    gx_log_update_sevmask();
+    return 0;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static optional void gx_log_mq_close() {
+    gx_log_disable(GX_LOGGER_MQ);
+    if(_gx_log_mq_fd != -1) close(_gx_log_mq_fd);
+    _gx_log_mq_fd = -1;
+}
+
+static optional uint64_t gx_log_mq_dropped() { return _gx_log_mq_dropped; }
+
+#endif
@@ -93,14 +93,14 @@ static inline int check_stderr()
         }
     } else {
         // Probably daemonized- stderr is not even open. Disable this logger.
-        gx_loggers[0].enabled = 0;
+        gx_log_disable(0);
         return 1;
     }
     return 0;
 }
 
-static struct iovec out_iov[100] = {{NULL,0}};
-static int    iov_out_count      = 0;
+static __thread struct iovec out_iov[100] = {{NULL,0}};
+static __thread int    iov_out_count      = 0;
 
 #define CN           "\e[0m"
 
@@ -173,7 +173,7 @@ static inline void log_stderr(gx_severity severity, kv_msg_iov *msg)
     iov_out_count = 0;
 
     // Time + cpu-ticks
-    scat   (DT(K_sys_time) + 11, SZ(K_sys_time ) - 13);
+    scat   (DT(K_sys_time) + 11, min(SZ(K_sys_time), (size_t)21) - 13);   // hh:mm:ss
     scatc  (C_D ":" CN);
     len =  7 - SZ(K_sys_ticks);
     scat   (DT(K_sys_ticks) - len, len2 = SZ(K_sys_ticks) - 1 + len);
@@ -200,6 +200,12 @@ static inline void log_stderr(gx_severity severity, kv_msg_iov *msg)
 
     // User Message
     scatsd (K_msg);
+
+    // Native stack (origin of an error chain)
+    if(rare(SZ(K_err_stack) > 1)) {
+        scatc(C_D "\n    stack: " CN);
+        scat (DT(K_err_stack), SZ(K_err_stack) - 1);
+    }
     scat   ("\n",1);
 
 
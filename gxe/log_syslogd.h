@@ -0,0 +1,239 @@
+#ifndef _GXE_LOG_SYSLOGD_H
+#define _GXE_LOG_SYSLOGD_H
+/**
+   @file      gxe/log_syslogd.h
+   @brief     Logger that sends batched datagrams to the local syslog socket.
+   @author    Joseph A Wecker <joseph.wecker@gmail.com>
+   @copyright
+     Except where otherwise noted, Copyright (C) 2012 Joseph A Wecker
+
+     MIT License
+
+     Permission is hereby granted, free of charge, to any person obtaining a
+     copy of this software and associated documentation files (the "Software"),
+     to deal in the Software without restriction, including without limitation
+     the rights to use, copy, modify, merge, publish, distribute, sublicense,
+     and/or sell copies of the Software, and to permit persons to whom the
+     Software is furnished to do so, subject to the following conditions:
+
+     The above copyright notice and this permission notice shall be included in
+     all copies or substantial portions of the Software.
+
+     THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+     IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+     FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+     THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+     LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+     FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+     DEALINGS IN THE SOFTWARE.
+
+
+   @details
+     One datagram per record in the local (RFC 3164 without the timestamp-
+     syslogd stamps it on arrival) format:
+
+         <PRI>program[pid]: msg key=val key=val ...
+
+     where PRI = GX_LOG_SYSLOG_FACILITY * 8 + the syslog equivalent of the
+     severity, and the key=val pairs are whatever the record set beyond the
+     per-process defaults (src_file, err_label, adhoc keys, ...).
+
+     Datagrams are staged per thread and sent GX_LOG_SYSLOG_BATCH at a time
+     with one sendmmsg(). A batch also goes out when it's older than
+     GX_LOG_SYSLOG_FLUSH_MS, for anything at or above GX_LOG_SYSLOG_FLUSH_SEV,
+     at thread exit and on gx_log_syslog_flush(). Age is checked on the next
+     record and by gx_log_syslog_flush_stale(), which the gx_log_async drainer
+     runs on every pass- with async logging every batch is the drainer's, so
+     a quiet program's records still go out within about
+     GX_LOG_SYSLOG_FLUSH_MS + GX_LOG_ASYNC_IDLE_MS. A synchronous thread's
+     batch is its own: call gx_log_syslog_flush_stale() from that thread's
+     timer or event loop if it can go quiet for long.
+
+     The socket is nonblocking: if syslogd can't keep up the rest of the
+     batch is dropped and counted, never waited for (which is also why the
+     batch stays under the kernel's default datagram queue length for unix
+     sockets).
+
+   | function                    | description                                        |
+   | --------------------------- | -------------------------------------------------- |
+   | gx_log_syslog_open(path)    | Connect (NULL = /dev/log) and enable the sink      |
+   | gx_log_syslog_flush()       | Send the calling thread's pending datagrams        |
+   | gx_log_syslog_flush_stale() | Same, once they've waited GX_LOG_SYSLOG_FLUSH_MS   |
+   | gx_log_syslog_close()       | Flush (this thread), disable the sink, close       |
+   | gx_log_syslog_dropped()     | Datagrams dropped so far                           |
+
+*/
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+
+#ifndef GX_LOG_SYSLOG_FACILITY
+  #define GX_LOG_SYSLOG_FACILITY  1              ///< LOG_USER
+#endif
+#ifndef GX_LOG_SYSLOG_BATCH
+  #define GX_LOG_SYSLOG_BATCH     8              ///< Keep under net.unix.max_dgram_qlen (10)
+#endif
+#ifndef GX_LOG_SYSLOG_MAX
+  #define GX_LOG_SYSLOG_MAX       1024           ///< Longer records are truncated
+#endif
+#ifndef GX_LOG_SYSLOG_FLUSH_MS
+  #define GX_LOG_SYSLOG_FLUSH_MS  100
+#endif
+#ifndef GX_LOG_SYSLOG_FLUSH_SEV
+  #define GX_LOG_SYSLOG_FLUSH_SEV SEV_ERROR
+#endif
+
+#define GX_LOGGER_SYSLOG 1
+
+#ifdef __LINUX__
+/// struct mmsghdr / sendmmsg() only exist with _GNU_SOURCE, which gx.h can't
+/// set if a system header came in first- so the same layout, straight to
+/// the syscall.
+typedef struct _gx_mmsghdr {
+    struct msghdr msg_hdr;
+    unsigned int  msg_len;
+} _gx_mmsghdr;
+#define _gx_sendmmsg(FD, MSGS, N, FLAGS) ((int)syscall(SYS_sendmmsg, (FD), (MSGS), (N), (FLAGS)))
+#endif
+
+typedef struct _gx_log_syslog_tls {
+    char           *buf;                          ///< GX_LOG_SYSLOG_BATCH x GX_LOG_SYSLOG_MAX
+    struct iovec    iov[GX_LOG_SYSLOG_BATCH];
+    int             count;
+    struct timespec first;                        ///< When the oldest staged datagram was staged
+} _gx_log_syslog_tls;
+
+static int                         _gx_log_syslog_fd      = -1;
+static volatile uint64_t           _gx_log_syslog_dropped = 0;
+static pthread_key_t               _gx_log_syslog_key;
+static pthread_once_t              _gx_log_syslog_once    = PTHREAD_ONCE_INIT;
+static __thread _gx_log_syslog_tls _gx_log_syslog;
+
+/// gx_severity -> syslog severity (no UNKNOWN / STAT there)
+static const uint8_t _gx_log_syslog_sev[] = {0, 1, 2, 3, 4, 4, 5, 6, 6, 7};
+
+static optional void gx_log_syslog_flush() {
+    _gx_log_syslog_tls *s = &_gx_log_syslog;
+    int                 sent = 0, i;
+    if(!s->count) return;
+#ifdef __LINUX__
+    _gx_mmsghdr msgs[GX_LOG_SYSLOG_BATCH];
+    memset(msgs, 0, sizeof(_gx_mmsghdr) * s->count);
+    for(i = 0; i < s->count; i++) {
+        msgs[i].msg_hdr.msg_iov    = &(s->iov[i]);
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    while(sent < s->count) {
+        int n = _gx_sendmmsg(_gx_log_syslog_fd, msgs + sent, s->count - sent, MSG_DONTWAIT);
+        if(n <= 0) { if(n == -1 && errno == EINTR) continue; break; }
+        sent += n;
+    }
+#else
+    for(i = 0; i < s->count; i++)
+        if(send(_gx_log_syslog_fd, s->iov[i].iov_base, s->iov[i].iov_len, MSG_DONTWAIT) != -1) sent ++;
+#endif
+    if(rare(sent < s->count)) __sync_fetch_and_add(&_gx_log_syslog_dropped, s->count - sent);
+    s->count = 0;
+}
+
+static optional void gx_log_syslog_flush_stale() {
+    _gx_log_syslog_tls *s = &_gx_log_syslog;
+    struct timespec     now;
+    if(!s->count) return;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    if((now.tv_sec - s->first.tv_sec) * 1000 + (now.tv_nsec - s->first.tv_nsec) / 1000000
+            >= GX_LOG_SYSLOG_FLUSH_MS) gx_log_syslog_flush();
+}
+
+static void _gx_log_syslog_thread_exit(optional void *unused) {
+    gx_log_syslog_flush();
+    free(_gx_log_syslog.buf);
+    _gx_log_syslog.buf = NULL;
+}
+
+static void _gx_log_syslog_key_init() {
+    pthread_key_create(&_gx_log_syslog_key, _gx_log_syslog_thread_exit);
+}
+
+#define _gx_log_syslog_put(P, END, SRC, LEN) do {                              \
+    size_t _l = min((size_t)(LEN), (size_t)((END) - (P)));                     \
+    memcpy((P), (SRC), _l); (P) += _l;                                         \
+} while(0)
+
+static inline void log_syslogd(gx_severity severity, kv_msg_iov *msg) {
+    _gx_log_syslog_tls *s = &_gx_log_syslog;
+    char               *p, *start, *end;
+    _gx_kv             *kv;
+    int                 i;
+
+    if(rare(_gx_log_syslog_fd == -1)) return;
+    if(rare(!s->buf)) {
+        if(!(s->buf = (char *)malloc(GX_LOG_SYSLOG_BATCH * GX_LOG_SYSLOG_MAX))) {
+            __sync_fetch_and_add(&_gx_log_syslog_dropped, 1);
+            return;
+        }
+        pthread_setspecific(_gx_log_syslog_key, s);
+    }
+    gx_log_syslog_flush_stale();
+    if(!s->count) clock_gettime(CLOCK_MONOTONIC_COARSE, &(s->first));
+
+    p = start = s->buf + s->count * GX_LOG_SYSLOG_MAX;
+    end = start + GX_LOG_SYSLOG_MAX;
+    p  += snprintf(p, GX_LOG_SYSLOG_MAX, "<%u>%s[%s]: ",
+                   GX_LOG_SYSLOG_FACILITY * 8 + _gx_log_syslog_sev[severity < SEV_DEBUG ? severity : SEV_DEBUG],
+                   msg->msg_tab[K_sys_program].val_data_size > 1 ? (char *)msg->msg_tab[K_sys_program].val_data_base : "gx",
+                   msg->msg_tab[K_sys_pid    ].val_data_size > 1 ? (char *)msg->msg_tab[K_sys_pid    ].val_data_base : "0");
+    if(p > end) p = end;
+    kv = &(msg->msg_tab[K_msg]);
+    if(kv->val_data_size > 1) _gx_log_syslog_put(p, end, kv->val_data_base, kv->val_data_size - 1);
+    for(i = 0; i < KV_ENTRIES; i++) {
+        kv = &(msg->msg_tab[i]);
+        if(kv->val_data_size <= 1 || i == K_msg || i == K_severity || i == K_sys_time || i == K_sys_ticks) continue;
+        if(i < ADHOC_OFFSET && kv->val_data_base == msg_tab_master[i].val_data_base) continue;
+        _gx_log_syslog_put(p, end, " ", 1);
+        _gx_log_syslog_put(p, end, kv->key_data_base, kv->key_data_size ? kv->key_data_size - 1 : 0);
+        _gx_log_syslog_put(p, end, "=", 1);
+        _gx_log_syslog_put(p, end, kv->val_data_base, kv->val_data_size - 1);
+    }
+    s->iov[s->count].iov_base = start;
+    s->iov[s->count].iov_len  = p - start;
+    s->count ++;
+    if(s->count == GX_LOG_SYSLOG_BATCH || severity <= GX_LOG_SYSLOG_FLUSH_SEV) gx_log_syslog_flush();
+}
+#undef _gx_log_syslog_put
+
+static void _gx_log_syslog_atexit() { gx_log_syslog_flush(); }
+
+/// Returns -1 (errno set) if the socket can't be created / connected.
+static optional int gx_log_syslog_open(const char *path) {
+    struct sockaddr_un addr;
+    int                fd;
+    static int         exit_hooked = 0;
+
+    if(!path) path = "/dev/log";
+    if(strlen(path) >= sizeof(addr.sun_path)) { errno = ENAMETOOLONG; return -1; }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if((fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0)) == -1) return -1;
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) { close(fd); return -1; }
+    pthread_once(&_gx_log_syslog_once, _gx_log_syslog_key_init);
+    if(!exit_hooked) { atexit(_gx_log_syslog_atexit); exit_hooked = 1; }
+    if(_gx_log_syslog_fd != -1) close(_gx_log_syslog_fd);
+    _gx_log_syslog_fd = fd;
+    gx_loggers[GX_LOGGER_SYSLOG].enabled = 1;
+    gx_log_update_sevmask();
+    return 0;
+}
+
+/// Other threads' pending datagrams are lost- have them gx_log_syslog_flush() first.
+static optional void gx_log_syslog_close() {
+    gx_log_syslog_flush();
+    gx_log_disable(GX_LOGGER_SYSLOG);
+    if(_gx_log_syslog_fd != -1) close(_gx_log_syslog_fd);
+    _gx_log_syslog_fd = -1;
+}
+
+static optional uint64_t gx_log_syslog_dropped() { return _gx_log_syslog_dropped; }
+
+#endif
@@ -0,0 +1,138 @@
+/** Generated by gen/build-error-lookups from gx makefile for gx_error.h **/
+
+static const gx_error_lookup_info syserr_info[] = {
+    /*   0 */ {"EUNKNOWN",           "Unknown system error #0",                          SEV_UNKNOWN},
+    /*   1 */ {"EPERM",              "Operation not permitted",                          SEV_EMERGENCY},
+    /*   2 */ {"ENOENT",             "No such file or directory",                        SEV_ALERT},
+    /*   3 */ {"ESRCH",              "No such process",                                  SEV_ALERT},
+    /*   4 */ {"EINTR",              "Interrupted system call",                          SEV_ERROR},
+    /*   5 */ {"EIO",                "Input/output error",                               SEV_CRITICAL},
+    /*   6 */ {"ENXIO",              "No such device or address",                        SEV_EMERGENCY},
+    /*   7 */ {"E2BIG",              "Argument list too long",                           SEV_EMERGENCY},
+    /*   8 */ {"ENOEXEC",            "Exec format error",                                SEV_ALERT},
+    /*   9 */ {"EBADF",              "Bad file descriptor",                              SEV_ALERT},
+    /*  10 */ {"ECHILD",             "No child processes",                               SEV_ALERT},
+    /*  11 */ {"EAGAIN/EWOULDBLOCK", "Resource temporarily unavailable",                 SEV_ERROR},
+    /*  12 */ {"ENOMEM",             "Cannot allocate memory",                           SEV_CRITICAL},
+    /*  13 */ {"EACCES",             "Permission denied",                                SEV_EMERGENCY},
+    /*  14 */ {"EFAULT",             "Bad address",                                      SEV_ALERT},
+    /*  15 */ {"ENOTBLK",            "Block device required",                            SEV_ALERT},
+    /*  16 */ {"EBUSY",              "Device or resource busy",                          SEV_CRITICAL},
+    /*  17 */ {"EEXIST",             "File exists",                                      SEV_EMERGENCY},
+    /*  18 */ {"EXDEV",              "Invalid cross-device link",                        SEV_ALERT},
+    /*  19 */ {"ENODEV",             "No such device",                                   SEV_EMERGENCY},
+    /*  20 */ {"ENOTDIR",            "Not a directory",                                  SEV_ALERT},
+    /*  21 */ {"EISDIR",             "Is a directory",                                   SEV_EMERGENCY},
+    /*  22 */ {"EINVAL",             "Invalid argument",                                 SEV_ALERT},
+    /*  23 */ {"ENFILE",             "Too many open files in system",                    SEV_CRITICAL},
+    /*  24 */ {"EMFILE",             "Too many open files",                              SEV_CRITICAL},
+    /*  25 */ {"ENOTTY",             "Inappropriate ioctl for device",                   SEV_ALERT},
+    /*  26 */ {"ETXTBSY",            "Text file busy",                                   SEV_ERROR},
+    /*  27 */ {"EFBIG",              "File too large",                                   SEV_CRITICAL},
+    /*  28 */ {"ENOSPC",             "No space left on device",                          SEV_CRITICAL},
+    /*  29 */ {"ESPIPE",             "Illegal seek",                                     SEV_ALERT},
+    /*  30 */ {"EROFS",              "Read-only file system",                            SEV_EMERGENCY},
+    /*  31 */ {"EMLINK",             "Too many links",                                   SEV_CRITICAL},
+    /*  32 */ {"EPIPE",              "Broken pipe",                                      SEV_EMERGENCY},
+    /*  33 */ {"EDOM",               "Numerical argument out of domain",                 SEV_ALERT},
+    /*  34 */ {"ERANGE",             "Numerical result out of range",                    SEV_ALERT},
+    /*  35 */ {"EDEADLK/EDEADLOCK",  "Resource deadlock avoided",                        SEV_ERROR},
+    /*  36 */ {"ENAMETOOLONG",       "File name too long",                               SEV_CRITICAL},
+    /*  37 */ {"ENOLCK",             "No locks available",                               SEV_CRITICAL},
+    /*  38 */ {"ENOSYS",             "Function not implemented",                         SEV_EMERGENCY},
+    /*  39 */ {"ENOTEMPTY",          "Directory not empty",                              SEV_EMERGENCY},
+    /*  40 */ {"ELOOP",              "Too many levels of symbolic links",                SEV_EMERGENCY},
+    /*  41 */ {"EUNKNOWN",           "Unknown system error #41",                         SEV_UNKNOWN},
+    /*  42 */ {"ENOMSG",             "No message of desired type",                       SEV_CRITICAL},
+    /*  43 */ {"EIDRM",              "Identifier removed",                               SEV_CRITICAL},
+    /*  44 */ {"ECHRNG",             "Channel number out of range",                      SEV_ALERT},
+    /*  45 */ {"EL2NSYNC",           "Level 2 not synchronized",                         SEV_EMERGENCY},
+    /*  46 */ {"EL3HLT",             "Level 3 halted",                                   SEV_EMERGENCY},
+    /*  47 */ {"EL3RST",             "Level 3 reset",                                    SEV_EMERGENCY},
+    /*  48 */ {"ELNRNG",             "Link number out of range",                         SEV_UNKNOWN},
+    /*  49 */ {"EUNATCH",            "Protocol driver not attached",                     SEV_EMERGENCY},
+    /*  50 */ {"ENOCSI",             "No CSI structure available",                       SEV_UNKNOWN},
+    /*  51 */ {"EL2HLT",             "Level 2 halted",                                   SEV_EMERGENCY},
+    /*  52 */ {"EBADE",              "Invalid exchange",                                 SEV_ALERT},
+    /*  53 */ {"EBADR",              "Invalid request descriptor",                       SEV_UNKNOWN},
+    /*  54 */ {"EXFULL",             "Exchange full",                                    SEV_CRITICAL},
+    /*  55 */ {"ENOANO",             "No anode",                                         SEV_UNKNOWN},
+    /*  56 */ {"EBADRQC",            "Invalid request code",                             SEV_ALERT},
+    /*  57 */ {"EBADSLT",            "Invalid slot",                                     SEV_ALERT},
+    /*  58 */ {"EUNKNOWN",           "Unknown system error #58",                         SEV_UNKNOWN},
+    /*  59 */ {"EBFONT",             "Bad font file format",                             SEV_UNKNOWN},
+    /*  60 */ {"ENOSTR",             "Device not a stream",                              SEV_ALERT},
+    /*  61 */ {"ENODATA",            "No data available",                                SEV_ERROR},
+    /*  62 */ {"ETIME",              "Timer expired",                                    SEV_ERROR},
+    /*  63 */ {"ENOSR",              "Out of streams resources",                         SEV_CRITICAL},
+    /*  64 */ {"ENONET",             "Machine is not on the network",                    SEV_CRITICAL},
+    /*  65 */ {"ENOPKG",             "Package not installed",                            SEV_EMERGENCY},
+    /*  66 */ {"EREMOTE",            "Object is remote",                                 SEV_EMERGENCY},
+    /*  67 */ {"ENOLINK",            "Link has been severed",                            SEV_CRITICAL},
+    /*  68 */ {"EADV",               "Advertise error",                                  SEV_UNKNOWN},
+    /*  69 */ {"ESRMNT",             "Srmount error",                                    SEV_UNKNOWN},
+    /*  70 */ {"ECOMM",              "Communication error on send",                      SEV_CRITICAL},
+    /*  71 */ {"EPROTO",             "Protocol error",                                   SEV_EMERGENCY},
+    /*  72 */ {"EMULTIHOP",          "Multihop attempted",                               SEV_EMERGENCY},
+    /*  73 */ {"EDOTDOT",            "RFS specific error",                               SEV_UNKNOWN},
+    /*  74 */ {"EBADMSG",            "Bad message",                                      SEV_ALERT},
+    /*  75 */ {"EOVERFLOW",          "Value too large for defined data type",            SEV_ALERT},
+    /*  76 */ {"ENOTUNIQ",           "Name not unique on network",                       SEV_EMERGENCY},
+    /*  77 */ {"EBADFD",             "File descriptor in bad state",                     SEV_UNKNOWN},
+    /*  78 */ {"EREMCHG",            "Remote address changed",                           SEV_EMERGENCY},
+    /*  79 */ {"ELIBACC",            "Can not access a needed shared library",           SEV_EMERGENCY},
+    /*  80 */ {"ELIBBAD",            "Accessing a corrupted shared library",             SEV_EMERGENCY},
+    /*  81 */ {"ELIBSCN",            ".lib section in a.out corrupted",                  SEV_EMERGENCY},
+    /*  82 */ {"ELIBMAX",            "Attempting to link in too many shared libraries",  SEV_EMERGENCY},
+    /*  83 */ {"ELIBEXEC",           "Cannot exec a shared library directly",            SEV_EMERGENCY},
+    /*  84 */ {"EILSEQ",             "Invalid or incomplete multibyte or wide character", SEV_ALERT},
+    /*  85 */ {"ERESTART",           "Interrupted system call should be restarted",      SEV_ERROR},
+    /*  86 */ {"ESTRPIPE",           "Streams pipe error",                               SEV_ALERT},
+    /*  87 */ {"EUSERS",             "Too many users",                                   SEV_CRITICAL},
+    /*  88 */ {"ENOTSOCK",           "Socket operation on non-socket",                   SEV_ALERT},
+    /*  89 */ {"EDESTADDRREQ",       "Destination address required",                     SEV_ALERT},
+    /*  90 */ {"EMSGSIZE",           "Message too long",                                 SEV_CRITICAL},
+    /*  91 */ {"EPROTOTYPE",         "Protocol wrong type for socket",                   SEV_ALERT},
+    /*  92 */ {"ENOPROTOOPT",        "Protocol not available",                           SEV_EMERGENCY},
+    /*  93 */ {"EPROTONOSUPPORT",    "Protocol not supported",                           SEV_EMERGENCY},
+    /*  94 */ {"ESOCKTNOSUPPORT",    "Socket type not supported",                        SEV_EMERGENCY},
+    /*  95 */ {"ENOTSUP/EOPNOTSUPP", "Operation not supported",                          SEV_EMERGENCY},
+    /*  96 */ {"EPFNOSUPPORT",       "Protocol family not supported",                    SEV_EMERGENCY},
+    /*  97 */ {"EAFNOSUPPORT",       "Address family not supported by protocol",         SEV_EMERGENCY},
+    /*  98 */ {"EADDRINUSE",         "Address already in use",                           SEV_EMERGENCY},
+    /*  99 */ {"EADDRNOTAVAIL",      "Cannot assign requested address",                  SEV_EMERGENCY},
+    /* 100 */ {"ENETDOWN",           "Network is down",                                  SEV_CRITICAL},
+    /* 101 */ {"ENETUNREACH",        "Network is unreachable",                           SEV_CRITICAL},
+    /* 102 */ {"ENETRESET",          "Network dropped connection on reset",              SEV_CRITICAL},
+    /* 103 */ {"ECONNABORTED",       "Software caused connection abort",                 SEV_CRITICAL},
+    /* 104 */ {"ECONNRESET",         "Connection reset by peer",                         SEV_CRITICAL},
+    /* 105 */ {"ENOBUFS",            "No buffer space available",                        SEV_CRITICAL},
+    /* 106 */ {"EISCONN",            "Transport endpoint is already connected",          SEV_CRITICAL},
+    /* 107 */ {"ENOTCONN",           "Transport endpoint is not connected",              SEV_EMERGENCY},
+    /* 108 */ {"ESHUTDOWN",          "Cannot send after transport endpoint shutdown",    SEV_ALERT},
+    /* 109 */ {"ETOOMANYREFS",       "Too many references: cannot splice",               SEV_UNKNOWN},
+    /* 110 */ {"ETIMEDOUT",          "Connection timed out",                             SEV_ERROR},
+    /* 111 */ {"ECONNREFUSED",       "Connection refused",                               SEV_CRITICAL},
+    /* 112 */ {"EHOSTDOWN",          "Host is down",                                     SEV_CRITICAL},
+    /* 113 */ {"EHOSTUNREACH",       "No route to host",                                 SEV_CRITICAL},
+    /* 114 */ {"EALREADY",           "Operation already in progress",                    SEV_CRITICAL},
+    /* 115 */ {"EINPROGRESS",        "Operation now in progress",                        SEV_ERROR},
+    /* 116 */ {"ESTALE",             "Stale file handle",                                SEV_ALERT},
+    /* 117 */ {"EUCLEAN",            "Structure needs cleaning",                         SEV_ALERT},
+    /* 118 */ {"ENOTNAM",            "Not a XENIX named type file",                      SEV_UNKNOWN},
+    /* 119 */ {"ENAVAIL",            "No XENIX semaphores available",                    SEV_UNKNOWN},
+    /* 120 */ {"EISNAM",             "Is a named type file",                             SEV_EMERGENCY},
+    /* 121 */ {"EREMOTEIO",          "Remote I/O error",                                 SEV_EMERGENCY},
+    /* 122 */ {"EDQUOT",             "Disk quota exceeded",                              SEV_EMERGENCY},
+    /* 123 */ {"ENOMEDIUM",          "No medium found",                                  SEV_CRITICAL},
+    /* 124 */ {"EMEDIUMTYPE",        "Wrong medium type",                                SEV_ALERT},
+    /* 125 */ {"ECANCELED",          "Operation canceled",                               SEV_ERROR},
+    /* 126 */ {"ENOKEY",             "Required key not available",                       SEV_EMERGENCY},
+    /* 127 */ {"EKEYEXPIRED",        "Key has expired",                                  SEV_EMERGENCY},
+    /* 128 */ {"EKEYREVOKED",        "Key has been revoked",                             SEV_EMERGENCY},
+    /* 129 */ {"EKEYREJECTED",       "Key was rejected by service",                      SEV_EMERGENCY},
+    /* 130 */ {"EOWNERDEAD",         "Owner died",                                       SEV_UNKNOWN},
+    /* 131 */ {"ENOTRECOVERABLE",    "State not recoverable",                            SEV_UNKNOWN},
+    /* 132 */ {"ERFKILL",            "Operation not possible due to RF-kill",            SEV_UNKNOWN},
+    /* 133 */ {"EHWPOISON",          "Memory page has hardware error",                   SEV_UNKNOWN}
+};
@@ -0,0 +1,7 @@
+typedef enum kv_log_keys {
+    K_desired_file = 32 + 1,
+    K_desired_filename,
+    K_err_another,
+    K_err_brief,
+    Key,
+} kv_log_keys;
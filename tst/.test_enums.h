@@ -0,0 +1,93 @@
+
+#ifndef NULL
+#define NULL ((void *)0)
+#endif
+
+#ifndef _KV_LOG_KEYS_STR_MAP
+#define _KV_LOG_KEYS_STR_MAP
+static inline __attribute__((__always_inline__,__pure__,__unused__)) const char * $kv_log_keys(int val)
+{
+    switch(val) {
+        case 33: return "desired_file";
+        case 34: return "desired_filename";
+        case 35: return "err_another";
+        case 36: return "err_brief";
+        case 37: return "Key";
+        default: return NULL;
+    }
+}
+#endif
+
+#ifndef _GX_LOG_STANDARD_KEYS_STR_MAP
+#define _GX_LOG_STANDARD_KEYS_STR_MAP
+static inline __attribute__((__always_inline__,__pure__,__unused__)) const char * $gx_log_standard_keys(int val)
+{
+    switch(val) {
+        case 0: return "K_type";
+        case 1: return "K_severity";
+        case 2: return "K_name";
+        case 3: return "K_msg";
+        case 4: return "K_report";
+        case 5: return "K_result";
+        case 6: return "K_src_file";
+        case 7: return "K_src_line";
+        case 8: return "K_src_function";
+        case 9: return "K_src_expression";
+        case 10: return "K_err_severity";
+        case 11: return "K_err_family";
+        case 12: return "K_err_number";
+        case 13: return "K_err_label";
+        case 14: return "K_err_msg";
+        case 15: return "K_err_depth";
+        case 16: return "K_err_group";
+        case 17: return "K_err_stack";
+        case 18: return "K_sys_time";
+        case 19: return "K_sys_ticks";
+        case 20: return "K_sys_program";
+        case 21: return "K_sys_version";
+        case 22: return "K_sys_cpuid";
+        case 23: return "K_sys_pid";
+        case 24: return "K_sys_ppid";
+        case 25: return "K_sys_tid";
+        case 26: return "K_net_host";
+        case 27: return "K_net_bound_ip";
+        case 28: return "K_net_bound_port";
+        case 29: return "K_net_peer_ip";
+        case 30: return "K_net_peer_port";
+        case 31: return "K_net_peer_state";
+        default: return NULL;
+    }
+}
+#endif
+
+#ifndef _GX_SEVERITY_STR_MAP
+#define _GX_SEVERITY_STR_MAP
+static inline __attribute__((__always_inline__,__pure__,__unused__)) const char * $gx_severity(int val)
+{
+    switch(val) {
+        case 0: return "SEV_EMERGENCY";
+        case 1: return "SEV_ALERT";
+        case 2: return "SEV_CRITICAL";
+        case 3: return "SEV_ERROR";
+        case 4: return "SEV_UNKNOWN";
+        case 5: return "SEV_WARNING";
+        case 6: return "SEV_NOTICE";
+        case 7: return "SEV_STAT";
+        case 8: return "SEV_INFO";
+        case 9: return "SEV_DEBUG";
+        default: return NULL;
+    }
+}
+#endif
+
+#ifndef _GX_ERROR_FAMILY_STR_MAP
+#define _GX_ERROR_FAMILY_STR_MAP
+static inline __attribute__((__always_inline__,__pure__,__unused__)) const char * $gx_error_family(int val)
+{
+    switch(val) {
+        case 0: return "ERRF_SYSERR";
+        default: return NULL;
+    }
+}
+#endif
+
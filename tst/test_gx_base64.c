@@ -0,0 +1,134 @@
+// gx_base64: both alphabets agree with a plain reference at every length on
+// every kernel (scalar, SSSE3, AVX2), RFC 4648 vectors, padding, rejection
+// of every non-alphabet byte at every position and of non-canonical tails,
+// no writes past the exact output size- and throughput per kernel.
+#include "../gx.h"
+#include "../gx_base64.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+#include <ctype.h>
+
+#define MAXLEN 300
+#define CANARY 0xa5
+
+static size_t ref_encode(const char *alpha, const uint8_t *in, size_t n, char *out, int pad) {
+    size_t i, o = 0;
+    for(i = 0; i < n; i += 3) {
+        uint32_t v = in[i] << 16 | (i + 1 < n ? in[i + 1] << 8 : 0) | (i + 2 < n ? in[i + 2] : 0);
+        size_t   c = n - i >= 3 ? 4 : n - i + 1, j;
+        for(j = 0; j < 4; j++) if(j < c) out[o++] = alpha[(v >> (18 - 6 * j)) & 63]; else if(pad) out[o++] = '=';
+    }
+    out[o] = '\0';
+    return o + 1;
+}
+
+static int in_alphabet(int c) { return isalnum(c) || c == '-' || c == '_'; }
+
+static void check_level(int level) {
+    static const gx_b64_alphabet *alphas[] = {&gx_b64_sortable, &gx_b64_url};
+    uint8_t  in[MAXLEN], back[MAXLEN + 16];
+    char     enc[GX_BASE64_PADDED_SIZE(MAXLEN) + 16], ref[GX_BASE64_PADDED_SIZE(MAXLEN)], bad[GX_BASE64_PADDED_SIZE(MAXLEN)];
+    size_t   n, i, a, len;
+    int      pad, c;
+    ssize_t  r;
+
+    _gx_b64_level = level;
+    for(a = 0; a < 2; a++) for(n = 0; n <= MAXLEN; n++) for(pad = 0; pad < 2; pad++) {
+        const gx_b64_alphabet *al = alphas[a];
+        for(i = 0; i < n; i++) in[i] = random();
+        len = ref_encode(al->enc, in, n, ref, pad);
+        memset(enc, CANARY, sizeof(enc));
+        assert(gx_base64_encode(al, in, n, enc, pad) == (ssize_t)len);
+        assert(len == (pad ? GX_BASE64_PADDED_SIZE(n) : GX_BASE64_SIZE(n)));
+        assert(!strcmp(enc, ref) && (uint8_t)enc[len] == CANARY);
+        len--;
+
+        memset(back, CANARY, sizeof(back));
+        assert(gx_base64_decode(al, enc, len, back) == (ssize_t)n && !memcmp(back, in, n) && back[n] == CANARY);
+        assert(n <= GX_BASE64_DECODED_MAX(len));
+
+        // Every byte that isn't in the alphabet, at a few positions (vector
+        // blocks and tail), is rejected; every one that is, decodes.
+        if(n % 37 == 5 || n == MAXLEN) for(i = 0; i < len; i += 1 + len / 7) {
+            if(enc[i] == '=') continue;
+            for(c = 0; c < 256; c++) {
+                memcpy(bad, enc, len);
+                bad[i] = c;
+                r = gx_base64_decode(al, bad, len, back);
+                if(!in_alphabet(c)) assert(r == -1 && errno == EINVAL);
+                else if(i < len - 2) assert(r == (ssize_t)n);
+            }
+        }
+        // Stray low bits in the last char of a partial quad
+        if(!pad && n % 3) {
+            memcpy(bad, enc, len + 1);
+            bad[len - 1] = al->enc[_gx_b64_dec1(al, bad[len - 1]) | 1];
+            assert(gx_base64_decode(al, bad, len, back) == -1);
+        }
+    }
+}
+
+/// n must be a multiple of 3 (for _m3, the old encoder)
+static void bench(const char *what, size_t n) {
+    static uint8_t in[1 << 16], back[1 << 16];
+    static char    enc[GX_BASE64_SIZE(1 << 16)];
+    size_t         reps = (64 << 20) / n, j, len = 0;
+    uint64_t       t0;
+    double         e[3], d[3], m3;
+    int            l;
+    for(j = 0; j < n; j++) in[j] = random();
+    for(l = 0; l < 3; l++) {
+        _gx_b64_level = l;
+        t0 = gx_time_mono_ns();
+        for(j = 0; j < reps; j++) { in[0] = j; len = gx_base64_encode(&gx_b64_url, in, n, enc, 0) - 1; }
+        e[l] = (double)(gx_time_mono_ns() - t0) / reps;
+        t0 = gx_time_mono_ns();
+        for(j = 0; j < reps; j++) if(gx_base64_decode(&gx_b64_url, enc, len, back) != (ssize_t)n) abort();
+        d[l] = (double)(gx_time_mono_ns() - t0) / reps;
+    }
+    t0 = gx_time_mono_ns();
+    for(j = 0; j < reps; j++) { in[0] = j; gx_base64_urlencode_m3(in, n, enc); }
+    m3 = (double)(gx_time_mono_ns() - t0) / reps;
+    printf("  %-6s %6zuB  encode ns: scalar %7.1f ssse3 %7.1f avx2 %7.1f (%5.2f GB/s)  _m3 %7.1f\n"
+           "                  decode ns: scalar %7.1f ssse3 %7.1f avx2 %7.1f (%5.2f GB/s)\n",
+           what, n, e[0], e[1], e[2], n / e[2], m3, d[0], d[1], d[2], n / d[2]);
+}
+
+int main(int argc, char **argv) {
+    static const char *rfc[][2] = {{"", ""}, {"f", "Zg=="}, {"fo", "Zm8="}, {"foo", "Zm9v"},
+                                   {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"}};
+    uint8_t  bin[64], back[64];
+    char     enc[GX_BASE64_PADDED_SIZE(64)], m3[GX_BASE64_SIZE(63)];
+    size_t   i;
+    int      lvl, hw;
+
+    srandom(11);
+    hw = _gx_b64_cpu();
+    for(lvl = 0; lvl <= hw; lvl++) check_level(lvl);
+    _gx_b64_level = hw;
+
+    for(i = 0; i < sizeof(rfc) / sizeof(rfc[0]); i++) {
+        size_t n = strlen(rfc[i][0]), chars = strlen(rfc[i][1]);
+        assert(gx_base64_encode(&gx_b64_url, rfc[i][0], n, enc, 1) == (ssize_t)chars + 1 && !strcmp(enc, rfc[i][1]));
+        assert(gx_base64_decode(&gx_b64_url, rfc[i][1], chars, back) == (ssize_t)n && !memcmp(back, rfc[i][0], n));
+        while(chars && rfc[i][1][chars - 1] == '=') chars--;                  // Unpadded decodes the same
+        assert(gx_base64_decode(&gx_b64_url, rfc[i][1], chars, back) == (ssize_t)n);
+    }
+    // Padding only where it belongs, and only as much as belongs there
+    assert(gx_base64_decode(&gx_b64_url, "Zg=", 3, back) == -1);
+    assert(gx_base64_decode(&gx_b64_url, "Zm9v====", 8, back) == -1);
+    assert(gx_base64_decode(&gx_b64_url, "Z===", 4, back) == -1);
+    assert(gx_base64_decode(&gx_b64_url, "Zm=v", 4, back) == -1);
+    assert(gx_base64_decode(&gx_b64_url, "Zm9vY", 5, back) == -1);
+
+    // Sortable alphabet is exactly what _m3 (and so the logger) produces
+    for(i = 0; i < sizeof(bin); i++) bin[i] = random();
+    gx_base64_urlencode_m3(bin, 63, m3);
+    assert(gx_base64_urlencode(bin, 63, enc) == GX_BASE64_SIZE(63) && !strcmp(enc, m3));
+    printf("base64 ok (scalar%s%s)\n", hw >= 1 ? ", ssse3" : "", hw >= 2 ? ", avx2" : "");
+
+    size_t sizes[] = {12, 45, 96, 1023, 65535};
+    for(i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) bench(i < 2 ? "token" : "", sizes[i]);
+    return 0;
+}
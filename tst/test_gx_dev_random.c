@@ -0,0 +1,98 @@
+// gx_dev_random: pooled and hardened draws are random-looking and never
+// repeat, a forked child doesn't replay its parent's pool, threads get their
+// own pools, big requests bypass the pool- and what a draw costs vs. a
+// getrandom syscall each time. Built with the RDRAND/RDSEED mixer on.
+#define GX_RANDOM_MIX_RDRAND 1
+#include "../gx.h"
+#include "../gx_token.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+#include <sys/wait.h>
+
+#define DRAWS   100000
+#define THREADS 8
+
+static int cmp64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static size_t dups(uint64_t *v, size_t n) {
+    size_t i, d = 0;
+    qsort(v, n, sizeof(*v), cmp64);
+    for(i = 1; i < n; i++) d += v[i] == v[i - 1];
+    return d;
+}
+
+static uint64_t thread_vals[THREADS][1000];
+static void *draw_thread(void *arg) {
+    uint64_t *out = (uint64_t *)arg;
+    int       i;
+    for(i = 0; i < 1000; i++) _ (gx_dev_random(&out[i], sizeof(out[i]), 0)) _abort();
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    static uint64_t v[DRAWS + 2 * 64];
+    uint8_t         big[4096], zero[4096] = {0}, odd[7];
+    size_t          i, ones = 0, n;
+    pthread_t       th[THREADS];
+    int             fds[2], status;
+    pid_t           pid;
+    uint64_t        t0;
+    double          pooled, raw;
+
+    // Argument checks
+    assert(gx_dev_random(NULL, 8, 0) == -1 && errno == EINVAL);
+    assert(gx_dev_random(big, 0, 1) == -1 && errno == EINVAL);
+
+    // Pooled + hardened: no repeats, ~half the bits set, odd sizes straddle refills
+    for(i = 0; i < DRAWS; i++) {
+        _ (gx_dev_random(&v[i], sizeof(v[i]), i % 1000 == 0)) _abort();
+        if(i % 3 == 0) _ (gx_dev_random(odd, sizeof(odd), 0)) _abort();
+        ones += __builtin_popcountll(v[i]);
+    }
+    assert(dups(v, DRAWS) == 0);
+    assert(ones > DRAWS * 32 - DRAWS / 2 && ones < DRAWS * 32 + DRAWS / 2);
+
+    // Big requests go around the pool (and aren't all zeros)
+    _ (gx_dev_random(big, sizeof(big), 0)) _abort();
+    assert(memcmp(big, zero, sizeof(big)));
+    _ (gx_dev_random(big, sizeof(big), 1)) _abort();
+    assert(memcmp(big, zero, sizeof(big)));
+
+    // A forked child must not hand out what's left in the parent's pool
+    _ (gx_dev_random(&v[0], sizeof(v[0]), 0)) _abort();        // Pool now partly used
+    _ (pipe(fds)) _abort();
+    _ (pid = fork()) _abort();
+    if(pid == 0) {
+        for(i = 0; i < 64; i++) _ (gx_dev_random(&v[i], sizeof(v[i]), 0)) _exit(1);
+        if(write(fds[1], v, 64 * sizeof(v[0])) != 64 * sizeof(v[0])) _exit(1);
+        _exit(0);
+    }
+    for(i = 0; i < 64; i++) _ (gx_dev_random(&v[64 + i], sizeof(v[0]), 0)) _abort();
+    for(n = 0; n < 64 * sizeof(v[0]); n += i) _ (i = read(fds[0], (char *)v + n, 64 * sizeof(v[0]) - n)) _abort();
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(dups(v, 128) == 0);
+
+    // Threads: separate pools, nothing shared
+    for(i = 0; i < THREADS; i++) pthread_create(&th[i], NULL, draw_thread, thread_vals[i]);
+    for(i = 0; i < THREADS; i++) pthread_join(th[i], NULL);
+    assert(dups(&thread_vals[0][0], THREADS * 1000) == 0);
+    printf("gx_dev_random ok\n");
+
+    // Cost of an 8-byte draw: the pool vs. a syscall per call
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < DRAWS; i++) gx_dev_random(&v[i], 8, 0);
+    pooled = (double)(gx_time_mono_ns() - t0) / DRAWS;
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < DRAWS; i++) if(getrandom(&v[i], 8, 0) != 8) abort();
+    raw = (double)(gx_time_mono_ns() - t0) / DRAWS;
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < DRAWS / 10; i++) gx_dev_random(&v[i], 32, 1);
+    printf("  8B draw: pooled %.0fns, getrandom each time %.0fns; 32B hardened draw (+RDSEED) %.0fns\n",
+           pooled, raw, (double)(gx_time_mono_ns() - t0) / (DRAWS / 10));
+    return 0;
+}
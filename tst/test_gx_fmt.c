@@ -0,0 +1,142 @@
+// gx_fmt.h: integers / hex / pointers byte-for-byte what snprintf gives,
+// doubles read back exactly and are never longer than the shortest %.Ng
+// that does, a few spelled-out layouts, $f/$p in the $() arena- and what
+// each costs next to snprintf.
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#define ROUNDS  1000000
+#define DOUBLES 100000                          ///< Each checked against %.1g-%.17g
+
+static volatile uint64_t sink;
+
+static uint64_t rnd64(void) { return (uint64_t)random() << 42 ^ (uint64_t)random() << 21 ^ random(); }
+
+static char *fmt_u(char *out, uint64_t v) { out[gx_fmt_u64(out, v)] = '\0'; return out; }
+static char *fmt_d(char *out, int64_t v)  { out[gx_fmt_i64(out, v)] = '\0'; return out; }
+static char *fmt_x(char *out, uint64_t v) { out[gx_fmt_hex(out, v)] = '\0'; return out; }
+static char *fmt_f(char *out, double v)   { out[gx_fmt_double(out, v)] = '\0'; return out; }
+
+/// Significant digits in a decimal string (any layout).
+static int sig_digits(const char *s) {
+    int n = 0, z = 0, started = 0;
+    for(; *s && *s != 'e'; s++) {
+        if(*s < '0' || *s > '9') continue;
+        if(*s == '0' && !started) continue;
+        started = 1;
+        if(*s == '0') z++;
+        else { n += z + 1; z = 0; }
+    }
+    return n ? n : 1;
+}
+
+static void check_double(double v) {
+    char got[GX_FMT_MAX], want[64];
+    int  p;
+    fmt_f(got, v);
+    assert(strlen(got) < GX_FMT_MAX);
+    if(isnan(v)) { snprintf(want, sizeof(want), "%f", v); assert(!strcmp(got, want)); return; }
+    if(strtod(got, NULL) != v || signbit(strtod(got, NULL)) != signbit(v)) {
+        fprintf(stderr, "%a -> %s doesn't read back\n", v, got);
+        abort();
+    }
+    for(p = 1; p < 17; p++) { snprintf(want, sizeof(want), "%.*g", p, v); if(strtod(want, NULL) == v) break; }
+    if(sig_digits(got) > p) {
+        fprintf(stderr, "%a -> %s, but %%.%dg already reads back\n", v, got, p);
+        abort();
+    }
+}
+
+int main(int argc, char **argv) {
+    static double dv[ROUNDS];
+    static uint64_t uv[ROUNDS];
+    char          got[GX_FMT_MAX], want[64];
+    uint64_t      t0, sum = 0, bits;
+    size_t        i, j;
+    double        edge[] = {0.0, -0.0, 1.0, -1.0, 0.1, 0.2, 0.3, 1.0 / 3, 2.0 / 3, 1e21, 1e-7, 123456.789,
+                            9007199254740992.0, 9007199254740993.0, 5e-324, -5e-324, DBL_MIN, DBL_MAX, -DBL_MAX,
+                            DBL_MIN / 2, DBL_EPSILON, 1e22, 1e23, 299792458.0, 6.02214076e23, M_PI, M_E};
+    static const struct { double v; const char *s; } spelled[] = {
+        {0.0, "0"}, {-0.0, "-0"}, {1.0, "1"}, {-1.5, "-1.5"}, {0.1, "0.1"}, {100.0, "100"},
+        {1e20, "100000000000000000000"}, {1e21, "1e+21"}, {123e18, "123000000000000000000"},
+        {0.000001, "0.000001"}, {0.0000012, "0.0000012"}, {1e-7, "1e-7"}, {1.25e-7, "1.25e-7"},
+        {5e-324, "5e-324"}, {DBL_MAX, "1.7976931348623157e+308"}, {DBL_MIN, "2.2250738585072014e-308"},
+        {0.1 + 0.2, "0.30000000000000004"}, {1.0 / 3, "0.3333333333333333"}, {123456.789, "123456.789"},
+        {INFINITY, "inf"}, {-INFINITY, "-inf"}};
+
+    srandom(50);
+
+    // Integers, hex and pointers == snprintf at every digit count and boundary
+    for(i = 0; i < 64; i++) {
+        uint64_t b = 1ULL << i, vs[] = {b - 1, b, b + 1, b * 10 / 10, i < 20 ? _gx_fmt_pow10[i] - 1 : b, i < 20 ? _gx_fmt_pow10[i] : b};
+        for(j = 0; j < sizeof(vs) / sizeof(vs[0]); j++) {
+            snprintf(want, sizeof(want), "%" PRIu64, vs[j]);          assert(!strcmp(fmt_u(got, vs[j]), want));
+            assert(gx_fmt_u64_len(vs[j]) == (int)strlen(want));
+            snprintf(want, sizeof(want), "%" PRId64, (int64_t)vs[j]); assert(!strcmp(fmt_d(got, (int64_t)vs[j]), want));
+            snprintf(want, sizeof(want), "%" PRId64, (int64_t)(0 - vs[j])); assert(!strcmp(fmt_d(got, (int64_t)(0 - vs[j])), want));
+            snprintf(want, sizeof(want), "%" PRIx64, vs[j]);          assert(!strcmp(fmt_x(got, vs[j]), want));
+        }
+    }
+    snprintf(want, sizeof(want), "%" PRId64, INT64_MIN); assert(!strcmp(fmt_d(got, INT64_MIN), want));
+    snprintf(want, sizeof(want), "%" PRIu64, UINT64_MAX); assert(!strcmp(fmt_u(got, UINT64_MAX), want));
+    for(i = 0; i < ROUNDS; i++) {
+        uint64_t v = rnd64() >> (i % 64);
+        void    *ptr = (void *)(uintptr_t)v;
+        snprintf(want, sizeof(want), "%" PRIu64, v); assert(!strcmp(fmt_u(got, v), want));
+        snprintf(want, sizeof(want), "%" PRIx64, v); assert(!strcmp(fmt_x(got, v), want));
+        snprintf(want, sizeof(want), "%p", ptr);      got[gx_fmt_ptr(got, ptr)] = '\0'; assert(!strcmp(got, want));
+    }
+    snprintf(want, sizeof(want), "%p", NULL); got[gx_fmt_ptr(got, NULL)] = '\0'; assert(!strcmp(got, want));
+
+    // Doubles: layouts, edge values, every power of 2 and 10, random bit patterns
+    for(i = 0; i < sizeof(spelled) / sizeof(spelled[0]); i++) {
+        if(strcmp(fmt_f(got, spelled[i].v), spelled[i].s)) {
+            fprintf(stderr, "%a -> %s, not %s\n", spelled[i].v, got, spelled[i].s);
+            abort();
+        }
+    }
+    for(i = 0; i < sizeof(edge) / sizeof(edge[0]); i++) check_double(edge[i]);
+    check_double(NAN); check_double(-NAN);
+    for(i = 0; i < 2100; i++) { check_double(ldexp(1.0, (int)i - 1074)); check_double(nextafter(ldexp(1.0, (int)i - 1074), 0)); }
+    for(i = 0; i < 617; i++) { snprintf(want, sizeof(want), "1e%d", (int)i - 308); check_double(strtod(want, NULL)); }
+    for(i = 0; i < DOUBLES; i++) {
+        bits = rnd64();
+        memcpy(&dv[i], &bits, sizeof(bits));
+        if(isnan(dv[i])) dv[i] = (double)bits;
+        check_double(dv[i]);
+        check_double((double)(int64_t)bits / 1000);             // Log-ish values- short decimals
+        check_double((double)(bits % 100000) / 100);
+    }
+
+    // In the arena, like the logger's values
+    $reset();
+    assert(!strcmp($f(0.25), "0.25") && !strcmp($f(-3), "-3") && !strcmp($f(1.5f), "1.5"));
+    snprintf(want, sizeof(want), "%p", (void *)&sum); assert(!strcmp($p(&sum), want));
+    assert(!strcmp($p(NULL), "(nil)"));
+    printf("gx_fmt ok\n");
+
+    // Cost per value vs. snprintf into a stack buffer
+    for(i = 0; i < ROUNDS; i++) { uv[i] = rnd64() >> (i % 64); dv[i] = (double)(uv[i] % 10000000) / 1000; }
+#define BENCH(LABEL, SNPRINTF, FAST) do {                                                       \
+        double slow, fast;                                                                        \
+        t0 = gx_time_mono_ns();                                                                   \
+        for(i = 0; i < ROUNDS; i++) sum += SNPRINTF;                                              \
+        slow = (double)(gx_time_mono_ns() - t0) / ROUNDS;                                         \
+        t0 = gx_time_mono_ns();                                                                   \
+        for(i = 0; i < ROUNDS; i++) sum += FAST;                                                  \
+        fast = (double)(gx_time_mono_ns() - t0) / ROUNDS;                                         \
+        printf("  %-22s snprintf %6.1fns   gx_fmt %5.1fns\n", LABEL, slow, fast);                \
+    } while(0)
+    BENCH("u64 (mixed widths)", snprintf(got, sizeof(got), "%" PRIu64, uv[i]), gx_fmt_u64(got, uv[i]));
+    BENCH("u32 (src_line-sized)", snprintf(got, sizeof(got), "%u", (unsigned)(uv[i] & 0xfff)), gx_fmt_u64(got, uv[i] & 0xfff));
+    BENCH("hex", snprintf(got, sizeof(got), "%" PRIx64, uv[i]), gx_fmt_hex(got, uv[i]));
+    BENCH("pointer", snprintf(got, sizeof(got), "%p", (void *)(uintptr_t)uv[i]), gx_fmt_ptr(got, (void *)(uintptr_t)uv[i]));
+    BENCH("double %.17g", snprintf(got, sizeof(got), "%.17g", dv[i]), gx_fmt_double(got, dv[i]));
+    BENCH("double %g (lossy)", snprintf(got, sizeof(got), "%g", dv[i]), gx_fmt_double(got, dv[i]));
+    sink = sum;
+    return 0;
+}
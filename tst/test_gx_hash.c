@@ -0,0 +1,210 @@
+// gx_hash64: the C version gives exactly what the original x86-64 asm did,
+// streaming and batch agree with one-shot, a few SMHasher-style quality
+// checks (avalanche, sparse/sequential keys, bucket spread, seeds), and
+// throughput.
+#include "../gx.h"
+#include "../gx_hash.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+#include <math.h>
+
+#define SEQ   2000000
+
+// The original asm (was gx_token.h), kept as the reference for the output.
+static uint64_t ref_hash64(const char *key, uint64_t len, uint64_t seed) {
+    const uint64_t m = 0x95b47aa3355ba1a1, n = 0x8a970be7488fda55;
+    uint64_t hash;
+    asm(
+        "leaq (%%rcx,%4), %%r13\n"
+        "movq %%rdx, %%r14\n"
+        "movq %%rcx, %%r15\n"
+        "movq %%rcx, %%r12\n"
+        "addq %%rax, %%r13\n"
+        "andq $0xfffffffffffffff0, %%rcx\n"
+        "jz QW%=\n"
+        "addq %%rcx, %%r14\n\n"
+        "negq %%rcx\n"
+    "XW%=:\n"
+        "movq %4, %%rax\n"
+        "mulq (%%r14,%%rcx)\n"
+        "xorq %%rax, %%r12\n"
+        "xorq %%rdx, %%r13\n"
+        "movq %3, %%rax\n"
+        "mulq 8(%%r14,%%rcx)\n"
+        "xorq %%rdx, %%r12\n"
+        "xorq %%rax, %%r13\n"
+        "addq $16, %%rcx\n"
+        "jnz XW%=\n"
+    "QW%=:\n"
+        "movq %%r15, %%rcx\n"
+        "andq $8, %%r15\n"
+        "jz B%=\n"
+        "movq %4, %%rax\n"
+        "mulq (%%r14)\n"
+        "addq $8, %%r14\n"
+        "xorq %%rax, %%r12\n"
+        "xorq %%rdx, %%r13\n"
+    "B%=:\n"
+        "andq $7, %%rcx\n"
+        "jz F%=\n"
+        "movq $1, %%rdx\n"
+        "shlq $3, %%rcx\n"
+        "movq %3, %%rax\n"
+        "shlq %%cl, %%rdx\n"
+        "addq $-1, %%rdx\n"
+        "andq (%%r14), %%rdx\n"
+        "mulq %%rdx\n"
+        "xorq %%rdx, %%r12\n"
+        "xorq %%rax, %%r13\n"
+    "F%=:\n"
+        "leaq (%%r13,%4), %%rax\n"
+        "xorq %%r12, %%rax\n"
+        "mulq %4\n"
+        "xorq %%rdx, %%rax\n"
+        "xorq %%r12, %%rax\n"
+        "xorq %%r13, %%rax\n"
+        : "=a"(hash), "=c"(key), "=d"(key)
+        : "r"(m), "r"(n), "a"(seed), "c"(len), "d"(key)
+        : "%r12", "%r13", "%r14", "%r15", "cc");
+    return hash;
+}
+
+static uint64_t rnd64() { return (uint64_t)random() << 62 ^ (uint64_t)random() << 31 ^ random(); }
+
+static int cmp64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static size_t dups(uint64_t *v, size_t n, uint64_t mask) {
+    size_t i, d = 0;
+    for(i = 0; i < n; i++) v[i] &= mask;
+    qsort(v, n, sizeof(*v), cmp64);
+    for(i = 1; i < n; i++) d += v[i] == v[i - 1];
+    return d;
+}
+
+/// Worst deviation from 50% of any (input bit -> output bit) flip rate.
+static double avalanche(size_t len, int trials) {
+    static uint32_t flips[1024][64];
+    uint8_t         key[128];
+    uint64_t        h0, d;
+    size_t          ib, ob;
+    double          worst = 0, b;
+    int             t;
+    memset(flips, 0, sizeof(flips));
+    for(t = 0; t < trials; t++) {
+        for(ib = 0; ib < len; ib++) key[ib] = random();
+        h0 = gx_hash64(key, len, 0);
+        for(ib = 0; ib < len * 8; ib++) {
+            key[ib / 8] ^= 1 << (ib % 8);
+            d = gx_hash64(key, len, 0) ^ h0;
+            key[ib / 8] ^= 1 << (ib % 8);
+            for(ob = 0; ob < 64; ob++) flips[ib][ob] += (d >> ob) & 1;
+        }
+    }
+    for(ib = 0; ib < len * 8; ib++) for(ob = 0; ob < 64; ob++) {
+        b = fabs((double)flips[ib][ob] / trials - 0.5);
+        if(b > worst) worst = b;
+    }
+    return worst;
+}
+
+int main(int argc, char **argv) {
+    static uint8_t   buf[1 << 20];
+    static uint64_t  hv[SEQ];
+    const void      *keys[4096];
+    size_t           lens[4096], i, j, len, d;
+    uint64_t         seed, out[4096], t0, sum = 0, counts[1 << 12] = {0};
+    gx_hash64_state  st;
+    double           chi = 0, worst;
+
+    // Identical to the asm: every length 0-300 at random offsets, random seeds
+    srandom(7);
+    for(i = 0; i < sizeof(buf); i++) buf[i] = random();
+    for(len = 0; len <= 300; len++)
+        for(j = 0; j < 200; j++) {
+            const uint8_t *p = buf + random() % (sizeof(buf) - 512);
+            seed = j ? rnd64() : 0;
+            assert(gx_hash64(p, len, seed) == ref_hash64((const char *)p, len, seed));
+        }
+
+    // Streaming in random-sized pieces == one-shot
+    for(j = 0; j < 2000; j++) {
+        size_t total = random() % 2000, off = 0, piece;
+        seed = rnd64();
+        gx_hash64_init(&st, seed);
+        while(off < total) {
+            piece = min((size_t)(random() % 40), total - off);
+            gx_hash64_update(&st, buf + off, piece);
+            off += piece;
+        }
+        assert(gx_hash64_final(&st) == gx_hash64(buf, total, seed));
+    }
+
+    // Batch == one-shot, for a mix of short and long keys
+    for(i = 0; i < 4096; i++) {
+        keys[i] = buf + random() % (sizeof(buf) - 64);
+        lens[i] = i % 7 ? random() % 17 : random() % 60;
+    }
+    gx_hash64_n(keys, lens, 4096, 42, out);
+    for(i = 0; i < 4096; i++) assert(out[i] == gx_hash64(keys[i], lens[i], 42));
+
+    // Quality: avalanche, sequential + sparse keys, bucket spread, seeds
+    worst = 0;
+    size_t alens[] = {3, 8, 13, 16, 32, 64};
+    for(i = 0; i < sizeof(alens) / sizeof(alens[0]); i++) worst = max(worst, avalanche(alens[i], 20000));
+    assert(worst < 0.02);
+    for(i = 0; i < SEQ; i++) hv[i] = gx_hash64(&i, sizeof(i), 0);
+    assert(dups(hv, SEQ, ~0ULL) == 0);
+    for(i = 0; i < SEQ; i++) hv[i] = gx_hash64(&i, sizeof(i), 0);
+    d = dups(hv, SEQ, 0xffffffffULL);                 // Expect ~n^2/2^33 = 465
+    assert(d > 465 / 3 && d < 465 * 3);
+    for(i = 0, j = 0; i < 128; i++) {                  // Sparse: 3 bits set in 128
+        size_t b2, b3;
+        for(b2 = i + 1; b2 < 128; b2++) for(b3 = b2 + 1; b3 < 128; b3++) {
+            uint8_t k[16] = {0};
+            k[i / 8] |= 1 << (i % 8); k[b2 / 8] |= 1 << (b2 % 8); k[b3 / 8] |= 1 << (b3 % 8);
+            hv[j++] = gx_hash64(k, sizeof(k), 0);
+        }
+    }
+    assert(dups(hv, j, ~0ULL) == 0);
+    for(i = 0; i < SEQ; i++) counts[gx_hash64(buf + i % 4096, 5 + i % 11, i / 4096) & 0xfff]++;
+    for(i = 0; i < 4096; i++) chi += pow(counts[i] - SEQ / 4096.0, 2) / (SEQ / 4096.0);
+    assert(chi < 4096 + 6 * sqrt(2 * 4096));
+    for(i = 0; i < SEQ; i++) hv[i] = gx_hash64("same key", 8, i);
+    assert(dups(hv, SEQ, ~0ULL) == 0);
+    // Known CrapWow64 property (see gx_hash.h): whole 16-byte blocks commute
+    assert(gx_hash64(buf, 48, 0) != gx_hash64(buf + 1, 48, 0));
+    memcpy(buf + 2048, buf + 16, 16); memcpy(buf + 2064, buf, 16); memcpy(buf + 2080, buf + 32, 16);
+    assert(gx_hash64(buf, 48, 0) == gx_hash64(buf + 2048, 48, 0));
+    printf("gx_hash64 ok: worst avalanche bias %.4f, low-32 dups %zu (expect ~465), bucket chi2 %.0f (df 4095)\n",
+           worst, d, chi);
+
+    // Throughput
+    size_t blens[] = {8, 16, 64, 1024, sizeof(buf)};
+    for(i = 0; i < sizeof(blens) / sizeof(blens[0]); i++) {
+        size_t reps = (256 << 20) / blens[i] / (blens[i] < 64 ? 8 : 1);
+        double c, a;
+        t0 = gx_time_mono_ns();
+        for(j = 0; j < reps; j++) sum += gx_hash64(buf + (j & 255), blens[i], sum);
+        c = (double)(gx_time_mono_ns() - t0) / reps;
+        t0 = gx_time_mono_ns();
+        for(j = 0; j < reps; j++) sum += ref_hash64((const char *)buf + (j & 255), blens[i], sum);
+        a = (double)(gx_time_mono_ns() - t0) / reps;
+        printf("  %7zuB: C %8.1fns (%5.2f GB/s)  asm %8.1fns (%5.2f GB/s)\n", blens[i], c, blens[i] / c, a, blens[i] / a);
+    }
+    t0 = gx_time_mono_ns();
+    for(j = 0; j < 256; j++) { gx_hash64_init(&st, 0); gx_hash64_update(&st, buf, sizeof(buf)); sum += gx_hash64_final(&st); }
+    printf("  streaming 1MB: %.2f GB/s\n", 256.0 * sizeof(buf) / (gx_time_mono_ns() - t0));
+    for(i = 0; i < 4096; i++) { keys[i] = buf + i * 13; lens[i] = 4 + i % 13; }
+    t0 = gx_time_mono_ns();
+    for(j = 0; j < 1000; j++) for(i = 0; i < 4096; i++) out[i] = gx_hash64(keys[i], lens[i], j);
+    double loop = (double)(gx_time_mono_ns() - t0) / 4096000;
+    t0 = gx_time_mono_ns();
+    for(j = 0; j < 1000; j++) gx_hash64_n(keys, lens, 4096, j, out);
+    printf("  4-16B keys: %.2fns/key one at a time, %.2fns/key batched %s\n", loop,
+           (double)(gx_time_mono_ns() - t0) / 4096000, (unsigned)(sum + out[7]) ? "" : " ");
+    return 0;
+}
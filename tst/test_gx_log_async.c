@@ -0,0 +1,89 @@
+// Async logging: with BLOCK nothing may be lost, with DROP and a tiny ring
+// lines + dropped must account for everything that was logged.
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+#include "../gx_log_async.h"
+
+#include <assert.h>
+
+#define THREADS 4
+#define PER     5000
+
+static void *spam(void *arg) {
+    long t = (long)arg;
+    int  i;
+    for(i = 0; i < PER; i++) log_info("async T%ld n=%d", t, i);
+    return NULL;
+}
+
+static size_t run(int policy, ssize_t ring_size, uint64_t *dropped) {
+    char      path[] = "/tmp/gx-log-async-XXXXXX";
+    char      line[1024];
+    int       fd, saved;
+    long      t;
+    size_t    lines = 0;
+    pthread_t th[THREADS];
+
+    _ (fd = mkstemp(path)) _abort();
+    saved = dup(STDERR_FILENO);
+    dup2(fd, STDERR_FILENO);
+    _ (gx_log_async_start(policy, ring_size)) _abort();
+    for(t = 0; t < THREADS; t++) pthread_create(&th[t], NULL, spam, (void *)t);
+    for(t = 0; t < THREADS; t++) pthread_join(th[t], NULL);
+    gx_log_async_flush();
+    *dropped = gx_log_async_dropped();
+    _ (gx_log_async_stop()) _abort();
+    dup2(saved, STDERR_FILENO);
+
+    FILE *f = fopen(path, "r");
+    while(fgets(line, sizeof(line), f)) if(strstr(line, "async T")) lines++;
+    fclose(f);
+    unlink(path);
+    return lines;
+}
+
+/// One value bigger than 64KiB- has to come out whole, not cut to 16 bits.
+static size_t big(size_t len) {
+    char   path[] = "/tmp/gx-log-async-XXXXXX";
+    char  *val = malloc(len + 1), *out, *at;
+    int    fd, saved;
+    size_t got = 0;
+    struct stat st;
+
+    memset(val, 'x', len); val[len] = '\0';
+    _ (fd = mkstemp(path)) _abort();
+    saved = dup(STDERR_FILENO);
+    dup2(fd, STDERR_FILENO);
+    _ (gx_log_async_start(GX_LOG_ASYNC_BLOCK, 0)) _abort();
+    log_info("big %s", val);
+    gx_log_async_flush();
+    _ (gx_log_async_stop()) _abort();
+    dup2(saved, STDERR_FILENO);
+
+    fstat(fd, &st);
+    out = malloc(st.st_size + 1);
+    assert(pread(fd, out, st.st_size, 0) == st.st_size);
+    out[st.st_size] = '\0';
+    if((at = strstr(out, "big x"))) got = strspn(at + 4, "x");
+    close(fd);
+    unlink(path);
+    free(out);
+    free(val);
+    return got;
+}
+
+int main(int argc, char **argv) {
+    uint64_t dropped;
+    size_t   lines;
+
+    lines = run(GX_LOG_ASYNC_BLOCK, 0, &dropped);
+    printf("block: %zu lines, %" PRIu64 " dropped\n", lines, dropped);
+    assert(lines == THREADS * PER && dropped == 0);
+
+    lines = run(GX_LOG_ASYNC_DROP, 4096, &dropped);
+    printf("drop:  %zu lines, %" PRIu64 " dropped\n", lines, dropped);
+    assert(lines + dropped == THREADS * PER);
+    assert(big(100000) == 100000);
+    printf("async logging ok\n");
+    return 0;
+}
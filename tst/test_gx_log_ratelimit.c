@@ -0,0 +1,75 @@
+// A call site firing in a tight loop gets GX_LOG_RATE_BURST lines through,
+// then a summary of what was suppressed once its bucket refills- from
+// gx_log_rate_flush() if the site itself has gone quiet. Other call sites
+// are unaffected. Threads hammering one site share its bucket without it
+// ever wrapping around to unlimited.
+#define GX_LOG_RATE_BURST 20
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+
+#define THREADS 8
+#define PER_THR 50000
+
+static void flood(int n) { int i; for(i = 0; i < n; i++) log_error("flood %d", i); }
+static void *burst(void *unused) { int i; for(i = 0; i < PER_THR; i++) log_error("burst %d", i); return NULL; }
+
+int main(int argc, char **argv) {
+    char     path[] = "/tmp/gx-log-rate-XXXXXX";
+    char     line[1024], *m;
+    int      fd, saved, i;
+    unsigned floods = 0, others = 0, summaries = 0, suppressed = 0, n, late = 0;
+
+    _ (fd = mkstemp(path)) _abort();
+    saved = dup(STDERR_FILENO);
+    dup2(fd, STDERR_FILENO);
+
+    flood(100000);
+    for(i = 0; i < GX_LOG_RATE_BURST * 2; i++) log_info("other %d", i);  // Own bucket
+    assert(gx_log_rate_flush() == 0);                                     // Windows still open
+    gx_sleep(0,500);                                                      // ~5 tokens back
+    assert(gx_log_rate_flush() == 2);                                     // Both sites went quiet
+    flood(1);                                                             // Nothing left to report
+
+    dup2(saved, STDERR_FILENO);
+    FILE *f = fopen(path, "r");
+    while(fgets(line, sizeof(line), f)) {
+        if(!(m = strstr(line, "\e[0m"))) continue;
+        if(strstr(line, "flood "))                                       { floods ++; late += summaries == 2; }
+        else if(strstr(line, "other "))                                  others ++;
+        else if((m = strstr(line, "suppressed ")) && sscanf(m, "suppressed %u", &n) == 1) {
+            summaries ++;
+            suppressed += n;
+        }
+    }
+    fclose(f);
+    unlink(path);
+    setvbuf(stdout, NULL, _IONBF, 0);
+    printf("flood: %u lines, %u summary (%u suppressed), other: %u lines\n", floods, summaries, suppressed, others);
+    assert(floods == GX_LOG_RATE_BURST + 1);
+    assert(others >= GX_LOG_RATE_BURST && others < GX_LOG_RATE_BURST * 2);
+    assert(summaries == 2 && floods - 1 + others + suppressed == 100000 + GX_LOG_RATE_BURST * 2);
+    assert(late == 1);
+
+    // The same, from THREADS threads at once
+    pthread_t th[THREADS];
+    uint64_t  t0 = gx_time_mono_ns(), ms;
+    unsigned  bursts = 0;
+    strcpy(path, "/tmp/gx-log-rate-XXXXXX");
+    _ (fd = mkstemp(path)) _abort();
+    dup2(fd, STDERR_FILENO);
+    for(i = 0; i < THREADS; i++) pthread_create(&th[i], NULL, burst, NULL);
+    for(i = 0; i < THREADS; i++) pthread_join(th[i], NULL);
+    ms = (gx_time_mono_ns() - t0) / 1000000;
+    dup2(saved, STDERR_FILENO);
+    f = fopen(path, "r");
+    while(fgets(line, sizeof(line), f)) if(strstr(line, "\e[0m") && strstr(line, "burst ")) bursts ++;
+    fclose(f);
+    unlink(path);
+    printf("%d threads: %u of %u lines in %" PRIu64 "ms\n", THREADS, bursts, THREADS * PER_THR, ms);
+    assert(bursts >= GX_LOG_RATE_BURST);
+    assert(bursts <= GX_LOG_RATE_BURST + (ms + 1) * GX_LOG_RATE_PER_SEC / 1000 * THREADS + THREADS);
+    printf("rate limiting ok\n");
+    return 0;
+}
@@ -0,0 +1,43 @@
+// Filtered-out log calls must not evaluate their arguments- whether the level
+// is compiled out (GX_LOG_SEV_MAX) or no enabled logger wants it at runtime.
+#define GX_LOG_SEV_MAX SEV_INFO
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+
+static int evaluated = 0;
+static int bump() { return ++evaluated; }
+
+int main(int argc, char **argv) {
+    int    devnull, saved, i;
+    double t0, t1;
+
+    _ (devnull = open("/dev/null", O_WRONLY)) _abort();
+    saved = dup(STDERR_FILENO);
+    dup2(devnull, STDERR_FILENO);
+
+    gx_log_enable(0, SEV_DEBUG);
+    log_debug("compiled out %d", bump());                 assert(evaluated == 0);
+    log_info ("wanted %d", bump());                       assert(evaluated == 1);
+
+    gx_log_enable(0, SEV_WARNING);
+    assert(_gx_log_sevmask == _GX_SEVBITS(SEV_WARNING));
+    log_info ("runtime filtered %d", bump());             assert(evaluated == 1);
+    _info(K_msg, $("runtime filtered %d", bump()));       assert(evaluated == 1);
+    log_error("wanted %d", bump());                       assert(evaluated == 2);
+    _warning(K_msg, $("wanted %d", bump()));              assert(evaluated == 3);
+
+    gx_log_disable(0);
+    assert(_gx_log_sevmask == 0);
+    log_emergency("nobody listening %d", bump());         assert(evaluated == 3);
+
+    t0 = (double)_gx_log_bin_ns(CLOCK_MONOTONIC);
+    for(i = 0; i < 10000000; i++) log_notice("off %d", bump());
+    t1 = (double)_gx_log_bin_ns(CLOCK_MONOTONIC);
+    assert(evaluated == 3);
+
+    dup2(saved, STDERR_FILENO);
+    printf("severity filtering ok (%.2f ns per disabled call)\n", (t1 - t0) / 1e7);
+    return 0;
+}
@@ -0,0 +1,99 @@
+// syslog + message-queue sinks: records arrive intact, batching sends once
+// per GX_LOG_SYSLOG_BATCH (or once the async drainer finds the batch stale),
+// and a full queue drops (and counts) instead of blocking.
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+#include "../gx_log_async.h"
+
+#include <assert.h>
+#include <mqueue.h>
+
+#define MQ_NAME "/gx-log-sink-test"
+
+static void test_syslog() {
+    char               path[64], buf[2048];
+    struct sockaddr_un addr = {AF_UNIX, {0}};
+    int                srv, i, n;
+
+    snprintf(path, sizeof(path), "/tmp/gx-log-syslog-%d", getpid());
+    strcpy(addr.sun_path, path);
+    _ (srv = socket(AF_UNIX, SOCK_DGRAM, 0))                         _abort();
+    _ (bind(srv, (struct sockaddr *)&addr, sizeof(addr)))            _abort();
+    _ (gx_log_syslog_open(path))                                     _abort();
+    gx_log_enable(GX_LOGGER_SYSLOG, SEV_INFO);
+
+    for(i = 0; i < GX_LOG_SYSLOG_BATCH - 1; i++) log_info("batched %d", i);
+    assert(recv(srv, buf, sizeof(buf), MSG_DONTWAIT) == -1 && errno == EAGAIN);  // Still staged
+    log_info("batched %d", i);                                                   // Fills the batch
+    for(i = 0; i < GX_LOG_SYSLOG_BATCH; i++) {
+        _ (n = recv(srv, buf, sizeof(buf) - 1, MSG_DONTWAIT)) _abort();
+        buf[n] = '\0';
+        char *expect = $("<14>sinktest[%u]: batched %d", getpid(), i);
+        assert(!strncmp(buf, expect, strlen(expect)));
+    }
+    log_error("right away");                                                     // SEV_ERROR flushes
+    _ (n = recv(srv, buf, sizeof(buf) - 1, MSG_DONTWAIT)) _abort();
+    buf[n] = '\0';
+    assert(!strncmp(buf, "<11>sinktest[", 13) && strstr(buf, "]: right away"));
+
+    _ (gx_log_async_start(GX_LOG_ASYNC_BLOCK, 0))                    _abort();
+    log_info("lonely");                                                          // Nothing comes after it
+    gx_log_async_flush();
+    assert(recv(srv, buf, sizeof(buf), MSG_DONTWAIT) == -1 && errno == EAGAIN);  // Staged by the drainer
+    gx_sleep(0,400);                                                             // > FLUSH_MS + 2 drainer wakeups
+    _ (n = recv(srv, buf, sizeof(buf) - 1, MSG_DONTWAIT)) _abort();
+    buf[n] = '\0';
+    assert(strstr(buf, "]: lonely"));
+    _ (gx_log_async_stop())                                          _abort();
+
+    gx_log_syslog_close();
+    close(srv);
+    unlink(path);
+}
+
+static void test_mq() {
+    mqd_t        q;
+    char         buf[GX_MQUEUE_MSG_SIZE];
+    unsigned     prio;
+    ssize_t      n;
+    int          i, found;
+
+    mq_unlink(MQ_NAME);
+    _ (gx_log_mq_open(MQ_NAME))                                      _abort();
+    gx_log_enable(GX_LOGGER_MQ, SEV_DEBUG);
+    _ (q = mq_open(MQ_NAME, O_RDONLY | O_NONBLOCK))                  _abort();
+
+    for(i = 0; i < GX_MQUEUE_MSG_COUNT + 5; i++) log_info("queued %d", i);
+    assert(gx_log_mq_dropped() == 5);
+
+    for(i = 0; i < GX_MQUEUE_MSG_COUNT; i++) {
+        _ (n = mq_receive(q, buf, sizeof(buf), &prio)) _abort();
+        assert(prio == SEV_DEBUG - SEV_INFO);
+        assert(*(uint32_t *)buf == n);
+        // Walk the kv pairs up to the empty terminator
+        char *p = buf + sizeof(uint32_t), *key, *val;
+        found = 0;
+        for(;;) {
+            kv_head_t klen = *(kv_head_t *)p;  key = p + 2;  p += klen;
+            kv_head_t vlen = *(kv_head_t *)p;  val = p + 2;  p += vlen;
+            if(klen == 3 && vlen == 3) break;
+            if(!strcmp(key, "msg")) found = !strcmp(val, $("queued %d", i));
+        }
+        assert(found && p == buf + n);
+    }
+    assert(mq_receive(q, buf, sizeof(buf), &prio) == -1 && errno == EAGAIN);
+
+    gx_log_mq_close();
+    mq_close(q);
+    mq_unlink(MQ_NAME);
+}
+
+int main(int argc, char **argv) {
+    gx_log_set_program("sinktest");
+    gx_log_update_sysinfo();
+    gx_log_disable(0);
+    test_syslog();
+    test_mq();
+    printf("log sinks ok\n");
+    return 0;
+}
@@ -0,0 +1,56 @@
+// Several threads logging at once- every line must come out whole and
+// belong to exactly one (thread, seq) pair.
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+#include <pthread.h>
+
+#define THREADS 8
+#define PER     2000
+
+static void *spam(void *arg) {
+    long t = (long)arg;
+    int  i;
+    for(i = 0; i < PER; i++) {
+        char *chk = $("%ld-%d", t * 1000, i);  // Lives in this thread's $() buffer
+        log_info("T%ld n=%d check=%ld:%d:%s", t, i, t, i, chk);
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    char      path[] = "/tmp/gx-log-threads-XXXXXX";
+    int       fd, saved, seen[THREADS][PER] = {{0}};
+    pthread_t th[THREADS];
+    long      t;
+    char      line[1024];
+    size_t    lines = 0;
+
+    _ (fd = mkstemp(path)) _abort();
+    saved = dup(STDERR_FILENO);
+    dup2(fd, STDERR_FILENO);
+    for(t = 0; t < THREADS; t++) pthread_create(&th[t], NULL, spam, (void *)t);
+    for(t = 0; t < THREADS; t++) pthread_join(th[t], NULL);
+    dup2(saved, STDERR_FILENO);
+
+    FILE *f = fopen(path, "r");
+    while(fgets(line, sizeof(line), f)) {
+        long a, c, e; int b, d, g;
+        char *m = strstr(line, "\e[0mT");  // Right after the color reset
+        if(!m) { fprintf(stderr, "bad line: %s", line); return 1; }
+        if(sscanf(m, "\e[0mT%ld n=%d check=%ld:%d:%ld-%d", &a, &b, &c, &d, &e, &g) != 6) {
+            fprintf(stderr, "bad line: %s", line);
+            return 1;
+        }
+        assert(a == c && c * 1000 == e && b == d && d == g);
+        assert(a >= 0 && a < THREADS && b >= 0 && b < PER && !seen[a][b]);
+        seen[a][b] = 1;
+        lines++;
+    }
+    fclose(f);
+    unlink(path);
+    assert(lines == THREADS * PER);
+    printf("threaded logging ok (%zu lines)\n", lines);
+    return 0;
+}
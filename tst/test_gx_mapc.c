@@ -6,36 +6,64 @@ gx_error_initialize(GX_DEBUG);  // Should be able to remove later
 #include "../gx_mapc.h"
 #include "../gx_event.h"
 
+#define PATH "/dev/shm/test-gx-mapc.dat"
+#define MSGS 5
+
 gx_eventloop_declare  (mapc_events, 1, 1);
 gx_eventloop_implement(mapc_events, 1, 1);
 
-void writer() {
+char   msg[]   = "something blah blah";
+size_t got     = 0;
+int    is_done = 0;
+
+int writer() {
     int i;
     mapc *testm;
-    char msg[] = "something blah blah";
-
-    _N( testm = mapc_open("tmp/writer-file.dat", MAPC_WRITE | MAPC_VOLATILE) ) _eexit();
-    gx_sleep(1);
-    for(i=0; i < 5; i++) {
-        gx_sleep(0,500);
-        log_info("/CHILD/ writing some stuff");
-        mapc_write(testm, msg, sizeof(msg));
+
+    _N( testm = mapc_open(PATH, MAPC_WRITE | MAPC_VOLATILE) ) _abort();
+    gx_sleep(0,200);
+    for(i=0; i < MSGS; i++) {
+        gx_sleep(0,100);
+        log_info("/PARENT/ writing some stuff");
+        _ (mapc_write(testm, msg, sizeof(msg))) _abort();
+    }
+    gx_sleep(0,200);
+    return mapc_close(testm);
+}
+
+int on_mapc(gx_tcp_sess *sess, uint32_t evstates) {
+    mapc *m = (mapc *)sess->udata;
+    char  buf[sizeof(msg)];
+    _ (mapc_notified(m)) _raise(-1);
+    while(mapc_available(m) >= sizeof(msg)) {
+        mapc_read(m, buf, sizeof(buf));
+        if(memcmp(buf, msg, sizeof(msg))) { log_error("Garbled message"); exit(2); }
+        got++;
     }
-    gx_sleep(1);
+    if(mapc_eof(m)) is_done = 1;
+    return 0;
 }
 
-void reader() {
+int reader() {
     mapc *testm;
     gx_eventloop_init(mapc_events);
-    gx_sleep(0,500);
-    _N( testm = mapc_open("tmp/writer-file.dat", MAPC_READ) ) _eexit();
+    gx_sleep(0,100);
+    _N( testm = mapc_open(PATH, MAPC_READ) ) _abort();
+    _ ( mapc_events_add_misc(testm->notify_fd, testm)) _abort();
+    while(!is_done) _ (mapc_events_wait(1000, on_mapc)) _abort();
+    mapc_close(testm);
+    if(got != MSGS) { log_error("Expected %d messages, got %zu", MSGS, got); return 1; }
+    return 0;
 }
 
 int main(int argc, char **argv) {
     pid_t pid;
     int status = 0;
-    _ ( pid = fork() ) _eexit();
-    if(pid){writer();}
-    else   {reader(); waitpid(pid, &status, 0);}
-    return status;
+    _ ( pid = fork() ) _abort();
+    if(!pid) return reader();
+    status = writer();
+    waitpid(pid, &status, 0);
+    if(status) { log_error("reader failed (%d)", status); return 1; }
+    printf("mapc ok\n");
+    return 0;
 }
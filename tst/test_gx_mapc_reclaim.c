@@ -0,0 +1,115 @@
+// Consumed pages should be punched out of the file (volatile) or kept
+// (MAPC_PERSIST) as the reader moves forward- and a reader attaching while
+// the writer reclaims must never start on pages that are being punched.
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+#define MAPC_MAX_READERS 200                    ///< Room for the race's decoy readers (still one head page)
+#include "../gx_error.h"
+#include "../gx_mapc.h"
+
+#define PATH  "/dev/shm/test-gx-mapc-reclaim.dat"
+#define TOTAL (8 * MAPC_RECLAIM_CHUNK)
+
+static size_t blocks_used() {
+    struct stat st;
+    _ (stat(PATH, &st)) _abort();
+    return st.st_blocks * 512;
+}
+
+static size_t run(int flags) {
+    static char chunk[0x10000];
+    static char buf[0x10000];
+    mapc  *w, *r;
+    size_t i;
+
+    unlink(PATH);
+    memset(chunk, 'x', sizeof(chunk));
+    _N(w = mapc_open(PATH, MAPC_WRITE | flags)) _abort();
+    _N(r = mapc_open(PATH, MAPC_READ))          _abort();
+    for(i = 0; i < TOTAL; i += sizeof(chunk)) {
+        _ (mapc_write(w, chunk, sizeof(chunk))) _abort();
+        assert(mapc_read(r, buf, sizeof(buf)) == sizeof(buf));
+        assert(buf[0] == 'x' && buf[sizeof(buf) - 1] == 'x');
+    }
+    _ (mapc_reclaim(w)) _abort();
+    size_t used = blocks_used();
+    if(!(flags & MAPC_PERSIST)) assert(w->head->start_available == TOTAL);
+    else                        assert(w->head->start_available == 0);
+    mapc_close(r);
+    mapc_close(w);
+    unlink(PATH);
+    return used;
+}
+
+#define RACE_READERS 4
+#define RACE_OPENS    3000
+
+static volatile int racing;
+static volatile int race_bad;
+
+/// Word i of the stream is i + 1, so a punched hole (zeros) shows up anywhere.
+static void *race_writer(void *vw) {
+    mapc    *w = (mapc *)vw;
+    uint64_t block[512], n = 0;
+    size_t   i;
+    while(racing) {
+        for(i = 0; i < 512; i++) block[i] = ++n;
+        _ (mapc_write(w, block, sizeof(block))) _abort();
+        _ (mapc_reclaim(w)) _abort();
+    }
+    return NULL;
+}
+
+static void *race_reader(void *unused) {
+    uint64_t buf[512];
+    size_t   got, off, i;
+    mapc    *r;
+    int      k;
+    for(k = 0; k < RACE_OPENS; k++) {
+        _N(r = mapc_open(PATH, MAPC_READ)) _abort();
+        off = r->c;
+        sched_yield();                          // Let a reclaim that missed us get to its punch
+        got = mapc_read(r, buf, sizeof(buf)) / 8;
+        for(i = 0; i < got; i++) if(buf[i] != off / 8 + i + 1) { race_bad++; break; }
+        mapc_close(r);
+    }
+    return NULL;
+}
+
+static void race() {
+    pthread_t wt, rt[RACE_READERS];
+    mapc     *w;
+    int       i;
+    unlink(PATH);
+    _N(w = mapc_open(PATH, MAPC_WRITE | MAPC_VOLATILE)) _abort();
+    // Decoys past the racers' slots: alive, never holding anything back, but
+    // each costs the writer a kill(0) after it has passed the racers- which
+    // widens the window between its scan and what it publishes.
+    for(i = RACE_READERS; i < MAPC_MAX_READERS; i++) {
+        w->head->readers[i].off = UINT64_MAX;
+        w->head->readers[i].pid = getppid();
+    }
+    racing = 1;
+    pthread_create(&wt, NULL, race_writer, w);
+    for(i = 0; i < RACE_READERS; i++) pthread_create(&rt[i], NULL, race_reader, NULL);
+    for(i = 0; i < RACE_READERS; i++) pthread_join(rt[i], NULL);
+    racing = 0;
+    pthread_join(wt, NULL);
+    printf("attach vs. reclaim: %d of %d readers started on freed pages\n", race_bad, RACE_READERS * RACE_OPENS);
+    assert(race_bad == 0);
+    mapc_close(w);
+    unlink(PATH);
+}
+
+int main(int argc, char **argv) {
+    size_t vol  = run(MAPC_VOLATILE);
+    size_t pers = run(MAPC_PERSIST);
+    printf("volatile: %zu bytes still allocated, persistent: %zu\n", vol, pers);
+    assert(vol  <  MAPC_RECLAIM_CHUNK);
+    assert(pers >= TOTAL);
+    race();
+    printf("mapc reclaim ok\n");
+    return 0;
+}
@@ -1,55 +1,169 @@
 #include "../gx.h"
+#define GX_MFD_MAX_READERS 200  // Room for the attach race's decoys (still one head page)
 #include "../gx_mfd.h"
 #include "../gx_event.h"
 
 gx_error_initialize(GX_DEBUG);
 
+#define PATH    "/dev/shm/test-gx-mfd.dat"
+#define RECORDS 20000   // ~ 400KB- several remaps with only 4 pages premapped
 
 gx_mfd_pool *mfd_pool;
 
-void writer() {
+gx_mfd      *wmfd;
+
+int writer() {
     int     i;
-    gx_mfd *mfd_w;
-    char    msg[] = "something blah blah";
-
-    _N( mfd_w = acquire_gx_mfd(mfd_pool)               ) _abort();
-    _ ( gx_mfd_create_w(mfd_w,10,"tmp/writer-file.dat")) _abort();
-    gx_sleep(1);
-    for(i=0; i < 5; i++) {
-        gx_sleep(0,500);
-        log_info("CHILD:    Writing some stuff");
-        mfd_write(mfd_w, msg, sizeof(msg));
+    char    msg[] = "something blah";
+
+    for(i=0; i < RECORDS; i++) {
+        _ ( mfd_wbe32(wmfd, i)                    ) _abort();
+        _ ( mfd_wle16(wmfd, 0xBEEF)               ) _abort();
+        _ ( mfd_write(wmfd, msg, sizeof(msg))     ) _abort();
     }
-    //printf("writer: %llX\n", (unsigned long long int)(mfd_w->head->sig));
-    gx_sleep(1);
+    _ ( gx_mfd_close(wmfd) ) _abort();
+    return 0;
 }
 
 gx_eventloop_declare  (mfd_events, 1, 1);
 gx_eventloop_implement(mfd_events, 1, 1);
 
+int notified = 0;
 int on_readfile_changed(gx_tcp_sess *s, uint32_t event) {
-    log_info("PARENT:   Eventloop told me the file has new data.");
+    _ (mfd_notified((gx_mfd *)s->udata)) _raise(-1);
+    notified++;
     return 0;
 }
 
-void reader() {
-    gx_mfd                 *mfd_r;
+int reader() {
+    gx_mfd  *mfd_r;
+    uint8_t  rec[6 + 15];
+    int      i = 0;
+    ssize_t  n;
+
     gx_eventloop_init (mfd_events);
-    gx_sleep(0,500);  // Give the writer enough time to get the file set up.
     _N( mfd_r = acquire_gx_mfd(mfd_pool)               ) _abort();
-    _ ( gx_mfd_create_r(mfd_r,10,"tmp/writer-file.dat")) _abort();
-    _ ( mfd_events_add_misc(mfd_r->notify_fd, mfd_r)   ) _abort();
-    _ ( mfd_events_wait(-1, on_readfile_changed)       ) _abort();
+    _ ( gx_mfd_create_r(mfd_r, 4, PATH)                ) _abort();
+    _ ( gx_mfd_event_add(mfd_events, mfd_r)            ) _abort();
+    _ ( mfd_events_wait(2000, on_readfile_changed)     ) _abort();
+    if(!notified) { log_error("notify_fd never became readable"); return 1; }
+
+    // Tail-follow without polling
+    while((n = gx_mfd_follow(mfd_r, 2000)) > 0) {
+        while(mfd_available(mfd_r) >= sizeof(rec)) {
+            _ (mfd_read(mfd_r, rec, sizeof(rec))) _abort();
+            uint32_t seq = (rec[0] << 24) | (rec[1] << 16) | (rec[2] << 8) | rec[3];
+            if(seq != (uint32_t)i || rec[4] != 0xEF || rec[5] != 0xBE || strcmp((char *)rec + 6, "something blah")) {
+                log_error("Bad record %d", i);
+                return 1;
+            }
+            i++;
+        }
+        if(i == RECORDS) break;
+    }
+    _ (gx_mfd_close(mfd_r)) _abort();
+    if(i != RECORDS) { log_error("Only got %d records", i); return 1; }
+    return 0;
 }
 
 
+// Readers attaching while the writer reclaims after every page must never
+// start on pages that are being punched. Word i of the stream is i + 1, so a
+// hole (zeros) shows up anywhere.
+#define RACE_READERS 4
+#define RACE_OPENS   3000
+static volatile int racing, race_bad;
+
+static void *race_writer(void *vw) {
+    uint64_t block[512], n = 0;
+    size_t   i;
+    while(racing) {
+        for(i = 0; i < 512; i++) block[i] = ++n;
+        _ (mfd_write((gx_mfd *)vw, block, sizeof(block))) _abort();
+        _ (gx_mfd_reclaim((gx_mfd *)vw)                 ) _abort();
+    }
+    return NULL;
+}
+
+static void *race_reader(void *unused) {
+    gx_mfd_pool *pool;
+    gx_mfd      *r;
+    uint64_t     buf[512];
+    size_t       off, i;
+    ssize_t      got;
+    int          k;
+    _N( pool = new_gx_mfd_pool(1) ) _abort();
+    for(k = 0; k < RACE_OPENS; k++) {
+        _N( r = acquire_gx_mfd(pool)          ) _abort();
+        _ ( gx_mfd_create_r(r, 4, PATH)       ) _abort();
+        off = r->off_r;
+        sched_yield();                          // Let a reclaim that missed us get to its punch
+        _ ( got = mfd_read(r, buf, sizeof(buf)) ) _abort();
+        for(i = 0; i < (size_t)got / 8; i++) if(buf[i] != off / 8 + i + 1) { race_bad++; break; }
+        _ ( gx_mfd_close(r)                   ) _abort();
+        release_gx_mfd(pool, r);
+    }
+    return NULL;
+}
+
+static int race() {
+    pthread_t wt, rt[RACE_READERS];
+    int       i;
+    unlink(PATH);
+    _N( wmfd = acquire_gx_mfd(mfd_pool)                  ) _abort();
+    _ ( gx_mfd_create_wf(wmfd, 4, PATH, GX_MFD_VOLATILE) ) _abort();
+    // Decoys past the racers' slots: alive, never holding anything back, but
+    // each costs the writer a kill(0) after it has passed the racers
+    for(i = RACE_READERS; i < GX_MFD_MAX_READERS; i++) {
+        wmfd->head->readers[i].off = UINT64_MAX;
+        wmfd->head->readers[i].pid = getppid();
+    }
+    racing = 1;
+    pthread_create(&wt, NULL, race_writer, wmfd);
+    for(i = 0; i < RACE_READERS; i++) pthread_create(&rt[i], NULL, race_reader, NULL);
+    for(i = 0; i < RACE_READERS; i++) pthread_join(rt[i], NULL);
+    racing = 0;
+    pthread_join(wt, NULL);
+    _ ( gx_mfd_close(wmfd) ) _abort();
+    unlink(PATH);
+    if(race_bad) { log_error("%d of %d readers started on freed pages", race_bad, RACE_READERS * RACE_OPENS); return 1; }
+    return 0;
+}
+
 int main(int argc, char **argv) {
     pid_t pid;
     int   status=0;
 
-    _N( mfd_pool = new_gx_mfd_pool(2) ) _abort();
-    _ (pid = fork()                   ) _abort();
-    if(pid) /* child  */ writer();
-    else    /* parent */ {reader(); waitpid(pid, &status, 0);}
-    return status;
+    unlink(PATH);
+    _N( mfd_pool = new_gx_mfd_pool(2)                     ) _abort();
+    _N( wmfd = acquire_gx_mfd(mfd_pool)                  ) _abort();
+    _ ( gx_mfd_create_wf(wmfd, 4, PATH, GX_MFD_VOLATILE) ) _abort();
+    _ ( pid = fork()                                      ) _abort();
+    if(!pid) return reader();
+    gx_sleep(0,300);  // Reader attaches first so it has a slot before anything is reclaimed
+    writer();
+    waitpid(pid, &status, 0);
+    if(status) { unlink(PATH); return 1; }
+
+    // Reopening a volatile file (premapped slack still on the end) is normal-
+    // it continues where it left off without warning about its state
+    char  log_path[] = "/tmp/gx-mfd-log-XXXXXX", out[4096] = {0};
+    int   log_fd, saved = dup(STDERR_FILENO);
+    _ ( log_fd = mkstemp(log_path)                       ) _abort();
+    dup2(log_fd, STDERR_FILENO);
+    _N( wmfd = acquire_gx_mfd(mfd_pool)                  ) _abort();
+    _ ( gx_mfd_create_wf(wmfd, 4, PATH, GX_MFD_VOLATILE) ) _abort();
+    if(wmfd->off_w != RECORDS * (6 + 15)) { log_error("Reopened at %zu", wmfd->off_w); return 1; }
+    _ ( gx_mfd_close(wmfd)                               ) _abort();
+    dup2(saved, STDERR_FILENO);
+    if(pread(log_fd, out, sizeof(out) - 1, 0) > 0 && strstr(out, "inconsistent")) {
+        log_error("Reopen warned: %s", out);
+        return 1;
+    }
+    close(log_fd);
+    unlink(log_path);
+    unlink(PATH);
+    if(race()) return 1;
+    printf("mfd ok\n");
+    return 0;
 }
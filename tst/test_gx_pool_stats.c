@@ -0,0 +1,39 @@
+// Build with and without -DGX_POOL_TRACE- counters and acquire sites should
+// match what we did below, and the plain build must still compile.
+#include <assert.h>
+#include "../gx.h"
+#include "../gx_pool.h"
+
+typedef struct Y {
+    GX_POOL_OBJECT(struct Y);
+    int v;
+} Y;
+
+gx_pool_init(Y)
+
+int main(int argc, char **argv)
+{
+    Y_pool *pool = new_Y_pool(4);
+    Y *ys[10];
+    int i;
+
+    for(i = 0; i < 10; i++) ys[i] = gx_pool_acquire(Y, pool);
+    for(i = 0; i < 9; i++) release_Y(pool, ys[i]);
+
+#ifdef GX_POOL_STATS
+    assert(pool->stats.acquired    == 10);
+    assert(pool->stats.released    == 9);
+    assert(pool->stats.in_use      == 1);
+    assert(pool->stats.in_use_peak == 10);
+    assert(pool->stats.extends     == 3);   // 4 + 4 + 8
+#endif
+#ifdef GX_POOL_TRACE
+    gx_pool_site *site = _Y_pool_site(pool, ys[9]);
+    assert(site && site->line == 20 && strstr(site->file, "test_gx_pool_stats.c"));
+#endif
+    Y_pool_dump(pool);
+    release_Y(pool, ys[9]);
+    destroy_Y_pool(pool);
+    printf("pool stats ok\n");
+    return 0;
+}
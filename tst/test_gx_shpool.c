@@ -0,0 +1,122 @@
+#include <assert.h>
+#define GX_SHPOOL_REAP_MS 300
+#include "../gx.h"
+#include "../gx_pool.h"
+
+typedef struct Y {
+    int a;
+    int b;
+} Y;
+
+static int Y_construct(Y *y) { y->a = 10; return 0; }
+static int Y_destroy  (Y *y) { y->a = 0;  return 0; }
+
+gx_pool_init_shared(Y, Y_construct, Y_destroy)
+
+Y_shpool *pool = NULL;
+
+int main(int argc, char **argv)
+{
+    int      status;
+    pid_t    pid;
+    uint64_t off;
+    Y       *y1, *y2;
+
+    pool = new_Y_shpool(4, NULL);
+    assert(pool != NULL);
+
+    // Object acquired in the parent is visible (by offset) in the child
+    y1 = acquire_shared_Y(pool);
+    assert(y1 && y1->a == 10);
+    off = Y_shpool_ref(pool, y1);
+    pid = fork();
+    if(!pid) {
+        Y *cy = Y_shpool_deref(pool, off);
+        cy->b = 42;
+        release_shared_Y(pool, cy);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    assert(y1->b == 42);
+    assert(pool->in_use == 0);
+
+    // A child that dies holding objects doesn't leak them
+    pid = fork();
+    if(!pid) {
+        acquire_shared_Y(pool);
+        acquire_shared_Y(pool);
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    assert(pool->in_use == 2);
+    assert(Y_shpool_reap(pool) == 2);
+    assert(pool->in_use == 0);
+
+    // A child that dies holding the lock doesn't wedge the pool
+    pid = fork();
+    if(!pid) {
+        acquire_shared_Y(pool);
+        pthread_mutex_lock(&(pool->mutex));
+        _exit(0);
+    }
+    waitpid(pid, &status, 0);
+    y1 = acquire_shared_Y(pool);
+    assert(y1 != NULL);
+    assert(pool->in_use == 1);
+
+    // Fixed size- exhausts cleanly
+    assert(acquire_shared_Y(pool) && acquire_shared_Y(pool) && acquire_shared_Y(pool));
+    y2 = acquire_shared_Y(pool);
+    assert(y2 == NULL && errno == ENOMEM);
+
+    destroy_Y_shpool(pool);
+
+    // File-backed: attaching with a smaller number maps the creator's size
+    // and leaves the file (and the creator's slots) alone
+    {
+        char      path[64];
+        Y_shpool *big, *small;
+        Y        *ys[1000];
+        int       i;
+        uint64_t  t0, per;
+        struct stat st;
+        snprintf(path, sizeof(path), "/dev/shm/test_gx_shpool.%d", (int)getpid());
+        unlink(path);
+        big = new_Y_shpool(1000, path);
+        assert(big != NULL);
+        for(i = 0; i < 1000; i++) assert((ys[i] = acquire_shared_Y(big)));
+        ys[999]->b = 7;
+        pid = fork();
+        if(!pid) {
+            small = new_Y_shpool(4, path);
+            if(!small || small->map_size != big->map_size || small->total_items != 1000) _exit(1);
+            if(Y_shpool_deref(small, Y_shpool_ref(big, ys[999]))->b != 7) _exit(2);
+            destroy_Y_shpool(small);
+            _exit(0);
+        }
+        waitpid(pid, &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        assert(stat(path, &st) == 0 && (size_t)st.st_size == big->map_size);
+        assert(ys[999]->b == 7);                       // Would SIGBUS if truncated
+
+        // Staying dry doesn't rescan all 1000 owners on every acquire, but a
+        // dead owner's slots still come back once GX_SHPOOL_REAP_MS is up
+        t0 = gx_time_mono_ns();
+        for(i = 0; i < 10000; i++) assert(!acquire_shared_Y(big) && errno == ENOMEM);
+        per = (gx_time_mono_ns() - t0) / 10000;
+        release_shared_Y(big, ys[0]);
+        release_shared_Y(big, ys[1]);
+        pid = fork();
+        if(!pid) { acquire_shared_Y(big); acquire_shared_Y(big); _exit(0); }
+        waitpid(pid, &status, 0);
+        assert(!acquire_shared_Y(big) && errno == ENOMEM);
+        gx_sleep(0,300);
+        assert((ys[0] = acquire_shared_Y(big)) && (ys[1] = acquire_shared_Y(big)));
+        printf("dry acquire: %" PRIu64 "ns\n", per);
+        assert(per < 20000);                            // vs. 1000 kill(0)s each
+        destroy_Y_shpool(big);
+        unlink(path);
+    }
+    printf("shared pool ok\n");
+    return 0;
+}
@@ -0,0 +1,113 @@
+// $() arena: strings past the first 4KB chunk are complete (not "") and the
+// earlier ones stay put, chunks are reused after $reset() instead of being
+// reallocated, arguments are evaluated once even when a string moves to a
+// new chunk, $d/$u/$x agree with snprintf- and what each costs.
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+
+#define ROUNDS 1000000
+
+static int evaluated = 0;
+static int bump(void) { return ++evaluated; }
+
+static size_t chunks(gx_strbuf *sb) {
+    size_t       n = 0;
+    gx_strchunk *c;
+    for(c = sb->more; c; c = c->next) n++;
+    return n;
+}
+
+static void *thread_arena(void *arg) {
+    char *s[1000];
+    long  t = (long)arg;
+    int   i;
+    for(i = 0; i < 1000; i++) s[i] = $("thread %ld string %d with some padding to fill chunks", t, i);
+    for(i = 0; i < 1000; i++) {
+        char want[128];
+        snprintf(want, sizeof(want), "thread %ld string %d with some padding to fill chunks", t, i);
+        if(strcmp(s[i], want)) abort();
+    }
+    $reset();
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    static char   big[3 * $CHUNKSIZE];
+    char         *s[2000], want[64];
+    gx_strbuf     mine = {.p = NULL};
+    size_t        i, n;
+    int64_t       sv[] = {0, 1, -1, 9, 10, 99, 100, -100, 12345678901LL, INT64_MAX, INT64_MIN};
+    uint64_t      uv[] = {0, 1, 15, 16, 255, 0xdeadbeef, 10000000000000000000ULL, UINT64_MAX}, t0, sum = 0;
+    pthread_t     th[4];
+
+    // Way past the first chunk: every string intact, nothing truncated
+    $reset();
+    for(i = 0; i < 2000; i++) s[i] = $("string number %zu, padded out a bit", i);
+    for(i = 0; i < 2000; i++) {
+        snprintf(want, sizeof(want), "string number %zu, padded out a bit", i);
+        assert(!strcmp(s[i], want));
+    }
+    n = chunks(&_gx_tstr_buf);
+    assert(n > 0);
+
+    // Bigger than a chunk, and more of them after a reset- reused, not added to
+    memset(big, 'z', sizeof(big) - 1);
+    s[0] = $("[%s]", big);
+    assert(strlen(s[0]) == sizeof(big) + 1 && s[0][0] == '[' && s[0][sizeof(big)] == ']');
+    n = chunks(&_gx_tstr_buf);
+    for(i = 0; i < 100; i++) {
+        size_t j;
+        $reset();
+        for(j = 0; j < 2000; j++) s[j] = $("string number %zu, padded out a bit", j);
+        s[0] = $("[%s]", big);
+    }
+    assert(chunks(&_gx_tstr_buf) == n);
+
+    // Arguments evaluated once, even when the string spills into a new chunk
+    $reset();
+    for(i = 0; i < 3000; i++) s[i % 2000] = $("%d %s", bump(), i % 100 ? "" : big + sizeof(big) - 5000);
+    assert(evaluated == 3000);
+
+    // Fast paths == snprintf
+    for(i = 0; i < sizeof(sv) / sizeof(sv[0]); i++) {
+        snprintf(want, sizeof(want), "%" PRId64, sv[i]); assert(!strcmp($d(sv[i]), want));
+    }
+    for(i = 0; i < sizeof(uv) / sizeof(uv[0]); i++) {
+        snprintf(want, sizeof(want), "%" PRIu64, uv[i]); assert(!strcmp($u(uv[i]), want));
+        snprintf(want, sizeof(want), "%" PRIx64, uv[i]); assert(!strcmp($x(uv[i]), want));
+    }
+    for(i = 0; i < 100000; i++) {
+        uint64_t v = (uint64_t)random() << 33 ^ (uint64_t)random() << (i % 31) ^ random();
+        if(i % 1000 == 0) $reset();
+        snprintf(want, sizeof(want), "%" PRIu64, v >> (i % 64)); assert(!strcmp($u(v >> (i % 64)), want));
+        snprintf(want, sizeof(want), "%" PRId64, (int64_t)v); assert(!strcmp($d(v), want));
+        snprintf(want, sizeof(want), "%" PRIx64, v >> (i % 64)); assert(!strcmp($x(v >> (i % 64)), want));
+    }
+
+    // A buffer of your own, zero-initialized
+    assert(!strcmp($S(mine, "%s-%d", "own", 7), "own-7") && !strcmp($Su(mine, 42u), "42"));
+    for(i = 0; i < 2000; i++) s[i] = $S(mine, "%zu", i);
+    assert(!strcmp(s[1999], "1999") && chunks(&mine) > 0);
+    $Sfree(mine);
+    assert(chunks(&mine) == 0 && !strcmp($S(mine, "%d", 5), "5"));
+
+    // Each thread has its own arena (and frees its chunks on exit)
+    for(i = 0; i < 4; i++) pthread_create(&th[i], NULL, thread_arena, (void *)i);
+    for(i = 0; i < 4; i++) pthread_join(th[i], NULL);
+    printf("gx_string ok\n");
+
+    // Cost per string, with a reset every 64 like a log record's worth
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < ROUNDS; i++) { if(!(i & 63)) $reset(); sum += $("%u", (unsigned)i)[0]; }
+    double fmt = (double)(gx_time_mono_ns() - t0) / ROUNDS;
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < ROUNDS; i++) { if(!(i & 63)) $reset(); sum += $u(i)[0]; }
+    double fast = (double)(gx_time_mono_ns() - t0) / ROUNDS;
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < ROUNDS; i++) { if(!(i & 63)) $reset(); sum += $x(i * 2654435761u)[0]; }
+    printf("  $(\"%%u\") %.1fns   $u() %.1fns   $x() %.1fns %s\n", fmt, fast,
+           (double)(gx_time_mono_ns() - t0) / ROUNDS, sum ? "" : " ");
+    return 0;
+}
@@ -0,0 +1,74 @@
+// gx_time: ISO strings match gmtime_r+strftime (incl. day / month / leap-year
+// rollovers), gx_time_ns() tracks CLOCK_REALTIME, cpu_ts intervals convert to
+// the right number of ns, and it's all cheap.
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+
+static void check_iso(gx_time_isostr *c, uint64_t ns) {
+    char      expect[64];
+    time_t    secs = ns / 1000000000ULL;
+    struct tm tm;
+    gmtime_r(&secs, &tm);
+    strftime(expect, sizeof(expect), "%Y-%m-%dT%H:%M:%S", &tm);
+    sprintf(expect + 19, ".%09uZ", (unsigned)(ns % 1000000000ULL));
+    char *got = gx_time_iso(c, ns);
+    if(strcmp(got, expect)) { fprintf(stderr, "%" PRIu64 ": got %s expected %s\n", ns, got, expect); abort(); }
+    assert(strlen(got) == GX_TIME_ISO_LEN);
+}
+
+int main(int argc, char **argv) {
+    gx_time_isostr c = {0}, fresh;
+    uint64_t    ns, s, start, rt, t0, t1, m0, m1;
+    int64_t     diff;
+    int         i;
+
+    // Sequential walk across interesting boundaries (cached path), then
+    // random jumps (full recompute path).
+    uint64_t edges[] = {0, 951782400ULL, 951868799ULL, 1078012800ULL, 4107542400ULL, 1356998399ULL, 1700000000ULL};
+    for(i = 0; i < (int)(sizeof(edges) / sizeof(edges[0])); i++)
+        for(s = edges[i] > 200000 ? edges[i] - 200000 : 0; s < edges[i] + 200000; s += 7)
+            check_iso(&c, s * 1000000000ULL + (s * 7919) % 1000000000ULL);
+    srandom(42);
+    for(i = 0; i < 1000000; i++) {
+        ns = ((uint64_t)random() << 31 | random()) % (253402300799ULL * 1000000000ULL);  // ..9999-12-31
+        if(i & 1) { memset(&fresh, 0, sizeof(fresh)); check_iso(&fresh, ns); }
+        else check_iso(&c, ns);
+    }
+
+    // Tracks the real clock (through a couple of re-anchors)
+    for(i = 0; i < 25; i++) {
+        ns   = gx_time_ns();
+        rt   = _gx_time_clock_ns(CLOCK_REALTIME);
+        diff = (int64_t)(rt - ns);
+        assert(diff > -1000000 && diff < 1000000);
+        usleep(100000);
+    }
+
+    // Ordered interval + conversion, and the monotonic substitute
+    m0 = _gx_time_clock_ns(CLOCK_MONOTONIC);
+    t0 = cpu_ts_start;
+    ns = gx_time_mono_ns();
+    usleep(50000);
+    t1 = cpu_ts_end;
+    rt = gx_time_mono_ns() - ns;
+    m1 = _gx_time_clock_ns(CLOCK_MONOTONIC) - m0;
+    assert(t1 > t0);
+    diff = (int64_t)(gx_ticks_ns(t1 - t0) - m1);
+    assert(diff > -(int64_t)(m1 / 100) && diff < (int64_t)(m1 / 100));
+    diff = (int64_t)(rt - m1);
+    assert(diff > -(int64_t)(m1 / 100) && diff < (int64_t)(m1 / 100));
+
+    start = _gx_time_clock_ns(CLOCK_MONOTONIC);
+    for(i = 0; i < 10000000; i++) ns += gx_time_mono_ns();
+    printf("gx_time ok: tsc %s, %" PRIu64 " ticks/s, %.1fns per gx_time_mono_ns\n",
+           gx_time_tsc_invariant() ? "invariant" : "NOT invariant", gx_time_tps(),
+           (double)(_gx_time_clock_ns(CLOCK_MONOTONIC) - start) / 10000000);
+
+    start = _gx_time_clock_ns(CLOCK_MONOTONIC);
+    for(i = 0; i < 10000000; i++) gx_time_iso(&c, gx_time_ns());
+    printf("gx_time ok: %s- %.1fns per stamp+format\n", c.str,
+           (double)(_gx_time_clock_ns(CLOCK_MONOTONIC) - start) / 10000000);
+    return 0;
+}
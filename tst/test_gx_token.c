@@ -4,6 +4,10 @@
 
 gx_error_initialize(GX_DEBUG);
 
+#define UID_THREADS 8
+static uint8_t uid_got[UID_THREADS][GX_NODE_UID_BINSIZE];
+static void *uid_first_use(void *i) { _ (gx_node_uid_bin(uid_got[(long)i])) _error(); return NULL; }
+
 int main(int argc, char **argv) {
     int r1, r2;
     uint64_t r3;
@@ -20,6 +24,26 @@ int main(int argc, char **argv) {
     _ (gx_node_uid(nuid)) _error();
     log_info("Returned network UID (pass 2): %s", nuid);
 
+    uint8_t  nbin[GX_NODE_UID_BINSIZE];
+    char     nhex[3];
+    uint64_t t0 = gx_time_mono_ns();
+    _gx_node_uid_is_memoized = 0;
+    _ (gx_node_uid_bin(nbin)) _error();
+    log_info("Node UID from scratch: %lluus", (gx_time_mono_ns() - t0) / 1000);
+    for(size_t b = 0; b < sizeof(nbin); b++) {
+        snprintf(nhex, sizeof(nhex), "%02x", nbin[b]);
+        if(memcmp(nhex, nuid + b * 2, 2)) log_error("Binary node UID differs from the string at byte %zu", b);
+    }
+
+    // Many threads on first use (per-thread nonce machines) all get the whole uid
+    pthread_t uth[UID_THREADS];
+    long      u;
+    _gx_node_uid_is_memoized = 0;
+    for(u = 0; u < UID_THREADS; u++) pthread_create(&uth[u], NULL, uid_first_use, (void *)u);
+    for(u = 0; u < UID_THREADS; u++) pthread_join(uth[u], NULL);
+    for(u = 0; u < UID_THREADS; u++)
+        if(memcmp(uid_got[u], nbin, sizeof(nbin))) log_error("Thread %ld got a different node UID", u);
+
     log_info("CPU timestamp: %llx", cpu_ts);
     log_info("CPU timestamp: %llx", cpu_ts);
 
@@ -47,7 +71,7 @@ int main(int argc, char **argv) {
                   "ident_hash: %llx\n"
                   "rand2:      %02x|%02x|%02x|%02x\n",
                 nm.ident.rand1,
-                nm.ident.node_uid,
+                nuid,
                 nm.ident.ts1,
                 nm.ident.tid,
                 nm.nonce.ident_hash,
@@ -0,0 +1,159 @@
+// gx_varint: LEB128 against a plain reference, VLQ byte-for-byte against
+// uint_to_vlq / vlq_to_uint, zigzag, truncation and overflow at every
+// length (with the input flush against a guard page), bulk == singles,
+// the portable terminator mask == SSE2's, and throughput against the gx.h
+// functions for a few value mixes.
+#include "../gx.h"
+#include "../gx_varint.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+
+#define N      (1 << 20)
+#define REPS   20
+
+static uint64_t rnd64() { return (uint64_t)random() << 62 ^ (uint64_t)random() << 31 ^ random(); }
+
+static int ref_leb128(uint64_t x, uint8_t *out) {
+    int n = 0;
+    do { out[n] = (x & 0x7f) | (x > 0x7f ? 0x80 : 0); x >>= 7; n++; } while(x);
+    return n;
+}
+
+/// Some value with exactly `bits` significant bits (0 -> 0)
+static uint64_t with_bits(int bits) {
+    if(!bits) return 0;
+    return (rnd64() & (~0ULL >> (64 - bits))) | 1ULL << (bits - 1);
+}
+
+static uint8_t *guard_end;               // Last byte before a PROT_NONE page
+
+static void check_value(uint64_t x) {
+    uint8_t  a[GX_VARINT_MAX + 8], b[GX_VARINT_MAX + 8], *g;
+    uint64_t v = 0;
+    int      la, lb, cut;
+
+    la = gx_leb128_put(x, a);
+    lb = ref_leb128(x, b);
+    assert(la == lb && !memcmp(a, b, la) && la == gx_varint_len(x));
+    la = gx_vlq_put(x, a);
+    lb = uint_to_vlq(x, b);
+    assert(la == lb && !memcmp(a, b, la) && vlq_to_uint(a) == x);
+
+    // Decode with the value at the very end of readable memory, and every
+    // truncation of it
+    g = guard_end - la;
+    memcpy(g, a, la);
+    assert(gx_vlq_get(g, g + la, &v) == g + la && v == x);
+    for(cut = 1; cut < la; cut++) {
+        uint8_t *t = guard_end - cut;
+        memcpy(t, a, cut);
+        assert(!gx_vlq_get(t, t + cut, &v) && errno == ENODATA);
+    }
+    lb = gx_leb128_put(x, b);
+    g  = guard_end - lb;
+    memcpy(g, b, lb);
+    assert(gx_leb128_get(g, g + lb, &v) == g + lb && v == x);
+    for(cut = 1; cut < lb; cut++) {
+        uint8_t *t = guard_end - cut;
+        memcpy(t, b, cut);
+        assert(!gx_leb128_get(t, t + cut, &v) && errno == ENODATA);
+    }
+}
+
+typedef struct { const char *name; int bits_lo, bits_hi; } mix;
+
+static void bench(const mix *m, uint64_t *vals, uint64_t *back, uint8_t *buf) {
+    size_t         i, r, bytes = 0;
+    uint64_t       t0, sum = 0, v = 0;
+    const uint8_t *p;
+    double         t[8];
+    for(i = 0; i < N; i++) vals[i] = with_bits(m->bits_lo + random() % (m->bits_hi - m->bits_lo + 1));
+
+#define TIME(K, BODY) do { t0 = gx_time_mono_ns(); for(r = 0; r < REPS; r++) { BODY; } \
+                           t[K] = (double)(gx_time_mono_ns() - t0) / REPS / N; } while(0)
+    TIME(0, { uint8_t *o = buf; for(i = 0; i < N; i++) o += uint_to_vlq(vals[i], o); bytes = o - buf; });
+    TIME(1, { p = buf; for(i = 0; i < N; i++) { sum += vlq_to_uint((uint8_t *)p); while(*p++ & 128); } });
+    TIME(2, { uint8_t *o = buf; for(i = 0; i < N; i++) o += gx_vlq_put(vals[i], o); });
+    TIME(3, { p = buf; for(i = 0; i < N; i++) { p = gx_vlq_get(p, buf + bytes, &v); sum += v; } });
+    TIME(4, { gx_vlq_put_n(vals, N, buf); });
+    TIME(5, { assert(gx_vlq_get_n(buf, buf + bytes, back, N) == buf + bytes); });
+    assert(!memcmp(vals, back, N * sizeof(*vals)));
+    TIME(6, { bytes = gx_leb128_put_n(vals, N, buf); });
+    TIME(7, { assert(gx_leb128_get_n(buf, buf + bytes, back, N) == buf + bytes); });
+    assert(!memcmp(vals, back, N * sizeof(*vals)));
+    printf("  %-22s %.2f B/value | ns/value put/get: gx.h %.2f/%.2f  vlq %.2f/%.2f  vlq_n %.2f/%.2f  leb128_n %.2f/%.2f%s\n",
+           m->name, (double)bytes / N, t[0], t[1], t[2], t[3], t[4], t[5], t[6], t[7], sum == 42 ? " " : "");
+}
+
+int main(int argc, char **argv) {
+    static uint64_t vals[N], back[N];
+    static uint8_t  buf[N * GX_VARINT_MAX];
+    uint8_t        *pages, over[16];
+    uint64_t        v;
+    int64_t         s;
+    size_t          i, n, j;
+    int             bits;
+
+    srandom(3);
+    pages = mmap(NULL, 2 * pagesize(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert(pages != MAP_FAILED && !mprotect(pages + pagesize(), pagesize(), PROT_NONE));
+    guard_end = pages + pagesize();
+
+    for(bits = 0; bits <= 64; bits++) {
+        for(j = 0; j < 2000; j++) check_value(with_bits(bits));
+        assert(gx_varint_len(with_bits(bits)) == (bits ? (bits + 6) / 7 : 1));
+    }
+    check_value(~0ULL);
+
+    // Zigzag: small magnitudes first, both ends of the range
+    assert(gx_zigzag(0) == 0 && gx_zigzag(-1) == 1 && gx_zigzag(1) == 2 && gx_zigzag(-2) == 3);
+    assert(gx_zigzag(INT64_MAX) == ~1ULL && gx_zigzag(INT64_MIN) == ~0ULL);
+    for(j = 0; j < 100000; j++) { s = (int64_t)rnd64() >> (random() % 64); assert(gx_unzigzag(gx_zigzag(s)) == s); }
+
+    // Too long or too big
+    memset(over, 0x80, sizeof(over));
+    over[10] = 0;
+    assert(!gx_leb128_get(over, over + 11, &v) && errno == EOVERFLOW);
+    assert(!gx_vlq_get(over, over + 11, &v) && errno == EOVERFLOW);
+    over[9] = 0x02;                                              // LEB128: a 65th bit
+    assert(!gx_leb128_get(over, over + 16, &v) && errno == EOVERFLOW);
+    over[9] = 0x01;
+    assert(gx_leb128_get(over, over + 16, &v) == over + 10 && v == 1ULL << 63);
+    memset(over, 0xff, 9); over[0] = 0x82; over[9] = 0x7f;      // VLQ: 65 bits
+    assert(!gx_vlq_get(over, over + 16, &v) && errno == EOVERFLOW);
+    over[0] = 0x81;
+    assert(gx_vlq_get(over, over + 16, &v) == over + 10 && v == ~0ULL);
+    over[0] = 0x80; over[1] = 0x05;                              // Non-minimal, accepted
+    assert(gx_leb128_get(over, over + 2, &v) == over + 2 && v == 5 << 7);
+    assert(gx_vlq_get(over, over + 2, &v) == over + 2 && v == 5);
+
+    // Bulk == singles, for runs of small values broken up by big ones
+    for(j = 0; j < 200; j++) {
+        n = random() % 500;
+        for(i = 0; i < n; i++) vals[i] = random() % 9 ? random() % 128 : with_bits(random() % 65);
+        size_t   lb = gx_leb128_put_n(vals, n, buf), vb;
+        uint8_t *o  = buf + lb;
+        for(i = 0; i < n; i++) o += gx_leb128_put(vals[i], o);
+        assert(!memcmp(buf, buf + lb, lb));
+        assert(gx_leb128_get_n(buf, buf + lb, back, n) == buf + lb && !memcmp(vals, back, n * 8));
+        if(n) assert(!gx_leb128_get_n(buf, buf + lb - 1, back, n) && errno == ENODATA);
+        vb = gx_vlq_put_n(vals, n, buf);
+        assert(gx_vlq_get_n(buf, buf + vb, back, n) == buf + vb && !memcmp(vals, back, n * 8));
+        for(i = 0, o = buf; i < n; i++) { assert(vlq_to_uint(o) == vals[i]); o += gx_varint_len(vals[i]); }
+    }
+
+    // The portable terminator mask (what non-x86-64 builds use) bit for bit
+    for(j = 0; j < 100000; j++) {
+        unsigned want = 0;
+        for(i = 0; i < 16; i++) { buf[i] = random(); want |= (buf[i] >> 7) << i; }
+        if(j < 17) for(i = 0; i < 16; i++) { buf[i] = i < j ? 0x80 : 0; want = (1u << j) - 1; }
+        assert(_gx_varint_mask16_swar(buf) == want && _gx_varint_mask16(buf) == want);
+    }
+    printf("varints ok\n");
+
+    static const mix mixes[] = {{"1 byte (< 128)", 0, 7}, {"1-3 bytes", 0, 21}, {"tick deltas (2-5 B)", 10, 32},
+                                {"uniform 64-bit", 50, 64}};
+    for(i = 0; i < sizeof(mixes) / sizeof(mixes[0]); i++) bench(&mixes[i], vals, back, buf);
+    return 0;
+}
@@ -0,0 +1,60 @@
+// K_err_stack: the origin of an error chain captures the native stack, it
+// symbolizes back to module+offset (and names, with -rdynamic)- cut short,
+// but still terminated, when it doesn't all fit- and capturing is cheap.
+#pragma GCC optimize ("no-omit-frame-pointer")
+#include "../gx.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+
+#define BENCH 200000
+
+noinline int level3(int e) { errno = e; return -1; }
+noinline int level2(int e) { _(level3(e)) _raise(-1); return 0; }
+noinline int level1(int e) { _(level2(e)) _raise(-1); return 0; }
+
+#define IN(FN, P) ((uintptr_t)(P) > (uintptr_t)&FN && (uintptr_t)(P) < (uintptr_t)&FN + 4096)
+
+int main(int argc, char **argv) {
+    static char many[GX_ERROR_STACK_FRAMES * 160 * 4];
+    char     raw[GX_ERROR_STACK_FRAMES * 19 + 1], *sym, *l1, *m, *first;
+    size_t   one;
+    uint64_t t0, capture, link;
+    int      i;
+
+    _(level1(EACCES)) {
+        // Origin is the check in level2, called from level1, called from main
+        assert(_gx_error_nframes >= 3);
+        assert(IN(level2, _gx_error_frames[0]) && IN(level1, _gx_error_frames[1]) && IN(main, _gx_error_frames[2]));
+        strcpy(raw, _gx_error_frames_str());
+        sym = gx_error_symbolize(raw);
+        assert(strstr(sym, "+0x") && !strchr(sym, '\n'));
+        if(!strncmp(sym, "level2+0x", 9))                                    // -rdynamic
+            assert((l1 = strstr(sym, " level1+0x")) && (m = strstr(sym, " main+0x")) && l1 < m);
+        _error(K_msg, "logged with its stack");
+        _clear();
+    }
+    _(level1(EBADF)) { assert(IN(level2, _gx_error_frames[0])); _clear(); }
+
+    // Far more frames than the buffer has room for (long names / deep paths)
+    for(i = 0, m = many; m + 20 < many + sizeof(many); i++) m += sprintf(m, i ? " %p" : "%p", (void *)&level2 + 1);
+    first = strndup(many, strchr(many, ' ') - many);
+    one   = strlen(gx_error_symbolize(first));
+    sym   = gx_error_symbolize(many);
+    assert(strlen(sym) < GX_ERROR_STACK_FRAMES * 160 && strlen(sym) > GX_ERROR_STACK_FRAMES * 160 / 2);
+    assert((strlen(sym) + 1) % (one + 1) == 0);                          // Whole frames only
+    free(first);
+
+    // Cost of marking the origin (with capture) vs. a second link (without)
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < BENCH; i++) { _(level3(EAGAIN)) _clear(); }
+    capture = gx_time_mono_ns() - t0;
+    _gx_error_cidx = 1;   // Pretend something's already on the stack- no capture
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < BENCH; i++) { _gx_mark_err_do(EAGAIN, __FILE__, __LINE__, __FUNCTION__, "x"); }
+    link = gx_time_mono_ns() - t0;
+    _clear();
+    printf("err stacks ok: %.0fns per failed check w/ capture, %.0fns per mark w/o\n",
+           (double)capture / BENCH, (double)link / BENCH);
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Nonce throughput: single calls, batches, per-thread machines, shared
+// machines under contention- and none of them repeat, including across a
+// fork of an already-initialized machine. A shared machine that lost a race
+// for its last gap byte keeps drawing random gaps.
+#include "../gx.h"
+#include "../gx_net.h"
+#include "../gx_token.h"
+gx_error_initialize(GX_DEBUG);
+
+#include <assert.h>
+#include <sys/wait.h>
+
+#define BENCH   2000000
+#define THREADS 4
+#define PER     200000
+#define BATCH   64
+
+static gx_nonce_machine shared;
+static char            *out;           // THREADS * PER nonces per round
+
+static int cmp12(const void *a, const void *b) { return memcmp(a, b, GX_NONCE_BINSIZE); }
+
+static void assert_unique(char *nonces, size_t n) {
+    size_t i;
+    qsort(nonces, n, GX_NONCE_BINSIZE, cmp12);
+    for(i = 1; i < n; i++)
+        assert(memcmp(nonces + (i - 1) * GX_NONCE_BINSIZE, nonces + i * GX_NONCE_BINSIZE, GX_NONCE_BINSIZE));
+}
+
+static void *local_worker(void *arg) {
+    char             *o = out + (long)arg * PER * GX_NONCE_BINSIZE;
+    gx_nonce_machine *nm;
+    int               i;
+    _N(nm = gx_nonce_local()) _abort();
+    for(i = 0; i < PER; i++) _(gx_nonce_next(nm, o + i * GX_NONCE_BINSIZE)) _abort();
+    return NULL;
+}
+
+static void *shared_worker(void *arg) {
+    char *o = out + (long)arg * PER * GX_NONCE_BINSIZE;
+    int   i;
+    for(i = 0; i < PER; i += BATCH) _(gx_nonce_next_n(&shared, o + i * GX_NONCE_BINSIZE, min(BATCH, PER - i))) _abort();
+    return NULL;
+}
+
+static double threaded(void *(*fn)(void *)) {
+    pthread_t th[THREADS];
+    uint64_t  t0 = gx_time_mono_ns();
+    long      i;
+    for(i = 0; i < THREADS; i++) pthread_create(&th[i], NULL, fn, (void *)i);
+    for(i = 0; i < THREADS; i++) pthread_join(th[i], NULL);
+    return (double)(gx_time_mono_ns() - t0) / (THREADS * PER);
+}
+
+int main(int argc, char **argv) {
+    static char       batch[BATCH * GX_NONCE_BINSIZE];
+    char              one[GX_NONCE_BINSIZE], seq[BATCH * GX_NONCE_BINSIZE];
+    gx_nonce_machine  nm, copy;
+    uint64_t          t0;
+    double            single, batched, gettid, local, contended;
+    pid_t             pid;
+    uint64_t          before, gap, last = 0;
+    int               changes = 0;
+    int               i, status;
+
+    out = mmap(NULL, 2 * THREADS * PER * GX_NONCE_BINSIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    assert(out != MAP_FAILED);
+    _(gx_nonce_init(&nm, 0)) _abort();
+
+    // A batch is exactly the sequence single calls would have produced
+    copy = nm;
+    for(i = 0; i < BATCH; i++) _(gx_nonce_next(&copy, seq + i * GX_NONCE_BINSIZE)) _abort();
+    _(gx_nonce_next_n(&nm, batch, BATCH)) _abort();
+    assert(!memcmp(seq, batch, sizeof(batch)));
+
+    // Two threads both took the last gap byte (and the last draw before a
+    // reseed): the counts are below zero, not zero
+    copy = nm;
+    copy.rnd_left  = -1;
+    copy.reseed_in = -1;
+    for(i = 0; i < BATCH; i++) {
+        before = copy.nonce.counter;
+        _(gx_nonce_next(&copy, one)) _abort();
+        gap = copy.nonce.counter - before;
+        if(i > 16) changes += gap != last;      // Past what's left in rnd_bits
+        last = gap;
+    }
+    assert(changes > BATCH / 2 && copy.rnd_left >= 0 && copy.reseed_in > 0);
+
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < BENCH; i++) _(gx_nonce_next(&nm, one)) _abort();
+    single = (double)(gx_time_mono_ns() - t0) / BENCH;
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < BENCH; i += BATCH) _(gx_nonce_next_n(&nm, batch, BATCH)) _abort();
+    batched = (double)(gx_time_mono_ns() - t0) / BENCH;
+    t0 = gx_time_mono_ns();
+    for(i = 0; i < BENCH / 10; i++) syscall(SYS_gettid);
+    gettid = (double)(gx_time_mono_ns() - t0) / (BENCH / 10);
+
+    // Unique across per-thread machines, and across threads sharing one
+    local = threaded(local_worker);
+    assert_unique(out, THREADS * PER);
+    _(gx_nonce_init(&shared, 0)) _abort();
+    contended = threaded(shared_worker);
+    assert_unique(out, THREADS * PER);
+
+    // Parent and child both continue from the same (pre-fork) machine
+    _(pid = fork()) _abort();
+    for(i = 0; i < PER; i += BATCH)
+        _(gx_nonce_next_n(&nm, out + ((pid ? 0 : PER) + i) * GX_NONCE_BINSIZE, min(BATCH, PER - i))) _abort();
+    if(!pid) _exit(0);
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && !WEXITSTATUS(status));
+    assert_unique(out, 2 * PER);
+
+    printf("nonces ok: %.1fns single, %.1fns batched (x%d), %.1fns per-thread (x%d threads), "
+           "%.1fns shared+batched (x%d threads); a gettid syscall alone is %.1fns\n",
+           single, batched, BATCH, local, THREADS, contended, THREADS, gettid);
+    return 0;
+}
@@ -0,0 +1,86 @@
+/**
+   @file      util/gx_logdecode.c
+   @brief     Turns a gxe/log_binary.h log back into text or JSON lines.
+
+     gx_logdecode [-j] [-c] [file]      (stdin when no file)
+        -j   one JSON object per record
+        -c   include the context fields (program, pid, host, ...) in text mode
+
+   Times are UTC, interpolated from each chunk's wall-clock anchor.
+*/
+#include "../gx.h"
+
+static int json = 0, with_ctx = 0;
+
+static void put_str(const char *s, size_t len) {
+    if(!json) { fwrite(s, 1, len, stdout); return; }
+    putchar('"');
+    for(; len > 0; s++, len--) {
+        unsigned char c = (unsigned char)*s;
+        if(c == '"' || c == '\\')  { putchar('\\'); putchar(c); }
+        else if(c == '\n')         fputs("\\n", stdout);
+        else if(c == '\t')         fputs("\\t", stdout);
+        else if(c < 0x20)          printf("\\u%04x", c);
+        else                       putchar(c);
+    }
+    putchar('"');
+}
+
+static void put_field(gx_log_bin_field *f) {
+    if(json) { putchar(','); put_str(f->key_str, f->key_len); putchar(':'); }
+    else     { putchar(' '); fwrite(f->key_str, 1, f->key_len, stdout); putchar('='); }
+    if(f->is_num) printf("%" PRIu64, f->num);
+    else          put_str(f->val, f->val_len);
+}
+
+static int print_record(gx_log_bin_record *rec, optional void *udata) {
+    char       tbuf[64];
+    time_t     secs = (time_t)(rec->unix_ns / 1000000000ULL);
+    struct tm  tm;
+    const char *sev = $gx_severity(rec->severity);
+    int        i;
+
+    gmtime_r(&secs, &tm);
+    strftime(tbuf, sizeof(tbuf), "%Y-%m-%dT%H:%M:%S", &tm);
+    if(sev && !strncmp(sev, "SEV_", 4)) sev += 4;
+    if(json) {
+        printf("{\"time\":\"%s.%09" PRIu64 "Z\",\"ticks\":%" PRIu64 ",\"severity\":\"%s\"",
+               tbuf, rec->unix_ns % 1000000000ULL, rec->tick, sev ? sev : "?");
+        for(i = 0; i < rec->nctx;    i++) put_field(&(rec->ctx[i]));
+        for(i = 0; i < rec->nfields; i++) put_field(&(rec->fields[i]));
+        fputs("}\n", stdout);
+    } else {
+        printf("%s.%06" PRIu64 "Z %-9s", tbuf, (rec->unix_ns % 1000000000ULL) / 1000, sev ? sev : "?");
+        if(with_ctx) for(i = 0; i < rec->nctx; i++) put_field(&(rec->ctx[i]));
+        for(i = 0; i < rec->nfields; i++) put_field(&(rec->fields[i]));
+        putchar('\n');
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int      opt, fd = STDIN_FILENO;
+    size_t   len = 0, cap = 1 << 20;
+    ssize_t  got;
+    uint8_t *buf;
+
+    while((opt = getopt(argc, argv, "jc")) != -1) {
+        if(opt == 'j')      json = 1;
+        else if(opt == 'c') with_ctx = 1;
+        else { fprintf(stderr, "usage: %s [-j] [-c] [file]\n", argv[0]); return 2; }
+    }
+    if(optind < argc && (fd = open(argv[optind], O_RDONLY)) == -1) { perror(argv[optind]); return 1; }
+    if(!(buf = malloc(cap))) return 1;
+    while((got = read(fd, buf + len, cap - len)) > 0) {
+        len += got;
+        if(len == cap && !(buf = realloc(buf, cap *= 2))) return 1;
+    }
+    if(got == -1) { perror("read"); return 1; }
+
+    if(gx_log_bin_decode(buf, len, gx_log_bin_first_tps(buf, len), print_record, NULL) == -1) {
+        fflush(stdout);
+        fprintf(stderr, "%s: %s\n", optind < argc ? argv[optind] : "stdin", strerror(errno));
+        return 1;
+    }
+    return 0;
+}